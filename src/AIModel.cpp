@@ -1,142 +1,531 @@
 #include "AIModel.h"
+#include "Profiler.h"
+#include "Metrics.h"
 #include <fstream>
-#include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <chrono>
 #include <unordered_set>
+#include <iterator>
+#include <charconv>
+#include <cstring>
+
+namespace {
+// Parse a leading integer field and consume the comma that follows it
+bool ParseIntField(std::string_view& text, int& value) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc()) return false;
+    text.remove_prefix(static_cast<size_t>(result.ptr - text.data()));
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    if (!text.empty() && text.front() == ',') text.remove_prefix(1);
+    return true;
+}
+
+// True if every parameter of 'wanted' is set to the same value on 'node'
+bool HasParameters(const AINode& node, const AINode& wanted) {
+    for (const auto& param : wanted.parameters) {
+        auto it = std::find_if(node.parameters.begin(), node.parameters.end(),
+            [&param](const auto& existing) { return existing.first == param.first; });
+        if (it == node.parameters.end() || it->second != param.second) return false;
+    }
+    return true;
+}
+
+// True if both nodes set the same parameters to the same values
+bool SameParameters(const AINode& a, const AINode& b) {
+    return HasParameters(a, b) && HasParameters(b, a);
+}
+
+// Caller buffers are used in place when kernels may address them as floats
+bool IsFloatAligned(const void* data) {
+    return reinterpret_cast<uintptr_t>(data) % alignof(float) == 0;
+}
+
+// Port types are interned in the arena, so equal types share an address
+bool TypesCompatible(const Port& from, const Port& to) {
+    return from.dataType.data() == to.dataType.data() || from.dataType == "any" || to.dataType == "any";
+}
+
+bool IsFloatPort(const Port& port) {
+    return port.dataType == "any" || port.dataType == "float" || port.dataType == "float32" || port.dataType == "tensor";
+}
+}
 
 AIModel::AIModel()
     : onModelChange_(nullptr),
-      executing_(false),
       numThreads_(1),
       progressCallback_(nullptr) {
+    // Every model gets its own client on the shared pool until told otherwise
+    static std::atomic<int> nextModelIndex{0};
+    clientOptions_.name = "model-" + std::to_string(nextModelIndex.fetch_add(1));
+    executor_ = &ExecutorService::Shared();
+    clientId_ = executor_->RegisterClient(clientOptions_);
+
+    MetricsRegistry& metrics = MetricsRegistry::Global();
+    runsStartedMetric_ = &metrics.GetCounter("aishow_runs_started_total", "Execution runs started");
+    runsCompletedMetric_ = &metrics.GetCounter("aishow_runs_completed_total", "Execution runs that finished every node");
+    utilizationMetric_ = &metrics.GetGauge("aishow_worker_utilization", "Busy fraction of the worker pool over the last run");
 }
 
 AIModel::~AIModel() {
     StopExecution();
+    CancelAllRuns();
+    executor_->UnregisterClient(clientId_);
+}
+
+void AIModel::SetExecutor(ExecutorService& executor) {
+    StopExecution();
+    CancelAllRuns();
+    executor_->UnregisterClient(clientId_);
+    executor_ = &executor;
+    clientId_ = executor_->RegisterClient(clientOptions_);
+}
+
+void AIModel::SetSchedulingWeight(double weight) {
+    clientOptions_.weight = weight;
+    executor_->SetWeight(clientId_, weight);
 }
 
 void AIModel::LoadFromFile(const std::string& filename) {
-    std::ifstream file(filename);
+    PROFILE_ZONE("AIModel::LoadFromFile");
+    MemoryScope memScope(MemTag::Model);
+    ModelSnapshot snapshot;
+    if (!ParseFile(filename, snapshot)) return;
+
+    RebuildFromSnapshot(snapshot);
+    NotifyModelChange();
+}
+
+bool AIModel::ParseFile(const std::string& filename, ModelSnapshot& snapshot) {
+    PROFILE_ZONE("AIModel::ParseFile");
+    MemoryScope memScope(MemTag::Model);
+    std::ifstream file(filename, std::ios::binary);
     if (!file.is_open()) {
         std::cerr << "Failed to open file: " << filename << std::endl;
-        return;
+        return false;
     }
 
-    nodes_.clear();
-    edges_.clear();
-    allPorts_.clear();
-    portIndex_.clear();
-    nextPortId_ = 1000;
-    nextEdgeId_ = 2000;
+    // Read the whole file at once and parse it in place with string views;
+    // per-line streams and strings dominate load time on large models
+    file.seekg(0, std::ios::end);
+    std::string contents(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0, std::ios::beg);
+    file.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+
+    snapshot.nodes.clear();
+    snapshot.connections.clear();
+    snapshot.edgeMetadata.clear();
+    snapshot.strings->Release();
 
-    std::string line;
     bool parsingNodes = false;
     bool parsingConnections = false;
+    bool parsingParameters = false;
+    bool parsingEdgeMetadata = false;
+    // (nodeId, key, value) rows; attached to their nodes once every node is known
+    std::vector<std::tuple<int, std::string_view, std::string_view>> parameters;
+
+    std::string_view remaining(contents);
+    while (!remaining.empty()) {
+        size_t lineEnd = remaining.find('\n');
+        std::string_view line = remaining.substr(0, lineEnd);
+        remaining.remove_prefix(lineEnd == std::string_view::npos ? remaining.size() : lineEnd + 1);
 
-    while (std::getline(file, line)) {
         // Trim whitespace
-        if (line.empty() || line[0] == '\n') continue;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
 
-        if (line.find("Nodes:") != std::string::npos) {
+        if (line.find("Nodes:") != std::string_view::npos) {
             parsingNodes = true;
             parsingConnections = false;
+            parsingParameters = false;
+            parsingEdgeMetadata = false;
             continue;
         }
-        if (line.find("Connections:") != std::string::npos) {
+        if (line.find("Connections:") != std::string_view::npos) {
             parsingNodes = false;
             parsingConnections = true;
+            parsingParameters = false;
+            parsingEdgeMetadata = false;
+            continue;
+        }
+        if (line.find("EdgeMetadata:") != std::string_view::npos) {
+            parsingNodes = false;
+            parsingConnections = false;
+            parsingParameters = false;
+            parsingEdgeMetadata = true;
+            continue;
+        }
+        if (line.find("Parameters:") != std::string_view::npos) {
+            parsingNodes = false;
+            parsingConnections = false;
+            parsingParameters = true;
+            parsingEdgeMetadata = false;
             continue;
         }
 
         if (parsingNodes) {
             // Parse: nodeId,nodeType,nodeName
             int nodeId;
-            std::string nodeType, nodeName;
-            char comma;
-            std::istringstream iss(line);
-            iss >> nodeId >> comma >> nodeType >> comma;
-            std::getline(iss, nodeName);
+            if (!ParseIntField(line, nodeId)) continue;
+            size_t comma = line.find(',');
+            if (comma == std::string_view::npos) continue;
+            std::string_view nodeType = line.substr(0, comma);
+            std::string_view nodeName = line.substr(comma + 1);
 
             if (nodeName.empty()) continue;
 
             AINode node;
             node.id = nodeId;
-            node.type = nodeType;
-            node.name = nodeName;
+            node.type = snapshot.strings->Intern(nodeType);
+            node.name = snapshot.strings->Intern(nodeName);
             node.boundUINodeId = -1;
-
-            // Create default input/output ports for the node
-            Port inputPort;
-            inputPort.id = GetNextPortId();
-            inputPort.name = "input";
-            inputPort.dataType = "any";
-            inputPort.isInput = true;
-            inputPort.nodeId = nodeId;
-            node.inputPorts.push_back(inputPort);
-            allPorts_.push_back(inputPort);
-            portIndex_[inputPort.id] = allPorts_.size() - 1;
-
-            Port outputPort;
-            outputPort.id = GetNextPortId();
-            outputPort.name = "output";
-            outputPort.dataType = "any";
-            outputPort.isInput = false;
-            outputPort.nodeId = nodeId;
-            node.outputPorts.push_back(outputPort);
-            allPorts_.push_back(outputPort);
-            portIndex_[outputPort.id] = allPorts_.size() - 1;
-
-            nodes_.push_back(node);
+            snapshot.nodes.push_back(std::move(node));
         }
         else if (parsingConnections) {
             // Parse: fromNodeId,toNodeId,fromPortIndex,toPortIndex
             int fromNodeId, toNodeId, fromPortIdx, toPortIdx;
-            char comma;
-            std::istringstream iss(line);
-            iss >> fromNodeId >> comma >> toNodeId >> comma >> fromPortIdx >> comma >> toPortIdx;
-
-            // Find the ports
-            const Port* fromPort = nullptr;
-            const Port* toPort = nullptr;
-
-            // Find nodes
-            AINode* fromNode = nullptr;
-            AINode* toNode = nullptr;
-            for (auto& node : nodes_) {
-                if (node.id == fromNodeId) fromNode = &node;
-                if (node.id == toNodeId) toNode = &node;
+            if (ParseIntField(line, fromNodeId) && ParseIntField(line, toNodeId) &&
+                ParseIntField(line, fromPortIdx) && ParseIntField(line, toPortIdx)) {
+                snapshot.connections.emplace_back(fromNodeId, toNodeId, fromPortIdx, toPortIdx);
             }
+        }
+        else if (parsingParameters) {
+            // Parse: nodeId,key,value
+            int nodeId;
+            if (!ParseIntField(line, nodeId)) continue;
+            size_t comma = line.find(',');
+            if (comma == std::string_view::npos || comma == 0) continue;
+            parameters.emplace_back(nodeId, snapshot.strings->Intern(line.substr(0, comma)),
+                                    snapshot.strings->Intern(line.substr(comma + 1)));
+        }
+        else if (parsingEdgeMetadata) {
+            // Parse: fromNodeId,toNodeId,key,value
+            int fromNodeId, toNodeId;
+            if (!ParseIntField(line, fromNodeId) || !ParseIntField(line, toNodeId)) continue;
+            size_t comma = line.find(',');
+            if (comma == std::string_view::npos || comma == 0) continue;
+            snapshot.edgeMetadata.emplace_back(fromNodeId, toNodeId, snapshot.strings->Intern(line.substr(0, comma)),
+                                               snapshot.strings->Intern(line.substr(comma + 1)));
+        }
+    }
 
-            if (!fromNode || !toNode) continue;
-            
-            // Get the output port from source node
-            if (fromPortIdx < fromNode->outputPorts.size()) {
-                fromPort = &fromNode->outputPorts[fromPortIdx];
-            }
-            
-            // Get the input port from target node
-            if (toPortIdx < toNode->inputPorts.size()) {
-                toPort = &toNode->inputPorts[toPortIdx];
-            }
+    if (!parameters.empty()) {
+        std::vector<std::pair<int, size_t>> nodeLookup;
+        nodeLookup.reserve(snapshot.nodes.size());
+        for (size_t i = 0; i < snapshot.nodes.size(); ++i) nodeLookup.emplace_back(snapshot.nodes[i].id, i);
+        std::sort(nodeLookup.begin(), nodeLookup.end());
+        for (const auto& param : parameters) {
+            auto it = std::lower_bound(nodeLookup.begin(), nodeLookup.end(), std::make_pair(std::get<0>(param), size_t(0)));
+            if (it == nodeLookup.end() || it->first != std::get<0>(param)) continue;
+            snapshot.nodes[it->second].parameters.emplace_back(std::get<1>(param), std::get<2>(param));
+        }
+    }
+
+    return true;
+}
+
+void AIModel::ClearGraph() {
+    // Hand every block back to the arena, then drop its chunks in one go
+    std::pmr::vector<AINode>(&arena_).swap(nodes_);
+    std::pmr::vector<Edge>(&arena_).swap(edges_);
+    std::pmr::vector<Port>(&arena_).swap(allPorts_);
+    std::pmr::unordered_map<int, int>(&arena_).swap(portIndex_);
+    arena_.Release();
+    order_.Clear();
+    nextPortId_ = 1000;
+    nextEdgeId_ = 2000;
+}
+
+void AIModel::RebuildFromSnapshot(const ModelSnapshot& snapshot) {
+    PROFILE_ZONE("AIModel::RebuildFromSnapshot");
+    ClearGraph();
+
+    // Size everything up front so the bulk load is a few chunk allocations
+    nodes_.reserve(snapshot.nodes.size());
+    edges_.reserve(snapshot.connections.size());
+    allPorts_.reserve(snapshot.nodes.size() * 2);
+    portIndex_.reserve(snapshot.nodes.size() * 2);
+
+    for (const auto& parsed : snapshot.nodes) {
+        AINode node = CopyIntoArena(parsed);
+        AddPortsForNode(node);
+        order_.AddNode(node.id);
+        nodes_.push_back(std::move(node));
+    }
+
+    // Sorted (id, index) pairs resolve connection endpoints without a per-node allocation
+    std::vector<std::pair<int, size_t>> nodeLookup;
+    nodeLookup.reserve(nodes_.size());
+    for (size_t i = 0; i < nodes_.size(); ++i) nodeLookup.emplace_back(nodes_[i].id, i);
+    std::sort(nodeLookup.begin(), nodeLookup.end());
+    auto lookupNode = [&](int nodeId) -> const AINode* {
+        auto it = std::lower_bound(nodeLookup.begin(), nodeLookup.end(), std::make_pair(nodeId, size_t(0)));
+        return (it != nodeLookup.end() && it->first == nodeId) ? &nodes_[it->second] : nullptr;
+    };
+
+    std::vector<std::pair<int, int>> dependencies;     // Node ids per edge in edges_
+    dependencies.reserve(snapshot.connections.size());
+    for (const auto& conn : snapshot.connections) {
+        int fromNodeId, toNodeId, fromPortIdx, toPortIdx;
+        std::tie(fromNodeId, toNodeId, fromPortIdx, toPortIdx) = conn;
+
+        // Find nodes
+        const AINode* fromNode = lookupNode(fromNodeId);
+        const AINode* toNode = lookupNode(toNodeId);
+        if (!fromNode || !toNode) continue;
+
+        // Get the output port from source node and the input port from target node
+        if (fromPortIdx < 0 || fromPortIdx >= static_cast<int>(fromNode->outputPorts.size())) continue;
+        if (toPortIdx < 0 || toPortIdx >= static_cast<int>(toNode->inputPorts.size())) continue;
+
+        Edge edge{GetNextEdgeId(), fromNode->outputPorts[fromPortIdx].id, toNode->inputPorts[toPortIdx].id,
+                  "any", decltype(Edge::metadata)(&arena_)}; // Default data type
+        edges_.push_back(std::move(edge));
+        dependencies.emplace_back(fromNodeId, toNodeId);
+    }
 
-            if (fromPort && toPort) {
-                Edge edge;
-                edge.id = GetNextEdgeId();
-                edge.fromPortId = fromPort->id;
-                edge.toPortId = toPort->id;
-                edge.dataType = "any"; // Default data type
-                edges_.push_back(edge);
+    // One Kahn pass orders an acyclic file. Otherwise name the cycles and
+    // keep the edges in file order that do not close one, as AddEdge would.
+    if (!order_.AddEdges(dependencies)) {
+        std::vector<int> nodeIds;
+        nodeIds.reserve(nodes_.size());
+        for (const auto& node : nodes_) nodeIds.push_back(node.id);
+        for (const auto& cycle : GraphOrder::FindCycles(nodeIds, dependencies)) {
+            std::cerr << "AIModel: cycle through " << DescribePath(cycle) << std::endl;
+        }
+        size_t kept = 0;
+        std::vector<int> cycle;
+        for (size_t i = 0; i < edges_.size(); ++i) {
+            if (order_.AddEdge(dependencies[i].first, dependencies[i].second, &cycle)) {
+                if (kept != i) edges_[kept] = std::move(edges_[i]);
+                ++kept;
+            } else {
+                std::cerr << "AIModel: dropped connection " << dependencies[i].first << " -> " << dependencies[i].second
+                          << ", it closes " << DescribePath(cycle) << std::endl;
             }
         }
+        edges_.erase(edges_.begin() + static_cast<std::ptrdiff_t>(kept), edges_.end());
     }
 
-    file.close();
+    for (const auto& row : snapshot.edgeMetadata) {
+        WriteEdgeMetadata(std::get<0>(row), std::get<1>(row), std::get<2>(row), std::get<3>(row));
+    }
+}
+
+AINode AIModel::CopyIntoArena(const AINode& node) {
+    AINode copy{node.id, arena_.Intern(node.type), arena_.Intern(node.name),
+                decltype(AINode::parameters)(&arena_), decltype(AINode::inputPorts)(&arena_),
+                decltype(AINode::outputPorts)(&arena_), node.boundUINodeId};
+    copy.parameters.reserve(node.parameters.size());
+    for (const auto& param : node.parameters) {
+        copy.parameters.emplace_back(arena_.Intern(param.first), arena_.Intern(param.second));
+    }
+    copy.inputPorts.reserve(node.inputPorts.size());
+    for (const auto& port : node.inputPorts) copy.inputPorts.push_back(CopyIntoArena(port));
+    copy.outputPorts.reserve(node.outputPorts.size());
+    for (const auto& port : node.outputPorts) copy.outputPorts.push_back(CopyIntoArena(port));
+    return copy;
+}
+
+Port AIModel::CopyIntoArena(const Port& port) {
+    Port copy = port;
+    copy.name = arena_.Intern(port.name);
+    copy.dataType = arena_.Intern(port.dataType);
+    return copy;
+}
+
+Edge AIModel::CopyIntoArena(const Edge& edge) {
+    Edge copy{edge.id, edge.fromPortId, edge.toPortId, arena_.Intern(edge.dataType),
+              decltype(Edge::metadata)(&arena_)};
+    copy.metadata.reserve(edge.metadata.size());
+    for (const auto& entry : edge.metadata) {
+        copy.metadata.emplace_back(arena_.Intern(entry.first), arena_.Intern(entry.second));
+    }
+    return copy;
+}
+
+ModelDelta AIModel::Diff(const ModelSnapshot& snapshot) const {
+    PROFILE_ZONE("AIModel::Diff");
+    MemoryScope memScope(MemTag::Model);
+    ModelDelta delta;
+
+    std::unordered_map<int, const AINode*> current;
+    for (const auto& node : nodes_) current[node.id] = &node;
+
+    std::unordered_set<int> seen;
+    for (const auto& node : snapshot.nodes) {
+        seen.insert(node.id);
+        auto it = current.find(node.id);
+        if (it == current.end()) {
+            delta.addedNodes.push_back(node);
+        } else if (it->second->type != node.type || it->second->name != node.name ||
+                   !SameParameters(*it->second, node)) {
+            delta.updatedNodes.push_back(node);
+        }
+    }
+    for (const auto& node : nodes_) {
+        if (!seen.count(node.id)) delta.removedNodeIds.push_back(node.id);
+    }
+
+    // Connections are compared as sorted multisets of legacy tuples
+    auto oldConnections = GetConnectionsLegacy();
+    auto newConnections = snapshot.connections;
+    std::sort(oldConnections.begin(), oldConnections.end());
+    std::sort(newConnections.begin(), newConnections.end());
+    std::set_difference(newConnections.begin(), newConnections.end(),
+                        oldConnections.begin(), oldConnections.end(),
+                        std::back_inserter(delta.addedConnections));
+    std::set_difference(oldConnections.begin(), oldConnections.end(),
+                        newConnections.begin(), newConnections.end(),
+                        std::back_inserter(delta.removedConnections));
+
+    // Connections touching removed nodes disappear with the node itself
+    std::unordered_set<int> removed(delta.removedNodeIds.begin(), delta.removedNodeIds.end());
+    delta.removedConnections.erase(std::remove_if(delta.removedConnections.begin(), delta.removedConnections.end(),
+        [&removed](const std::tuple<int, int, int, int>& c) {
+            return removed.count(std::get<0>(c)) || removed.count(std::get<1>(c));
+        }), delta.removedConnections.end());
+
+    // Edge metadata is small; any difference replaces all of it
+    auto newMetadata = snapshot.edgeMetadata;
+    std::sort(newMetadata.begin(), newMetadata.end());
+    newMetadata.erase(std::unique(newMetadata.begin(), newMetadata.end()), newMetadata.end());
+    if (newMetadata != EdgeMetadataRows()) {
+        delta.edgeMetadataChanged = true;
+        delta.edgeMetadata = std::move(newMetadata);
+    }
+
+    return delta;
+}
+
+void AIModel::ApplyDelta(const ModelDelta& delta) {
+    PROFILE_ZONE("AIModel::ApplyDelta");
+    MemoryScope memScope(MemTag::Model);
+    BeginBatch();
+
+    for (const auto& conn : delta.removedConnections) {
+        const AINode* fromNode = FindNode(std::get<0>(conn));
+        const AINode* toNode = FindNode(std::get<1>(conn));
+        if (!fromNode || !toNode) continue;
+        const int fromIdx = std::get<2>(conn);
+        const int toIdx = std::get<3>(conn);
+        if (fromIdx < 0 || fromIdx >= static_cast<int>(fromNode->outputPorts.size())) continue;
+        if (toIdx < 0 || toIdx >= static_cast<int>(toNode->inputPorts.size())) continue;
+
+        const int fromPortId = fromNode->outputPorts[fromIdx].id;
+        const int toPortId = toNode->inputPorts[toIdx].id;
+        auto it = std::find_if(edges_.begin(), edges_.end(), [&](const Edge& edge) {
+            return edge.fromPortId == fromPortId && edge.toPortId == toPortId;
+        });
+        if (it != edges_.end()) RemoveEdge(it->id);
+    }
+
+    for (int nodeId : delta.removedNodeIds) {
+        RemoveNode(nodeId);
+    }
+
+    // Updates replace the type, name and parameters with the file's, so a
+    // parameter deleted there stops applying; ports and edges stay
+    for (const auto& updated : delta.updatedNodes) {
+        AINode* node = FindNode(updated.id);
+        if (!node) continue;
+        node->type = arena_.Intern(updated.type);
+        node->name = arena_.Intern(updated.name);
+        node->parameters.clear();
+        for (const auto& param : updated.parameters) {
+            node->parameters.emplace_back(arena_.Intern(param.first), arena_.Intern(param.second));
+        }
+        batchDirty_ = true;
+    }
+
+    for (const auto& added : delta.addedNodes) {
+        AddNode(added);
+    }
+
+    for (const auto& conn : delta.addedConnections) {
+        AddConnection(std::get<0>(conn), std::get<1>(conn), std::get<2>(conn), std::get<3>(conn));
+    }
+
+    if (delta.edgeMetadataChanged) {
+        for (auto& edge : edges_) edge.metadata.clear();
+        for (const auto& row : delta.edgeMetadata) {
+            WriteEdgeMetadata(std::get<0>(row), std::get<1>(row), std::get<2>(row), std::get<3>(row));
+        }
+        batchDirty_ = true;
+    }
+
+    EndBatch();
+}
+
+void AIModel::EndBatch() {
+    if (batchDepth_ > 0 && --batchDepth_ == 0 && batchDirty_) {
+        batchDirty_ = false;
+        NotifyModelChange();
+    }
+}
+
+void AIModel::NotifyModelChange() {
+    costsDirty_ = true;
+    planDirty_ = true;
+    if (batchDepth_ > 0) {
+        batchDirty_ = true;
+        return;
+    }
+    CompactStringsIfIdle();
     if (onModelChange_) onModelChange_();
 }
 
+void AIModel::CompactStringsIfIdle() {
+    // Runs and replay read node strings from other threads, so old values
+    // stay until none is in flight; StopExecution, CancelAllRuns or the next
+    // change compacts after that
+    if (!arena_.StringsNeedCompaction() || batchDepth_ > 0 || replaying_) return;
+    {
+        std::lock_guard<std::mutex> lock(runsMutex_);
+        if (!activeRuns_.empty()) return;
+    }
+    CompactStrings();
+}
+
+void AIModel::CompactStrings() {
+    PROFILE_ZONE("AIModel::CompactStrings");
+    MemoryScope memScope(MemTag::Model);
+    arena_.BeginCompaction();
+    auto keep = [this](std::string_view& text) { text = arena_.Intern(text); };
+    auto keepPort = [&](Port& port) {
+        keep(port.name);
+        keep(port.dataType);
+    };
+    for (AINode& node : nodes_) {
+        keep(node.type);
+        keep(node.name);
+        for (auto& param : node.parameters) {
+            keep(param.first);
+            keep(param.second);
+        }
+        for (Port& port : node.inputPorts) keepPort(port);
+        for (Port& port : node.outputPorts) keepPort(port);
+    }
+    for (Port& port : allPorts_) keepPort(port);
+    for (Edge& edge : edges_) {
+        keep(edge.dataType);
+        for (auto& entry : edge.metadata) {
+            keep(entry.first);
+            keep(entry.second);
+        }
+    }
+    arena_.EndCompaction();
+}
+
+AINode* AIModel::FindNode(int nodeId) {
+    auto it = std::find_if(nodes_.begin(), nodes_.end(),
+        [nodeId](const AINode& node) { return node.id == nodeId; });
+    return it != nodes_.end() ? &*it : nullptr;
+}
+
 void AIModel::SaveToFile(const std::string& filename) {
+    PROFILE_ZONE("AIModel::SaveToFile");
     std::ofstream file(filename);
     if (!file.is_open()) {
         std::cerr << "Failed to open file: " << filename << std::endl;
@@ -183,59 +572,81 @@ void AIModel::SaveToFile(const std::string& filename) {
                  << fromPortIdx << "," << toPortIdx << "\n";
         }
     }
+
+    // Save node parameters (shapes and layer settings used by the cost model)
+    file << "Parameters:\n";
+    for (const auto& node : nodes_) {
+        for (const auto& param : node.parameters) {
+            file << node.id << "," << param.first << "," << param.second << "\n";
+        }
+    }
+
+    // Edge metadata (branch conditions); only written when there is any
+    const auto edgeMetadata = EdgeMetadataRows();
+    if (!edgeMetadata.empty()) {
+        file << "EdgeMetadata:\n";
+        for (const auto& row : edgeMetadata) {
+            file << std::get<0>(row) << "," << std::get<1>(row) << "," << std::get<2>(row) << "," << std::get<3>(row) << "\n";
+        }
+    }
     
     file.close();
 }
 
 void AIModel::AddNode(const AINode& node) {
-    AINode newNode = node;
-    
+    MemoryScope memScope(MemTag::Model);
+    AINode newNode = CopyIntoArena(node);
+    AddPortsForNode(newNode);
+    order_.AddNode(newNode.id);
+    nodes_.push_back(std::move(newNode));
+    NotifyModelChange();
+}
+
+void AIModel::AddPortsForNode(AINode& node) {
     // If the node doesn't have ports, create default ones
-    if (newNode.inputPorts.empty()) {
+    if (node.inputPorts.empty()) {
         Port inputPort;
         inputPort.id = GetNextPortId();
         inputPort.name = "input";
-        inputPort.dataType = "any";
+        inputPort.dataType = arena_.Intern("any");
         inputPort.isInput = true;
-        inputPort.nodeId = newNode.id;
-        newNode.inputPorts.push_back(inputPort);
+        inputPort.nodeId = node.id;
+        node.inputPorts.push_back(inputPort);
         allPorts_.push_back(inputPort);
         portIndex_[inputPort.id] = allPorts_.size() - 1;
     } else {
         // Register existing ports
-        for (auto& port : newNode.inputPorts) {
+        for (auto& port : node.inputPorts) {
             if (port.id <= 0) port.id = GetNextPortId();
-            port.nodeId = newNode.id;
+            port.nodeId = node.id;
             allPorts_.push_back(port);
             portIndex_[port.id] = allPorts_.size() - 1;
         }
     }
-    
-    if (newNode.outputPorts.empty()) {
+
+    if (node.outputPorts.empty()) {
         Port outputPort;
         outputPort.id = GetNextPortId();
         outputPort.name = "output";
-        outputPort.dataType = "any";
+        outputPort.dataType = arena_.Intern("any");
         outputPort.isInput = false;
-        outputPort.nodeId = newNode.id;
-        newNode.outputPorts.push_back(outputPort);
+        outputPort.nodeId = node.id;
+        node.outputPorts.push_back(outputPort);
         allPorts_.push_back(outputPort);
         portIndex_[outputPort.id] = allPorts_.size() - 1;
     } else {
         // Register existing ports
-        for (auto& port : newNode.outputPorts) {
+        for (auto& port : node.outputPorts) {
             if (port.id <= 0) port.id = GetNextPortId();
-            port.nodeId = newNode.id;
+            port.nodeId = node.id;
             allPorts_.push_back(port);
             portIndex_[port.id] = allPorts_.size() - 1;
         }
     }
-    
-    nodes_.push_back(newNode);
-    if (onModelChange_) onModelChange_();
 }
 
 void AIModel::RemoveNode(int nodeId) {
+    MemoryScope memScope(MemTag::Model);
     // Remove all edges connected to this node
     edges_.erase(std::remove_if(edges_.begin(), edges_.end(),
         [this, nodeId](const Edge& edge) {
@@ -244,6 +655,8 @@ void AIModel::RemoveNode(int nodeId) {
             return (fromPort && fromPort->nodeId == nodeId) || (toPort && toPort->nodeId == nodeId);
         }), edges_.end());
 
+    order_.RemoveNode(nodeId);
+
     // Remove all ports belonging to this node
     allPorts_.erase(std::remove_if(allPorts_.begin(), allPorts_.end(),
         [nodeId](const Port& port) { return port.nodeId == nodeId; }), allPorts_.end());
@@ -258,35 +671,51 @@ void AIModel::RemoveNode(int nodeId) {
     nodes_.erase(std::remove_if(nodes_.begin(), nodes_.end(),
         [nodeId](const AINode& node) { return node.id == nodeId; }), nodes_.end());
 
-    if (onModelChange_) onModelChange_();
+    NotifyModelChange();
 }
 
 void AIModel::UpdateNode(const AINode& updatedNode) {
+    MemoryScope memScope(MemTag::Model);
     for (auto& node : nodes_) {
         if (node.id == updatedNode.id) {
-            node = updatedNode;
+            node = CopyIntoArena(updatedNode);
             break;
         }
     }
-    if (onModelChange_) onModelChange_();
+    NotifyModelChange();
 }
 
 // New Edge-based connection methods
 void AIModel::AddEdge(const Edge& edge) {
+    MemoryScope memScope(MemTag::Model);
     if (!ValidateEdge(edge)) {
         std::cerr << "AIModel::AddEdge: Invalid edge configuration" << std::endl;
         return;
     }
-    Edge newEdge = edge;
+    const int fromNodeId = GetPort(edge.fromPortId)->nodeId;
+    const int toNodeId = GetPort(edge.toPortId)->nodeId;
+    std::vector<int> cycle;
+    if (!order_.AddEdge(fromNodeId, toNodeId, &cycle)) {
+        std::cerr << "AIModel::AddEdge: " << fromNodeId << " -> " << toNodeId << " would close the cycle "
+                  << DescribePath(cycle) << std::endl;
+        return;
+    }
+    Edge newEdge = CopyIntoArena(edge);
     if (newEdge.id <= 0) newEdge.id = GetNextEdgeId();
-    edges_.push_back(newEdge);
-    if (onModelChange_) onModelChange_();
+    edges_.push_back(std::move(newEdge));
+    NotifyModelChange();
 }
 
 void AIModel::RemoveEdge(int edgeId) {
     edges_.erase(std::remove_if(edges_.begin(), edges_.end(),
-        [edgeId](const Edge& edge) { return edge.id == edgeId; }), edges_.end());
-    if (onModelChange_) onModelChange_();
+        [this, edgeId](const Edge& edge) {
+            if (edge.id != edgeId) return false;
+            const Port* fromPort = GetPort(edge.fromPortId);
+            const Port* toPort = GetPort(edge.toPortId);
+            if (fromPort && toPort) order_.RemoveEdge(fromPort->nodeId, toPort->nodeId);
+            return true;
+        }), edges_.end());
+    NotifyModelChange();
 }
 
 void AIModel::RemoveEdgesBetweenNodes(int fromNodeId, int toNodeId) {
@@ -294,10 +723,45 @@ void AIModel::RemoveEdgesBetweenNodes(int fromNodeId, int toNodeId) {
         [this, fromNodeId, toNodeId](const Edge& edge) {
             const Port* fromPort = GetPort(edge.fromPortId);
             const Port* toPort = GetPort(edge.toPortId);
-            return (fromPort && fromPort->nodeId == fromNodeId &&
-                    toPort && toPort->nodeId == toNodeId);
+            if (!fromPort || fromPort->nodeId != fromNodeId || !toPort || toPort->nodeId != toNodeId) return false;
+            order_.RemoveEdge(fromNodeId, toNodeId);
+            return true;
         }), edges_.end());
-    if (onModelChange_) onModelChange_();
+    NotifyModelChange();
+}
+
+void AIModel::SetEdgeMetadata(int fromNodeId, int toNodeId, std::string_view key, std::string_view value) {
+    MemoryScope memScope(MemTag::Model);
+    WriteEdgeMetadata(fromNodeId, toNodeId, key, value);
+    NotifyModelChange();
+}
+
+void AIModel::WriteEdgeMetadata(int fromNodeId, int toNodeId, std::string_view key, std::string_view value) {
+    for (auto& edge : edges_) {
+        const Port* fromPort = GetPort(edge.fromPortId);
+        const Port* toPort = GetPort(edge.toPortId);
+        if (!fromPort || fromPort->nodeId != fromNodeId || !toPort || toPort->nodeId != toNodeId) continue;
+        auto it = std::find_if(edge.metadata.begin(), edge.metadata.end(),
+            [key](const auto& entry) { return entry.first == key; });
+        if (it != edge.metadata.end()) {
+            it->second = arena_.Intern(value);
+        } else {
+            edge.metadata.emplace_back(arena_.Intern(key), arena_.Intern(value));
+        }
+    }
+}
+
+std::vector<std::tuple<int, int, std::string_view, std::string_view>> AIModel::EdgeMetadataRows() const {
+    std::vector<std::tuple<int, int, std::string_view, std::string_view>> rows;
+    for (const auto& edge : edges_) {
+        const Port* fromPort = GetPort(edge.fromPortId);
+        const Port* toPort = GetPort(edge.toPortId);
+        if (!fromPort || !toPort) continue;
+        for (const auto& entry : edge.metadata) rows.emplace_back(fromPort->nodeId, toPort->nodeId, entry.first, entry.second);
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    return rows;
 }
 
 // Port lookup methods
@@ -333,36 +797,59 @@ std::vector<const Port*> AIModel::GetNodeOutputPorts(int nodeId) const {
 }
 
 // Edge validation
-bool AIModel::ValidateEdge(const Edge& edge) const {
+const char* AIModel::EdgeProblem(const Edge& edge) const {
     const Port* fromPort = GetPort(edge.fromPortId);
     const Port* toPort = GetPort(edge.toPortId);
-    
-    if (!fromPort || !toPort) {
-        std::cerr << "ValidateEdge: Port not found" << std::endl;
-        return false;
-    }
-    
+    if (!fromPort || !toPort) return "Port not found";
     // fromPort must be output, toPort must be input
-    if (fromPort->isInput || !toPort->isInput) {
-        std::cerr << "ValidateEdge: Invalid port directions" << std::endl;
-        return false;
+    if (fromPort->isInput || !toPort->isInput) return "Invalid port directions";
+    if (fromPort->nodeId == toPort->nodeId) return "Cannot connect port to same node";
+    // Data types should match (if both are not "any")
+    if (!TypesCompatible(*fromPort, *toPort)) return "Data type mismatch";
+    return nullptr;
+}
+
+bool AIModel::ValidateEdge(const Edge& edge) const {
+    const char* problem = EdgeProblem(edge);
+    if (!problem) return true;
+    std::cerr << "ValidateEdge: " << problem;
+    const Port* fromPort = GetPort(edge.fromPortId);
+    const Port* toPort = GetPort(edge.toPortId);
+    if (fromPort && toPort) std::cerr << " (" << fromPort->dataType << " -> " << toPort->dataType << ")";
+    std::cerr << std::endl;
+    return false;
+}
+
+std::vector<std::string> AIModel::Validate() const {
+    PROFILE_ZONE("AIModel::Validate");
+    std::vector<std::string> problems;
+    std::vector<std::pair<int, int>> dependencies;
+    dependencies.reserve(edges_.size());
+    for (const auto& edge : edges_) {
+        if (const char* problem = EdgeProblem(edge)) {
+            problems.push_back("edge " + std::to_string(edge.id) + ": " + problem);
+            continue;
+        }
+        dependencies.emplace_back(GetPort(edge.fromPortId)->nodeId, GetPort(edge.toPortId)->nodeId);
     }
-    
-    // Cannot connect port to itself
-    if (fromPort->nodeId == toPort->nodeId) {
-        std::cerr << "ValidateEdge: Cannot connect port to same node" << std::endl;
-        return false;
+
+    std::vector<int> nodeIds;
+    nodeIds.reserve(nodes_.size());
+    for (const auto& node : nodes_) nodeIds.push_back(node.id);
+    for (const auto& cycle : GraphOrder::FindCycles(nodeIds, dependencies)) {
+        problems.push_back("cycle through " + DescribePath(cycle));
     }
-    
-    // Data types should match (if both are not "any")
-    if (fromPort->dataType != "any" && toPort->dataType != "any" &&
-        fromPort->dataType != toPort->dataType) {
-        std::cerr << "ValidateEdge: Data type mismatch: "
-                  << fromPort->dataType << " != " << toPort->dataType << std::endl;
-        return false;
+    return problems;
+}
+
+std::string AIModel::DescribePath(const std::vector<int>& nodeIds) const {
+    std::string text;
+    for (int nodeId : nodeIds) {
+        if (!text.empty()) text += " -> ";
+        auto it = std::find_if(nodes_.begin(), nodes_.end(), [nodeId](const AINode& node) { return node.id == nodeId; });
+        text += it != nodes_.end() ? std::string(it->name) + "(" + std::to_string(nodeId) + ")" : std::to_string(nodeId);
     }
-    
-    return true;
+    return text;
 }
 
 // Backward compatibility: return edges in old tuple format
@@ -427,205 +914,594 @@ void AIModel::RemoveConnection(int fromNode, int toNode) {
     RemoveEdgesBetweenNodes(fromNode, toNode);
 }
 
-void AIModel::StartExecution(int numThreads) {
-    // If there are leftover worker threads from a previous run, join them first
-    if (!workerThreads_.empty()) {
-        for (auto& t : workerThreads_) {
-            if (t.joinable()) {
-                t.join();
-            }
-        }
-        workerThreads_.clear();
-    }
-
-    if (executing_) return;
-
+void AIModel::SetExecutionConfig(int numThreads) {
     numThreads_ = numThreads;
-    executing_ = true;
+    clientOptions_.maxConcurrency = numThreads;
+    executor_->SetMaxConcurrency(clientId_, numThreads_);
+}
 
-    // Build dependency graph (adjacency_ and indegree_)
-    adjacency_.clear();
-    indegree_.clear();
+RunHandle AIModel::StartExecution(int numThreads) {
+    PROFILE_ZONE("AIModel::StartExecution");
+    MemoryScope memScope(MemTag::Execution);
+    if (IsExecuting()) return RunHandle();
+    StopReplay();
+
+    SetExecutionConfig(numThreads);
+    currentRun_ = LaunchRun(true, {});
+    if (!currentRun_) {
+        std::cerr << "AIModel::StartExecution: graph cannot be executed. Aborting execution." << std::endl;
+        return RunHandle();
+    }
 
-    // Initialize indegree for all nodes
-    for (const auto& node : nodes_) {
-        indegree_[node.id] = 0;
+    std::cout << "Started AI model execution with up to " << numThreads_ << " concurrent nodes on a pool of "
+              << executor_->NumWorkers() << " workers" << std::endl;
+    return RunHandle(currentRun_);
+}
+
+void AIModel::StopExecution() {
+    const bool wasExecuting = IsExecuting();
+    StopReplay();
+    if (currentRun_) {
+        currentRun_->Cancel();
+        currentRun_->Wait();
     }
+    if (wasExecuting) std::cout << "Stopped AI model execution" << std::endl;
+    CompactStringsIfIdle();
+}
 
-    // Build graph from edges
-    for (const auto& edge : edges_) {
-        const Port* fromPort = GetPort(edge.fromPortId);
-        const Port* toPort = GetPort(edge.toPortId);
-        
-        if (fromPort && toPort) {
-            int from = fromPort->nodeId;
-            int to = toPort->nodeId;
-            adjacency_[from].push_back(to);
-            // ensure keys exist
-            if (indegree_.find(to) == indegree_.end()) indegree_[to] = 0;
-            if (indegree_.find(from) == indegree_.end()) indegree_[from] = 0;
-            indegree_[to]++;
-        }
+std::shared_ptr<const ExecutionPlan> AIModel::GetPlan() {
+    if (planDirty_) {
+        plan_ = ExecutionPlan::Compile(*this, GetNodeCosts());
+        planDirty_ = false;
     }
+    return plan_;
+}
 
-    // Initialize ready queue with nodes that have indegree == 0
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        while (!readyQueue_.empty()) readyQueue_.pop();
-        for (const auto& p : indegree_) {
-            if (p.second == 0) readyQueue_.push(p.first);
-        }
+bool AIModel::DefineSubgraph(const std::string& name, AIModel& body) {
+    std::shared_ptr<const ExecutionPlan> plan = body.GetPlan();
+    if (!plan || !plan->IsSingleEntrySink()) {
+        std::cerr << "AIModel::DefineSubgraph: '" << name << "' needs a runnable body with one entry and one sink node" << std::endl;
+        return false;
     }
+    subgraphs_[name] = std::move(plan);
+    NotifyModelChange();
+    return true;
+}
 
-    // If no ready nodes but there are nodes, there may be a cycle -> abort execution
-    if (nodes_.size() > 0) {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        if (readyQueue_.empty()) {
-            std::cerr << "AIModel::StartExecution: no entry nodes (possible cycle). Aborting execution." << std::endl;
-            executing_ = false;
-            return;
-        }
+std::shared_ptr<const ExecutionPlan> AIModel::GetSubgraph(std::string_view name) const {
+    auto it = subgraphs_.find(std::string(name));
+    return it != subgraphs_.end() ? it->second : nullptr;
+}
+
+void AIModel::SetKernelTuner(KernelTuner* tuner) {
+    kernelTuner_ = tuner;
+    planDirty_ = true;
+}
+
+bool AIModel::SetPrecisionPolicy(const PrecisionPolicy& policy) {
+    if (policy.activations != Precision::FP32 && !IsHalf(policy.activations)) {
+        std::cerr << "AIModel::SetPrecisionPolicy: activations cannot be stored as "
+                  << PrecisionName(policy.activations) << std::endl;
+        return false;
     }
+    precisionPolicy_ = policy;
+    costsDirty_ = true;
+    planDirty_ = true;
+    return true;
+}
+
+std::shared_ptr<RunContext> AIModel::StartRun(RunInputs inputs) {
+    return LaunchRun(false, std::move(inputs));
+}
 
-    remainingNodes_.store(static_cast<int>(nodes_.size()));
+RunHandle AIModel::SubmitRun(RunInputs inputs) {
+    return RunHandle(LaunchRun(false, std::move(inputs)));
+}
 
-    // Start worker threads
-    for (int i = 0; i < numThreads_; ++i) {
-        workerThreads_.emplace_back(&AIModel::ExecutionLoop, this);
+RunHandle AIModel::SubmitRun(const RunBindings& bindings) {
+    RunInputs inputs;
+    for (const RunBindings::Binding& binding : bindings.Inputs()) {
+        const Port* port = FindBoundPort(binding, true);
+        if (!port) return RunHandle();
+        if (!binding.input || binding.shape.Elements() <= 0 || inputs.count(port->nodeId)) {
+            std::cerr << "SubmitRun: missing or duplicate input for node " << port->nodeId << std::endl;
+            return RunHandle();
+        }
+        if (IsFloatAligned(binding.input)) {
+            inputs[port->nodeId] = Tensor::View(binding.shape, binding.input);
+        } else {
+            Tensor copy(binding.shape);
+            std::memcpy(copy.Data(), binding.input, copy.Size() * sizeof(float));
+            inputs[port->nodeId] = std::move(copy);
+        }
     }
 
-    std::cout << "Started AI model execution with " << numThreads_ << " threads" << std::endl;
+    RunOutputs outputs;
+    std::vector<int> targets;
+    for (const RunBindings::Binding& binding : bindings.Outputs()) {
+        const Port* port = FindBoundPort(binding, false);
+        if (!port) return RunHandle();
+        if (binding.output) outputs[port->nodeId] = OutputBuffer{binding.output, binding.capacity};
+        targets.push_back(port->nodeId);
+    }
+    return RunHandle(LaunchRun(false, std::move(inputs), std::move(outputs), targets));
 }
 
-void AIModel::StopExecution() {
-    // Always join leftover threads regardless of executing_ state.
-    // If execution finished naturally, threads may be lingering.
-    if (workerThreads_.empty()) {
-        return;  // No threads to join
+const Port* AIModel::FindBoundPort(const RunBindings::Binding& binding, bool input) const {
+    const Port* found = nullptr;
+    if (binding.name.empty()) {
+        found = GetPort(binding.portId);
+        if (found && found->isInput != input) found = nullptr;
+    } else {
+        const std::string_view name(binding.name);
+        const size_t colon = name.find(':');
+        const std::string_view nodeName = name.substr(0, colon);
+        const std::string_view portName = colon == std::string_view::npos ? std::string_view() : name.substr(colon + 1);
+        for (const AINode& node : nodes_) {
+            if (node.name != nodeName) continue;
+            if (found) {
+                std::cerr << "SubmitRun: node name '" << nodeName << "' is ambiguous" << std::endl;
+                return nullptr;
+            }
+            for (const Port& port : input ? node.inputPorts : node.outputPorts) {
+                if (portName.empty() || port.name == portName) {
+                    found = &port;
+                    break;
+                }
+            }
+        }
     }
 
-    executing_ = false;
+    if (!found) {
+        std::cerr << "SubmitRun: no " << (input ? "input" : "output") << " port '"
+                  << (binding.name.empty() ? std::to_string(binding.portId) : binding.name) << "'" << std::endl;
+        return nullptr;
+    }
+    if (!IsFloatPort(*found)) {
+        std::cerr << "SubmitRun: port " << found->id << " carries " << found->dataType << ", not float32 tensors" << std::endl;
+        return nullptr;
+    }
+    return found;
+}
 
-    // Wake up all waiting threads
-    queueCondition_.notify_all();
+void AIModel::CancelAllRuns() {
+    {
+        std::unique_lock<std::mutex> lock(runsMutex_);
+        for (const auto& run : activeRuns_) run->Cancel();
+        runsCondition_.wait(lock, [this]() { return activeRuns_.empty(); });
+    }
+    CompactStringsIfIdle();
+}
 
-    // Wait for all threads to finish
-    for (auto& thread : workerThreads_) {
-        if (thread.joinable()) {
-            thread.join();
+std::shared_ptr<RunContext> AIModel::LaunchRun(bool interactive, RunInputs inputs, RunOutputs outputs,
+                                               const std::vector<int>& targets) {
+    MemoryScope memScope(MemTag::Execution);
+    std::shared_ptr<const ExecutionPlan> plan = GetPlan();
+    if (!plan) return nullptr;
+
+    auto run = std::make_shared<RunContext>(nextRunId_.fetch_add(1), plan);
+    if (!plan->EntryNodes().empty()) run->batch_ = (*plan)[plan->EntryNodes().front()].cost.input.n;
+    if (!inputs.empty()) {
+        run->inputs_.resize(plan->Size());
+        bool first = true;
+        for (auto& entry : inputs) {
+            const int index = plan->IndexOf(entry.first);
+            const Tensor& tensor = entry.second;
+            if (index < 0 || (*plan)[index].predecessorCount != 0) {
+                std::cerr << "Run input for node " << entry.first << " ignored: not an entry node" << std::endl;
+                return nullptr;
+            }
+            const TensorShape& expected = (*plan)[index].cost.input;
+            if (tensor.shape.n < 1 || tensor.shape.c != expected.c || tensor.shape.h != expected.h || tensor.shape.w != expected.w ||
+                tensor.Empty() || (!first && tensor.shape.n != run->batch_)) {
+                std::cerr << "Run input for node " << entry.first << " does not match the graph input" << std::endl;
+                return nullptr;
+            }
+            run->batch_ = tensor.shape.n;
+            run->inputs_[static_cast<size_t>(index)] = std::move(entry.second);
+            first = false;
         }
     }
+    if (!outputs.empty()) {
+        run->outputs_.resize(plan->Size());
+        for (const auto& entry : outputs) {
+            const int index = plan->IndexOf(entry.first);
+            if (index < 0) {
+                std::cerr << "Run output for node " << entry.first << " ignored: no such node" << std::endl;
+                return nullptr;
+            }
+            TensorShape shape = (*plan)[index].cost.output;
+            shape.n = run->batch_;
+            if (!entry.second.data || entry.second.capacity < static_cast<size_t>(shape.Elements())) {
+                std::cerr << "Run output buffer for node " << entry.first << " holds " << entry.second.capacity
+                          << " floats, needs " << shape.Elements() << std::endl;
+                return nullptr;
+            }
+            run->outputs_[static_cast<size_t>(index)] = entry.second;
+        }
+    }
+    if (!targets.empty()) {
+        std::vector<uint32_t> targetIndices;
+        for (int nodeId : targets) {
+            const int index = plan->IndexOf(nodeId);
+            if (index < 0) {
+                std::cerr << "Requested output of node " << nodeId << " ignored: no such node" << std::endl;
+                return nullptr;
+            }
+            targetIndices.push_back(static_cast<uint32_t>(index));
+        }
+        run->Restrict(plan->AncestorCone(targetIndices), targetIndices);
+    } else if (plan->FusedCount() > 0) {
+        // Fused depthwise nodes run on their own only into a bound buffer
+        std::vector<bool> active(plan->Size(), true);
+        for (size_t i = 0; i < plan->Size(); ++i) {
+            active[i] = !(*plan)[i].fused || (!run->outputs_.empty() && run->outputs_[i].data);
+        }
+        run->Restrict(std::move(active));
+    }
+    if (interactive) {
+        run->log_ = &executionLog_;
+        run->reportProgress_ = true;
+        run->memoryStart_ = MemoryTracker::Snapshot();
+        executionLog_.Reset(executor_->NumWorkers());
+        for (size_t i = 0; i < plan->Size(); ++i) {
+            if ((*plan)[i].fused && !run->Executes(static_cast<uint32_t>(i))) {
+                ReportProgress((*plan)[i].id, (*plan)[i].name, 1.0f, "skipped", "Fused into its pointwise consumer");
+            }
+        }
+    }
+    runsStartedMetric_->Increment();
 
-    workerThreads_.clear();
+    if (run->TotalNodes() == 0) {
+        FinishRun(run);
+        return run;
+    }
 
-    // Clear scheduling structures
     {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        while (!readyQueue_.empty()) readyQueue_.pop();
+        std::lock_guard<std::mutex> lock(runsMutex_);
+        activeRuns_.push_back(run);
     }
-    adjacency_.clear();
-    indegree_.clear();
-    remainingNodes_.store(0);
-
-    std::cout << "Stopped AI model execution" << std::endl;
+    // Held across the loop, so entries that finish before the last one is
+    // submitted cannot finish the run
+    run->inFlight_.fetch_add(1, std::memory_order_relaxed);
+    for (uint32_t index : plan->EntryNodes()) {
+        if (run->Executes(index)) SubmitNode(run, index);
+    }
+    if (run->inFlight_.fetch_sub(1, std::memory_order_acq_rel) == 1) FinishRun(run);
+    return run;
 }
 
-void AIModel::ExecutionLoop() {
-    while (executing_) {
-        int nodeId = -1;
+void AIModel::SubmitNode(const std::shared_ptr<RunContext>& run, uint32_t index) {
+    const ExecutionPlan::Node& node = run->Plan()[index];
+    run->inFlight_.fetch_add(1, std::memory_order_relaxed);
+    executor_->Submit(clientId_, node.priority, node.cost.predictedSeconds,
+                      [this, run, index](int worker) { RunNode(run, index, worker); });
+}
 
-        // Get next ready node to execute
-        {
-            std::unique_lock<std::mutex> lock(queueMutex_);
-            queueCondition_.wait(lock, [this]() {
-                return !executing_ || !readyQueue_.empty();
-            });
+void AIModel::RunNode(const std::shared_ptr<RunContext>& run, uint32_t index, int workerIndex) {
+    const ExecutionPlan& plan = run->Plan();
+    const ExecutionPlan::Node& node = plan[index];
+
+    // A cancelled run skips the nodes it has not started
+    if (!run->Cancelled()) {
+        const auto nodeStart = std::chrono::steady_clock::now();
+        ExecuteNode(*run, index);
+        const auto nodeEnd = std::chrono::steady_clock::now();
+        run->busyNs_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(nodeEnd - nodeStart).count());
+        node.latency->Observe(std::chrono::duration<double>(nodeEnd - nodeStart).count());
+        run->completedNodes_.fetch_add(1, std::memory_order_release);
+
+        if (run->log_) {
+            run->log_->Append({node.id, workerIndex, run->readyBy_[index],
+                               std::chrono::duration_cast<std::chrono::nanoseconds>(nodeStart - run->startTime_).count(),
+                               std::chrono::duration_cast<std::chrono::nanoseconds>(nodeEnd - run->startTime_).count()});
+        }
 
-            if (!executing_) break;
+        // Inputs whose last reader this was are no longer needed
+        if (!run->inputs_.empty()) run->inputs_[index] = Tensor();
+        const uint32_t* preds = plan.Predecessors(node);
+        for (uint32_t p = 0; p < node.predecessorCount; ++p) {
+            if (!run->edgeLive_[node.firstPredecessor + p]) continue;   // Released by the source already
+            if (run->pendingConsumers_[preds[p]].fetch_sub(1, std::memory_order_acq_rel) == 1) run->Release(preds[p]);
+        }
 
-            if (!readyQueue_.empty()) {
-                nodeId = readyQueue_.front();
-                readyQueue_.pop();
+        // Conditional edges carry data only if they list the node's predicate;
+        // an edge not taken counts as a finished reader of this output
+        const uint32_t* succs = plan.Successors(node);
+        const uint64_t* conditions = plan.SuccessorConditions(node);
+        const uint32_t* slots = plan.SuccessorSlots(node);
+        const uint64_t predicate = node.conditional ? ExecutionPlan::Predicate(run->tensors_[index]) : ExecutionPlan::kAlways;
+        for (uint32_t s = 0; s < node.successorCount; ++s) {
+            if (!run->Executes(succs[s])) continue;
+            const bool live = (conditions[s] & predicate) != 0;
+            if (!live && run->pendingConsumers_[index].fetch_sub(1, std::memory_order_acq_rel) == 1) run->Release(index);
+            switch (ResolveInput(*run, succs[s], slots[s], live)) {
+            case Readiness::Ready:
+                run->readyBy_[succs[s]] = node.id;
+                SubmitNode(run, succs[s]);
+                break;
+            case Readiness::Pruned:
+                PruneBranch(run, succs[s]);
+                break;
+            case Readiness::Waiting:
+                break;
             }
         }
+    }
 
-        if (nodeId != -1) {
-            ExecuteNode(nodeId);
-
-            // After executing, mark successors and push newly ready nodes
-            std::lock_guard<std::mutex> lock(queueMutex_);
-            auto it = adjacency_.find(nodeId);
-            if (it != adjacency_.end()) {
-                for (int succ : it->second) {
-                    auto indegIt = indegree_.find(succ);
-                    if (indegIt != indegree_.end()) {
-                        indegIt->second--;
-                        if (indegIt->second == 0) {
-                            readyQueue_.push(succ);
-                            queueCondition_.notify_one();
-                        }
-                    }
-                }
-            }
+    if (run->inFlight_.fetch_sub(1, std::memory_order_acq_rel) == 1) FinishRun(run);
+}
 
-            remainingNodes_.fetch_sub(1);
+AIModel::Readiness AIModel::ResolveInput(RunContext& run, uint32_t index, uint32_t slot, bool live) {
+    if (live) {
+        run.edgeLive_[slot] = 1;
+        run.liveInputs_[index].fetch_add(1, std::memory_order_relaxed);
+    }
+    // The acq_rel decrement publishes every edgeLive_ flag to whoever sees zero
+    if (run.indegree_[index].fetch_sub(1, std::memory_order_acq_rel) != 1 || run.Cancelled()) return Readiness::Waiting;
+    return run.liveInputs_[index].load(std::memory_order_relaxed) > 0 ? Readiness::Ready : Readiness::Pruned;
+}
 
-            // If we've finished all nodes, stop execution
-            if (remainingNodes_.load() <= 0) {
-                executing_ = false;
-                queueCondition_.notify_all();
+void AIModel::PruneBranch(const std::shared_ptr<RunContext>& run, uint32_t index) {
+    // None of the node's inputs was taken: skip it, and everything only it
+    // feeds, without evaluating anything
+    const ExecutionPlan& plan = run->Plan();
+    std::vector<uint32_t> pending{index};
+    while (!pending.empty()) {
+        const ExecutionPlan::Node& node = plan[pending.back()];
+        pending.pop_back();
+        run->prunedNodes_.fetch_add(1, std::memory_order_release);
+        if (run->reportProgress_) ReportProgress(node.id, node.name, 1.0f, "skipped", "Branch not taken");
+
+        const uint32_t* succs = plan.Successors(node);
+        const uint32_t* slots = plan.SuccessorSlots(node);
+        for (uint32_t s = 0; s < node.successorCount; ++s) {
+            if (!run->Executes(succs[s])) continue;
+            const Readiness readiness = ResolveInput(*run, succs[s], slots[s], false);
+            if (readiness == Readiness::Pruned) {
+                pending.push_back(succs[s]);
+            } else if (readiness == Readiness::Ready) {
+                // Readiness is only Ready here if another, taken input arrived first
+                run->readyBy_[succs[s]] = node.id;
+                SubmitNode(run, succs[s]);
             }
         }
     }
 }
 
-void AIModel::ExecuteNode(int nodeId) {
-    // Find the node
-    auto it = std::find_if(nodes_.begin(), nodes_.end(),
-        [nodeId](const AINode& node) { return node.id == nodeId; });
-
-    if (it == nodes_.end()) return;
-
-    const AINode& node = *it;
+void AIModel::ExecuteNode(RunContext& run, uint32_t index) {
+    PROFILE_ZONE("AIModel::ExecuteNode");
+    const ExecutionPlan& plan = run.Plan();
+    const ExecutionPlan::Node& node = plan[index];
 
     // Report start
-    ReportProgress(nodeId, 0.0f, "running", "Starting execution");
-
-    // Simulate execution based on node type
-    if (node.type == "Conv2D") {
-        // Simulate convolution operation
-        for (int i = 1; i <= 10; ++i) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            ReportProgress(nodeId, i * 0.1f, "running", "Processing convolution layer");
+    if (run.reportProgress_) ReportProgress(node.id, node.name, 0.0f, "running", "Executing " + node.type);
+
+    // Inputs are the outputs on taken edges, widened to FP32 if they are
+    // held packed. Entry nodes read the caller's input, or a deterministic
+    // synthetic one of their declared shape.
+    Tensor entryInput;
+    std::vector<Tensor> widened;
+    ExecutionPlan::InputList inputs(std::max<uint32_t>(node.predecessorCount, 1));
+    const uint32_t* preds = plan.Predecessors(node);
+    for (uint32_t p = 0; p < node.predecessorCount; ++p) {
+        if (!run.edgeLive_[node.firstPredecessor + p]) continue;
+        const std::vector<uint16_t>& packed = run.packed_[preds[p]];
+        if (packed.empty()) {
+            inputs.Push(&run.tensors_[preds[p]]);
+            continue;
         }
-    } else if (node.type == "MaxPool") {
-        // Simulate pooling operation
-        for (int i = 1; i <= 5; ++i) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            ReportProgress(nodeId, i * 0.2f, "running", "Processing pooling layer");
+        // Reserved up front, so the pointers already handed out stay valid
+        if (widened.empty()) widened.reserve(node.predecessorCount);
+        TensorShape shape = plan[preds[p]].cost.output;
+        shape.n = run.batch_;
+        widened.emplace_back(shape);
+        kernels::Widen(packed.data(), plan.ActivationPrecision(), packed.size(), widened.back().Data());
+        inputs.Push(&widened.back());
+    }
+    if (inputs.Count() == 0) {
+        if (!run.inputs_.empty() && !run.inputs_[index].Empty()) {
+            inputs.Push(&run.inputs_[index]);
+        } else {
+            TensorShape shape = node.cost.input;
+            shape.n = run.batch_;
+            entryInput = ExecutionPlan::SyntheticInput(shape);
+            inputs.Push(&entryInput);
         }
+    }
+
+    // Every op maps batch items independently, so only N changes per run.
+    // Kernels overwrite their whole output, so a bound caller buffer is
+    // written directly.
+    TensorShape outputShape = node.cost.output;
+    outputShape.n = run.batch_;
+    const OutputBuffer* bound = run.outputs_.empty() || !run.outputs_[index].data ? nullptr : &run.outputs_[index];
+    Tensor output = bound && IsFloatAligned(bound->data) ? Tensor::View(outputShape, bound->data) : Tensor(outputShape);
+    ExecutionPlan::Evaluate(node, inputs.Data(), inputs.Count(), output);
+    if (bound && output.Data() != bound->data) std::copy(output.begin(), output.end(), bound->data);
+
+    // Outputs only other nodes read are held packed under a 16-bit
+    // activation policy; outputs callers or predicates read stay FP32
+    if (IsHalf(plan.ActivationPrecision()) && !bound && !node.conditional && !run.Kept(index) &&
+        run.pendingConsumers_[index].load(std::memory_order_acquire) > 0) {
+        std::vector<uint16_t>& packed = run.packed_[index];
+        packed.resize(output.Size());
+        kernels::Narrow(output.Data(), output.Size(), plan.ActivationPrecision(), packed.data());
     } else {
-        // Generic processing
-        for (int i = 1; i <= 8; ++i) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(75));
-            ReportProgress(nodeId, i * 0.125f, "running", "Processing " + node.type);
-        }
+        run.tensors_[index] = std::move(output);
     }
 
     // Report completion
-    ReportProgress(nodeId, 1.0f, "completed", "Execution completed successfully");
+    if (run.reportProgress_) ReportProgress(node.id, node.name, 1.0f, "completed", "Execution completed successfully");
 }
 
-void AIModel::ReportProgress(int nodeId, float progress, const std::string& status, const std::string& message) {
-    if (progressCallback_) {
-        // Find node name
-        std::string nodeName = "Unknown";
-        auto it = std::find_if(nodes_.begin(), nodes_.end(),
-            [nodeId](const AINode& node) { return node.id == nodeId; });
-        if (it != nodes_.end()) {
-            nodeName = it->name;
+void AIModel::FinishRun(const std::shared_ptr<RunContext>& run) {
+    run->endTime_ = std::chrono::steady_clock::now();
+    if (run->Succeeded() || run->CompletedNodes() == run->TotalNodes()) {
+        runsCompletedMetric_->Increment();
+    }
+    if (run->log_) {
+        MemoryTracker::SetLastRun(MemoryTracker::Delta(run->memoryStart_, MemoryTracker::Snapshot()));
+        const double wallNs = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(run->endTime_ - run->startTime_).count());
+        run->log_->MarkFinished(static_cast<int64_t>(wallNs));
+        const int concurrency = std::max(1, std::min(numThreads_, executor_->NumWorkers()));
+        if (wallNs > 0.0) {
+            utilizationMetric_->Set(static_cast<double>(run->busyNs_.load()) / (wallNs * concurrency));
         }
+    }
 
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(run->doneMutex_);
+        run->done_.store(true, std::memory_order_release);
+        callbacks.swap(run->doneCallbacks_);
+    }
+    run->doneCondition_.notify_all();
+    run->completion_.set_value();
+    for (auto& callback : callbacks) callback();
+
+    std::lock_guard<std::mutex> lock(runsMutex_);
+    activeRuns_.erase(std::remove(activeRuns_.begin(), activeRuns_.end(), run), activeRuns_.end());
+    runsCondition_.notify_all();
+}
+
+const NodeCostMap& AIModel::GetNodeCosts() {
+    if (costsDirty_) {
+        nodeCosts_ = CostModel::Analyze(*this);
+        costsDirty_ = false;
+    }
+    return nodeCosts_;
+}
+
+uint64_t AIModel::GraphFingerprint() const {
+    // FNV-1a over sorted (id, type) nodes and (from, to) node dependencies,
+    // so the result does not depend on insertion order or port/edge ids
+    std::vector<std::pair<int, std::string_view>> nodes;
+    nodes.reserve(nodes_.size());
+    for (const auto& node : nodes_) nodes.emplace_back(node.id, node.type);
+    std::sort(nodes.begin(), nodes.end());
+
+    std::vector<std::pair<int, int>> dependencies;
+    dependencies.reserve(edges_.size());
+    for (const auto& edge : edges_) {
+        const Port* fromPort = GetPort(edge.fromPortId);
+        const Port* toPort = GetPort(edge.toPortId);
+        if (fromPort && toPort) dependencies.emplace_back(fromPort->nodeId, toPort->nodeId);
+    }
+    std::sort(dependencies.begin(), dependencies.end());
+
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    for (const auto& node : nodes) {
+        mix(&node.first, sizeof(node.first));
+        mix(node.second.data(), node.second.size());
+        mix("", 1);
+    }
+    for (const auto& dependency : dependencies) mix(&dependency, sizeof(dependency));
+    return hash;
+}
+
+bool AIModel::SaveExecutionTrace(const std::string& filename) const {
+    if (IsExecuting() || !executionLog_.Finished()) {
+        std::cerr << "AIModel::SaveExecutionTrace: no finished run to save" << std::endl;
+        return false;
+    }
+    return ExecutionTrace::FromLog(executionLog_, GraphFingerprint()).Save(filename);
+}
+
+bool AIModel::StartReplay(const ExecutionTrace& trace, double speed) {
+    MemoryScope memScope(MemTag::Execution);
+    if (IsExecuting()) return false;
+    StopReplay();
+
+    if (trace.graphFingerprint != GraphFingerprint()) {
+        std::cerr << "AIModel::StartReplay: trace was recorded on a different graph" << std::endl;
+        return false;
+    }
+
+    // The log is reset here, on the thread that reads it, like StartExecution
+    replaying_ = true;
+    executionLog_.Reset(trace.numWorkers);
+    // Names are copied here: the replay thread must not read nodes_ while it is edited
+    std::unordered_map<int, std::string> names;
+    for (const AINode& node : nodes_) names.emplace(node.id, std::string(node.name));
+    replayThread_ = std::thread(&AIModel::ReplayLoop, this, trace, std::move(names), speed);
+
+    std::cout << "Replaying " << trace.spans.size() << " recorded spans";
+    if (speed > 0.0) std::cout << " at " << speed << "x" << std::endl;
+    else std::cout << " in virtual time" << std::endl;
+    return true;
+}
+
+void AIModel::StopReplay() {
+    {
+        std::lock_guard<std::mutex> lock(replayMutex_);
+        replaying_ = false;
+    }
+    replayCondition_.notify_all();
+    if (replayThread_.joinable()) replayThread_.join();
+}
+
+void AIModel::ReplayLoop(ExecutionTrace trace, std::unordered_map<int, std::string> names, double speed) {
+    MemoryScope memScope(MemTag::Execution);
+    PROFILE_THREAD_NAME("replay");
+
+    // Node starts and ends in recorded time order; at equal times ends go
+    // first, since they are what released the nodes starting at that instant
+    struct Event {
+        int64_t timeNs;
+        bool isEnd;
+        size_t span;
+    };
+    std::vector<Event> events;
+    events.reserve(trace.spans.size() * 2);
+    for (size_t i = 0; i < trace.spans.size(); ++i) {
+        events.push_back({trace.spans[i].startNs, false, i});
+        events.push_back({trace.spans[i].endNs, true, i});
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        return a.timeNs != b.timeNs ? a.timeNs < b.timeNs : a.isEnd > b.isEnd;
+    });
+
+    const std::string unknown = "Unknown";
+    const auto replayStart = std::chrono::steady_clock::now();
+    for (const Event& event : events) {
+        if (speed > 0.0) {
+            const auto due = replayStart + std::chrono::nanoseconds(static_cast<int64_t>(event.timeNs / speed));
+            std::unique_lock<std::mutex> lock(replayMutex_);
+            if (replayCondition_.wait_until(lock, due, [this]() { return !replaying_; })) break;
+        } else if (!replaying_) {
+            break;
+        }
+
+        const ExecutionLog::Span& span = trace.spans[event.span];
+        auto name = names.find(span.nodeId);
+        const std::string& nodeName = name != names.end() ? name->second : unknown;
+        if (event.isEnd) {
+            // Spans keep their recorded timestamps, so the timeline shows the original run
+            executionLog_.Append(span);
+            ReportProgress(span.nodeId, nodeName, 1.0f, "completed", "Replayed from trace");
+        } else {
+            ReportProgress(span.nodeId, nodeName, 0.0f, "running", "Replaying recorded span");
+        }
+    }
+
+    if (replaying_) {
+        executionLog_.MarkFinished(trace.endNs);
+        replaying_ = false;
+    }
+}
+
+void AIModel::ReportProgress(int nodeId, const std::string& nodeName, float progress, const std::string& status,
+                             const std::string& message) {
+    if (progressCallback_) {
         ExecutionProgress progressInfo = {nodeId, nodeName, progress, status, message};
         progressCallback_(progressInfo);
     }
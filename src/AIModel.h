@@ -9,14 +9,38 @@
 #include <condition_variable>
 #include <queue>
 #include <unordered_map>
-#include <map>
 #include <tuple>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include "MemoryTracker.h"
+#include "GraphArena.h"
+#include "GraphOrder.h"
+#include "Metrics.h"
+#include "ExecutionLog.h"
+#include "ExecutionTrace.h"
+#include "CostModel.h"
+#include "ExecutorService.h"
+#include "ExecutionPlan.h"
+#include "RunContext.h"
+#include "RunBindings.h"
+#include <chrono>
+
+// Graph strings are views. Views handed to AIModel only need to outlive the
+// call: the model interns them into its GraphArena. Views it returns (node,
+// port and edge strings, GetNodes() and friends) stay valid until the next
+// call that changes the graph, which may compact the arena to reclaim values
+// edits replaced; copy them into std::string to keep them longer. Edits
+// inside BeginBatch/EndBatch leave views alone until the outermost EndBatch,
+// and compaction waits until no run or trace replay is in flight.
+
+class KernelTuner;
 
 // Port represents an input/output connector on a node
 struct Port {
     int id;                        // Unique port ID
-    std::string name;              // Port name (e.g., "input_text", "output_vector")
-    std::string dataType;          // Data type (e.g., "string", "vector", "int", "float")
+    std::string_view name;         // Port name (e.g., "input_text", "output_vector")
+    std::string_view dataType;     // Data type (e.g., "string", "vector", "int", "float")
     bool isInput;                  // true for input port, false for output port
     int nodeId;                    // ID of the node this port belongs to
 };
@@ -26,28 +50,63 @@ struct Edge {
     int id;                        // Unique edge ID
     int fromPortId;                // Source port ID
     int toPortId;                  // Target port ID
-    std::string dataType;          // Data type being transmitted (for validation)
-    std::map<std::string, std::string> metadata; // Edge metadata (weights, conditions, etc.)
+    std::string_view dataType;     // Data type being transmitted (for validation)
+    std::pmr::vector<std::pair<std::string_view, std::string_view>> metadata; // Edge metadata (weights, conditions, etc.)
 };
 
 struct AINode {
     int id;
-    std::string type;
-    std::string name;
-    std::vector<std::pair<std::string, std::string>> parameters;
-    std::vector<Port> inputPorts;  // Input ports (replacing simple inputs vector)
-    std::vector<Port> outputPorts; // Output ports (replacing simple outputs vector)
+    std::string_view type;
+    std::string_view name;
+    std::pmr::vector<std::pair<std::string_view, std::string_view>> parameters;
+    std::pmr::vector<Port> inputPorts;  // Input ports (replacing simple inputs vector)
+    std::pmr::vector<Port> outputPorts; // Output ports (replacing simple outputs vector)
     int boundUINodeId;             // ID of the bound UI node
 };
 
+// Parsed contents of a model file, independent of any AIModel instance.
+// Nodes carry no ports yet; connections use the legacy (fromNode, toNode,
+// fromOutput, toInput) tuple format of the file. Node strings point into
+// 'strings', which moves with the snapshot.
+struct ModelSnapshot {
+    std::unique_ptr<GraphArena> strings = std::make_unique<GraphArena>();
+    std::vector<AINode> nodes;
+    std::vector<std::tuple<int, int, int, int>> connections;
+    // (fromNodeId, toNodeId, key, value) rows applied to every edge between the two nodes
+    std::vector<std::tuple<int, int, std::string_view, std::string_view>> edgeMetadata;
+};
+
+// Difference between the current model and a snapshot, keyed by node id.
+// Node strings point into the snapshot the delta was computed from.
+struct ModelDelta {
+    std::vector<AINode> addedNodes;
+    std::vector<AINode> updatedNodes;  // Same id, different type, name or parameter set
+    std::vector<int> removedNodeIds;
+    std::vector<std::tuple<int, int, int, int>> addedConnections;
+    std::vector<std::tuple<int, int, int, int>> removedConnections;
+    // Set when edge metadata differs; edgeMetadata then replaces all of it
+    bool edgeMetadataChanged = false;
+    std::vector<std::tuple<int, int, std::string_view, std::string_view>> edgeMetadata;
+
+    bool empty() const {
+        return addedNodes.empty() && updatedNodes.empty() && removedNodeIds.empty() &&
+               addedConnections.empty() && removedConnections.empty() && !edgeMetadataChanged;
+    }
+};
+
 struct ExecutionProgress {
     int nodeId;
     std::string nodeName;
     float progress; // 0.0 to 1.0
-    std::string status; // "running", "completed", "failed"
+    std::string status; // "running", "completed", "failed", "skipped"
     std::string message;
 };
 
+// Input tensors of a run, keyed by entry node id
+using RunInputs = std::unordered_map<int, Tensor>;
+// Caller buffers that receive node outputs, keyed by node id
+using RunOutputs = std::unordered_map<int, OutputBuffer>;
+
 class AIModel {
 public:
     AIModel();
@@ -61,16 +120,32 @@ public:
 
     void LoadFromFile(const std::string& filename);
     void SaveToFile(const std::string& filename);
+
+    // Parse a model file without touching any model (safe on any thread)
+    static bool ParseFile(const std::string& filename, ModelSnapshot& snapshot);
+    // Compute the node/connection delta needed to turn this model into the snapshot
+    ModelDelta Diff(const ModelSnapshot& snapshot) const;
+    // Apply a delta in one batch; untouched nodes keep their ports and parameters
+    void ApplyDelta(const ModelDelta& delta);
+
+    // Batch mutations: change notifications are coalesced until the outermost EndBatch
+    void BeginBatch() { ++batchDepth_; }
+    void EndBatch();
+
     void AddNode(const AINode& node);
     void RemoveNode(int nodeId);
     void UpdateNode(const AINode& node);
     void AddEdge(const Edge& edge);
     void RemoveEdge(int edgeId);
     void RemoveEdgesBetweenNodes(int fromNodeId, int toNodeId);
+    // Sets key on every edge between the two nodes; "condition" makes the
+    // edges conditional (see ExecutionPlan)
+    void SetEdgeMetadata(int fromNodeId, int toNodeId, std::string_view key, std::string_view value);
 
-    const std::vector<AINode>& GetNodes() const { return nodes_; }
-    const std::vector<Edge>& GetEdges() const { return edges_; }
-    const std::vector<Port>& GetAllPorts() const { return allPorts_; }
+    const std::pmr::vector<AINode>& GetNodes() const { return nodes_; }
+    const std::pmr::vector<Edge>& GetEdges() const { return edges_; }
+    const std::pmr::vector<Port>& GetAllPorts() const { return allPorts_; }
+    const GraphArena& GetArena() const { return arena_; }
     
     // Helper methods for port lookup
     const Port* GetPort(int portId) const;
@@ -79,6 +154,12 @@ public:
     
     // Validate connection compatibility
     bool ValidateEdge(const Edge& edge) const;
+    // Whole-graph check in O(V + E): every cycle (by Tarjan SCC) and every
+    // edge with missing ports, wrong directions or mismatched types, one
+    // message per problem. Edits keep the graph acyclic (AddEdge refuses
+    // edges that would close a cycle), so cycles only show up here if the
+    // graph was built some other way.
+    std::vector<std::string> Validate() const;
 
     // Backward compatibility: return edges in old tuple format for UI
     std::vector<std::tuple<int, int, int, int>> GetConnectionsLegacy() const;
@@ -89,42 +170,163 @@ public:
 
     void SetModelChangeCallback(std::function<void()> callback) { onModelChange_ = callback; }
 
-    // Execution methods
-    void StartExecution(int numThreads = 1);
+    // Execution methods. StartExecution runs the interactive run: the one the
+    // progress callback and execution log follow. Other runs go through
+    // SubmitRun. The handle is invalid if nothing was started.
+    RunHandle StartExecution(int numThreads = 1);
     void StopExecution();
-    bool IsExecuting() const { return executing_.load(); }
+    bool IsExecuting() const { return replaying_.load() || (currentRun_ && !currentRun_->Done()); }
+
+    // Compiled form of the current graph, rebuilt after graph changes;
+    // nullptr if the graph cannot run (cycle, oversized weights)
+    std::shared_ptr<const ExecutionPlan> GetPlan();
+    // Compiles body once as the named subgraph that "Call" and "Loop" nodes
+    // run (parameter subgraph=name). The body needs exactly one entry and one
+    // sink node and is not tracked afterwards; redefining a name replaces it.
+    bool DefineSubgraph(const std::string& name, AIModel& body);
+    std::shared_ptr<const ExecutionPlan> GetSubgraph(std::string_view name) const;
+    // Plan compilation asks tuner which kernel each node runs (nullptr: each
+    // op's first applicable kernel). Not owned; must outlive the model's plans
+    // being compiled.
+    void SetKernelTuner(KernelTuner* tuner);
+    KernelTuner* GetKernelTuner() const { return kernelTuner_; }
+    // Storage precision of weights and of activations between nodes, from
+    // the next plan on; false (and unchanged) if activations are not FP32,
+    // FP16 or BF16
+    bool SetPrecisionPolicy(const PrecisionPolicy& policy);
+    const PrecisionPolicy& GetPrecisionPolicy() const { return precisionPolicy_; }
+    // Start one more run of the current plan. Any number of runs may be in
+    // flight; they interleave on the executor within this model's limit.
+    // inputs maps entry node ids to their input tensors; entries without one
+    // read a synthetic input. Inputs must match the entry's CxHxW but may
+    // carry any batch size N, which then applies to every node of the run.
+    // Call from the thread that edits the model. nullptr if the graph cannot
+    // run or the inputs do not fit it.
+    std::shared_ptr<RunContext> StartRun(RunInputs inputs = {});
+    // StartRun for asynchronous callers: await the handle's future or chain
+    // a completion callback instead of polling IsExecuting
+    RunHandle SubmitRun(RunInputs inputs = {});
+    // Run with caller buffers bound to ports: inputs are read and outputs
+    // written in place where alignment allows. With outputs bound or
+    // requested, only their ancestor cone executes. Invalid handle if a
+    // binding does not resolve to a float port or a buffer does not fit.
+    RunHandle SubmitRun(const RunBindings& bindings);
+    // Cancel every run in flight and wait until they have finished
+    void CancelAllRuns();
 
     void SetProgressCallback(std::function<void(const ExecutionProgress&)> callback) {
         progressCallback_ = callback;
     }
 
-    void SetExecutionConfig(int numThreads) { numThreads_ = numThreads; }
+    // Nodes this model may run at once on the executor, across all runs
+    void SetExecutionConfig(int numThreads);
+
+    // Runs are executed on a shared ExecutorService (ExecutorService::Shared()
+    // unless set); StartExecution's numThreads is this model's concurrency
+    // limit there and the weight its fair share against other models
+    void SetExecutor(ExecutorService& executor);
+    void SetSchedulingWeight(double weight);
+    ExecutorService& GetExecutor() const { return *executor_; }
+
+    // Spans of the current (or last) run; safe to read while the run is in flight
+    const ExecutionLog& GetExecutionLog() const { return executionLog_; }
+
+    // Predicted per-node cost (shapes, FLOPs, bytes, roofline time), recomputed after graph changes
+    const NodeCostMap& GetNodeCosts();
+
+    // Hash of node ids, types and dependencies; identifies the graph a trace was recorded on
+    uint64_t GraphFingerprint() const;
+    // Write the last finished run as a binary ExecutionTrace
+    bool SaveExecutionTrace(const std::string& filename) const;
+    // Re-issue a recorded run against this graph without executing any node:
+    // progress callbacks fire and the execution log fills as in the original
+    // run. speed scales replay time (2.0 = twice as fast); speed <= 0 replays
+    // in virtual time, as fast as possible. Fails if the graph differs.
+    bool StartReplay(const ExecutionTrace& trace, double speed = 1.0);
 
 private:
-    void ExecutionLoop();
-    void ExecuteNode(int nodeId);
-    void ReportProgress(int nodeId, float progress, const std::string& status, const std::string& message = "");
-
-    std::vector<AINode> nodes_;
-    std::vector<Edge> edges_;      // New edge-based connection storage
-    std::vector<Port> allPorts_;   // All ports indexed by ID for quick lookup
-    std::unordered_map<int, int> portIndex_; // Map portId to index in allPorts_
+    void NotifyModelChange();
+    // Re-interns every string the graph references, dropping the rest
+    void CompactStrings();
+    // CompactStrings once the arena needs it, unless a batch, run or replay is open
+    void CompactStringsIfIdle();
+    void ClearGraph();
+    void RebuildFromSnapshot(const ModelSnapshot& snapshot);
+    AINode CopyIntoArena(const AINode& node);
+    Port CopyIntoArena(const Port& port);
+    Edge CopyIntoArena(const Edge& edge);
+    void AddPortsForNode(AINode& node);
+    AINode* FindNode(int nodeId);
+    const char* EdgeProblem(const Edge& edge) const;
+    std::string DescribePath(const std::vector<int>& nodeIds) const;
+    // Edge metadata without change notification, and as sorted file rows
+    void WriteEdgeMetadata(int fromNodeId, int toNodeId, std::string_view key, std::string_view value);
+    std::vector<std::tuple<int, int, std::string_view, std::string_view>> EdgeMetadataRows() const;
+
+    void StopReplay();
+    // targets: node ids whose ancestor cone is executed; empty runs the whole plan
+    std::shared_ptr<RunContext> LaunchRun(bool interactive, RunInputs inputs, RunOutputs outputs = {},
+                                          const std::vector<int>& targets = {});
+    const Port* FindBoundPort(const RunBindings::Binding& binding, bool input) const;
+    void SubmitNode(const std::shared_ptr<RunContext>& run, uint32_t index);
+    void RunNode(const std::shared_ptr<RunContext>& run, uint32_t index, int workerIndex);
+    void ExecuteNode(RunContext& run, uint32_t index);
+    // Marks one input of a node as arrived, taken or not; the last arrival
+    // decides whether the node runs or is pruned
+    enum class Readiness { Waiting, Ready, Pruned };
+    Readiness ResolveInput(RunContext& run, uint32_t index, uint32_t slot, bool live);
+    void PruneBranch(const std::shared_ptr<RunContext>& run, uint32_t index);
+    void FinishRun(const std::shared_ptr<RunContext>& run);
+    // names: node id -> name, copied when the replay starts
+    void ReplayLoop(ExecutionTrace trace, std::unordered_map<int, std::string> names, double speed);
+    // Called from worker and replay threads; nodeName comes from the plan or
+    // the replay's copy, never from nodes_, which the editor may be changing
+    void ReportProgress(int nodeId, const std::string& nodeName, float progress, const std::string& status,
+                        const std::string& message = "");
+
+    // Graph storage; the arena must be declared first so it outlives the containers
+    GraphArena arena_;
+    GraphOrder order_;               // Topological order, maintained on every edge insert
+    std::pmr::vector<AINode> nodes_{&arena_};
+    std::pmr::vector<Edge> edges_{&arena_};      // New edge-based connection storage
+    std::pmr::vector<Port> allPorts_{&arena_};   // All ports indexed by ID for quick lookup
+    std::pmr::unordered_map<int, int> portIndex_{&arena_}; // Map portId to index in allPorts_
     
     std::function<void()> onModelChange_;
+    NodeCostMap nodeCosts_;
+    bool costsDirty_{true};
+    int batchDepth_{0};
+    bool batchDirty_{false};
 
     // Execution related
-    std::atomic<bool> executing_{false};
-    std::vector<std::thread> workerThreads_;
-    // ready queue holds nodes whose dependencies have been satisfied
-    std::queue<int> readyQueue_;
-    std::mutex queueMutex_;
-    std::condition_variable queueCondition_;
+    ExecutorService* executor_ = nullptr;
+    ExecutorService::ClientId clientId_ = 0;
+    ExecutorService::ClientOptions clientOptions_;
     int numThreads_{1};
+    std::shared_ptr<const ExecutionPlan> plan_;
+    bool planDirty_{true};
+    std::unordered_map<std::string, std::shared_ptr<const ExecutionPlan>> subgraphs_;
+    KernelTuner* kernelTuner_ = nullptr;
+    PrecisionPolicy precisionPolicy_;
+
+    // Runs in flight, removed by the task that finishes them
+    std::mutex runsMutex_;
+    std::condition_variable runsCondition_;
+    std::vector<std::shared_ptr<RunContext>> activeRuns_;
+    std::atomic<uint64_t> nextRunId_{1};
+    std::shared_ptr<RunContext> currentRun_;  // Interactive run (UI thread only)
+    ExecutionLog executionLog_;
+
+    // Trace replay
+    std::atomic<bool> replaying_{false};
+    std::thread replayThread_;
+    std::mutex replayMutex_;
+    std::condition_variable replayCondition_;  // Wakes the replay thread on stop
 
-    // Dependency graph for topological scheduling
-    std::unordered_map<int, std::vector<int>> adjacency_; // from -> list of to
-    std::unordered_map<int, int> indegree_; // node -> remaining incoming edges
-    std::atomic<int> remainingNodes_{0};
+    // Executor metrics (owned by MetricsRegistry::Global())
+    Counter* runsStartedMetric_ = nullptr;
+    Counter* runsCompletedMetric_ = nullptr;
+    Gauge* utilizationMetric_ = nullptr;
 
     std::function<void(const ExecutionProgress&)> progressCallback_;
     
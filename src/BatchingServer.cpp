@@ -0,0 +1,356 @@
+#include "BatchingServer.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+using SocketHandle = SOCKET;
+#define AISHOW_CLOSE_SOCKET closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketHandle = int;
+#define AISHOW_CLOSE_SOCKET close
+#endif
+
+namespace {
+std::string ShapeText(const TensorShape& shape) {
+    return std::to_string(shape.n) + "x" + std::to_string(shape.c) + "x" + std::to_string(shape.h) + "x" +
+           std::to_string(shape.w);
+}
+
+std::string HttpResponse(const char* status, const char* contentType, const std::string& body) {
+    return std::string("HTTP/1.1 ") + status + "\r\nContent-Type: " + contentType +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// Content-Length of a request head, 0 if absent
+size_t ContentLength(const std::string& head) {
+    std::string lower(head);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    const size_t pos = lower.find("\r\ncontent-length:");
+    if (pos == std::string::npos) return 0;
+    return static_cast<size_t>(std::strtoull(head.c_str() + pos + 17, nullptr, 10));
+}
+}
+
+BatchingServer::BatchingServer(AIModel& model, BatchingOptions options)
+    : model_(model), options_(options) {
+    MetricsRegistry& metrics = MetricsRegistry::Global();
+    requestsMetric_ = &metrics.GetCounter("aishow_inference_requests_total", "Inference requests answered by the batching server");
+    rejectedMetric_ = &metrics.GetCounter("aishow_inference_rejected_total", "Inference requests rejected or failed");
+    batchSizeMetric_ = &metrics.GetHistogram("aishow_batch_size", "Requests coalesced into one run", {},
+                                             Histogram::ExponentialBounds(1.0, 2.0, 10));
+    queueWaitMetric_ = &metrics.GetHistogram("aishow_batch_queue_wait_seconds", "Time a request waited for its batch to launch");
+}
+
+BatchingServer::~BatchingServer() {
+    Stop();
+}
+
+bool BatchingServer::Start(int port) {
+    if (running_) return true;
+
+    std::shared_ptr<const ExecutionPlan> plan = model_.GetPlan();
+    if (!plan) {
+        std::cerr << "BatchingServer: the graph cannot run" << std::endl;
+        return false;
+    }
+    std::vector<uint32_t> sinks;
+    for (uint32_t i = 0; i < plan->Size(); ++i) {
+        if ((*plan)[i].successorCount == 0) sinks.push_back(i);
+    }
+    if (plan->EntryNodes().size() != 1 || sinks.size() != 1) {
+        std::cerr << "BatchingServer: the graph needs exactly one entry and one sink node (has "
+                  << plan->EntryNodes().size() << " and " << sinks.size() << ")" << std::endl;
+        return false;
+    }
+    const ExecutionPlan::Node& entry = (*plan)[plan->EntryNodes().front()];
+    const ExecutionPlan::Node& sink = (*plan)[sinks.front()];
+    entryNodeId_ = entry.id;
+    sinkNodeId_ = sink.id;
+    inputShape_ = entry.cost.input;
+    inputShape_.n = 1;
+    outputShape_ = sink.cost.output;
+    outputShape_.n = 1;
+
+    if (port >= 0) {
+#ifdef _WIN32
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return false;
+#endif
+        SocketHandle sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock == static_cast<SocketHandle>(-1)) {
+            std::cerr << "BatchingServer: socket() failed" << std::endl;
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(sock, 64) != 0) {
+            std::cerr << "BatchingServer: cannot listen on 127.0.0.1:" << port << std::endl;
+            AISHOW_CLOSE_SOCKET(sock);
+            return false;
+        }
+        socklen_t addrLen = sizeof(addr);
+        getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addrLen);
+        port_ = ntohs(addr.sin_port);
+        listenSocket_ = static_cast<intptr_t>(sock);
+    }
+
+    running_ = true;
+    batchThread_ = std::thread(&BatchingServer::BatchLoop, this);
+    if (listenSocket_ != -1) {
+        serverThread_ = std::thread(&BatchingServer::ServeLoop, this);
+        std::cout << "Serving " << ShapeText(inputShape_) << " -> " << ShapeText(outputShape_)
+                  << " at http://127.0.0.1:" << port_ << "/infer" << std::endl;
+    }
+    return true;
+}
+
+void BatchingServer::Stop() {
+    if (!running_) return;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        running_ = false;
+    }
+
+    // Batches already launched are still answered; requests that never made
+    // it into one fail, which also releases connections waiting on them
+    queueCondition_.notify_all();
+    if (batchThread_.joinable()) batchThread_.join();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        for (Request& request : queue_) request.result.set_value(Tensor());
+        queue_.clear();
+    }
+    {
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        queueCondition_.wait(lock, [this]() { return batchesInFlight_ == 0; });
+    }
+
+    // Connections notice the flag within one poll interval
+    if (serverThread_.joinable()) serverThread_.join();
+    for (Connection& connection : connections_) {
+        if (connection.thread.joinable()) connection.thread.join();
+    }
+    connections_.clear();
+    if (listenSocket_ != -1) {
+        AISHOW_CLOSE_SOCKET(static_cast<SocketHandle>(listenSocket_));
+        listenSocket_ = -1;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+}
+
+bool BatchingServer::Infer(const Tensor& item, Tensor& result) {
+    if (item.shape != inputShape_ || item.Empty()) {
+        rejectedMetric_->Increment();
+        return false;
+    }
+
+    std::future<Tensor> future;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (!running_ || static_cast<int>(queue_.size()) >= options_.maxQueuedRequests) {
+            rejectedMetric_->Increment();
+            return false;
+        }
+        queue_.push_back(Request{item, std::promise<Tensor>(), std::chrono::steady_clock::now()});
+        future = queue_.back().result.get_future();
+    }
+    queueCondition_.notify_all();
+
+    result = future.get();
+    if (result.Empty()) {
+        rejectedMetric_->Increment();
+        return false;
+    }
+    requestsMetric_->Increment();
+    requestsServed_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void BatchingServer::BatchLoop() {
+    const size_t itemElements = static_cast<size_t>(inputShape_.Elements());
+    while (true) {
+        auto requests = std::make_shared<std::vector<Request>>();
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueCondition_.wait(lock, [this]() {
+                return !running_ || (!queue_.empty() && batchesInFlight_ < options_.maxBatchesInFlight);
+            });
+            if (!running_) return;
+
+            // Hold the batch open until it is full or its oldest request is due
+            const auto due = queue_.front().enqueued + options_.maxWait;
+            queueCondition_.wait_until(lock, due, [this]() {
+                return !running_ || static_cast<int>(queue_.size()) >= options_.maxBatchSize;
+            });
+            if (!running_) return;
+
+            const size_t count = std::min(queue_.size(), static_cast<size_t>(options_.maxBatchSize));
+            const auto now = std::chrono::steady_clock::now();
+            requests->reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                queueWaitMetric_->Observe(std::chrono::duration<double>(now - queue_.front().enqueued).count());
+                requests->push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+            ++batchesInFlight_;
+        }
+
+        TensorShape shape = inputShape_;
+        shape.n = static_cast<int64_t>(requests->size());
+        Tensor input(shape);
+        for (size_t i = 0; i < requests->size(); ++i) {
+            const Tensor& item = (*requests)[i].item;
+            std::copy(item.begin(), item.end(), input.Data() + i * itemElements);
+        }
+        batchSizeMetric_->Observe(static_cast<double>(requests->size()));
+        RunHandle run = model_.SubmitRun({{entryNodeId_, std::move(input)}});
+        batchesRun_.fetch_add(1, std::memory_order_relaxed);
+
+        // The batch is answered from the worker that finishes its run
+        if (!run) {
+            CompleteBatch(nullptr, *requests);
+            continue;
+        }
+        run.Then([this, requests](const RunContext& finished) { CompleteBatch(finished.Output(sinkNodeId_), *requests); });
+    }
+}
+
+void BatchingServer::CompleteBatch(const Tensor* output, std::vector<Request>& requests) {
+    const size_t itemElements = static_cast<size_t>(outputShape_.Elements());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        Tensor result;
+        if (output && output->Size() >= (i + 1) * itemElements) {
+            result = Tensor(outputShape_);
+            const float* first = output->Data() + i * itemElements;
+            std::copy(first, first + itemElements, result.Data());
+        }
+        requests[i].result.set_value(std::move(result));
+    }
+
+    // Notify under the lock: Stop() may destroy the server as soon as it sees zero
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    --batchesInFlight_;
+    queueCondition_.notify_all();
+}
+
+void BatchingServer::ServeLoop() {
+    const SocketHandle sock = static_cast<SocketHandle>(listenSocket_);
+    while (running_) {
+#ifdef _WIN32
+        WSAPOLLFD pfd{sock, POLLRDNORM, 0};
+        int ready = WSAPoll(&pfd, 1, 200);
+#else
+        pollfd pfd{sock, POLLIN, 0};
+        int ready = poll(&pfd, 1, 200);
+#endif
+        // Reap connections that have closed
+        for (auto it = connections_.begin(); it != connections_.end();) {
+            if (it->finished) {
+                it->thread.join();
+                it = connections_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (ready <= 0) continue;
+
+        SocketHandle client = accept(sock, nullptr, nullptr);
+        if (client == static_cast<SocketHandle>(-1)) continue;
+        connections_.emplace_back();
+        Connection* connection = &connections_.back();
+        connection->thread = std::thread(&BatchingServer::HandleConnection, this, static_cast<intptr_t>(client), connection);
+    }
+}
+
+void BatchingServer::HandleConnection(intptr_t clientHandle, Connection* connection) {
+    const SocketHandle client = static_cast<SocketHandle>(clientHandle);
+    std::string buffer;
+    char chunk[16384];
+    bool open = true;
+    while (open && running_) {
+#ifdef _WIN32
+        WSAPOLLFD pfd{client, POLLRDNORM, 0};
+        int ready = WSAPoll(&pfd, 1, 200);
+#else
+        pollfd pfd{client, POLLIN, 0};
+        int ready = poll(&pfd, 1, 200);
+#endif
+        if (ready < 0) break;
+        if (ready == 0) continue;
+        const int received = recv(client, chunk, sizeof(chunk), 0);
+        if (received <= 0) break;
+        buffer.append(chunk, static_cast<size_t>(received));
+
+        // Answer every complete request in the buffer (clients may pipeline)
+        while (true) {
+            const size_t headEnd = buffer.find("\r\n\r\n");
+            if (headEnd == std::string::npos) break;
+            const std::string head = buffer.substr(0, headEnd);
+            const size_t bodyLength = ContentLength(head);
+            if (buffer.size() < headEnd + 4 + bodyLength) break;
+
+            std::istringstream requestLine(head.substr(0, head.find("\r\n")));
+            std::string method, path;
+            requestLine >> method >> path;
+            std::string response = HandleRequest(method, path, buffer.substr(headEnd + 4, bodyLength));
+            buffer.erase(0, headEnd + 4 + bodyLength);
+
+            size_t sent = 0;
+            while (sent < response.size()) {
+                int n = send(client, response.data() + sent, static_cast<int>(response.size() - sent), 0);
+                if (n <= 0) break;
+                sent += static_cast<size_t>(n);
+            }
+            if (sent < response.size()) {
+                open = false;
+                break;
+            }
+        }
+    }
+    AISHOW_CLOSE_SOCKET(client);
+    connection->finished = true;
+}
+
+std::string BatchingServer::HandleRequest(const std::string& method, const std::string& path, const std::string& body) {
+    if (method == "GET" && path == "/info") {
+        std::ostringstream info;
+        info << "input " << ShapeText(inputShape_) << "\noutput " << ShapeText(outputShape_)
+             << "\nmax_batch " << options_.maxBatchSize << "\nmax_wait_us " << options_.maxWait.count() << "\n";
+        return HttpResponse("200 OK", "text/plain", info.str());
+    }
+    if (method != "POST" || path != "/infer") {
+        return HttpResponse("404 Not Found", "text/plain", "");
+    }
+    if (body.size() != static_cast<size_t>(inputShape_.Elements()) * sizeof(float)) {
+        rejectedMetric_->Increment();
+        return HttpResponse("400 Bad Request", "text/plain", "expected " + ShapeText(inputShape_) + " float32 values\n");
+    }
+
+    Tensor item(inputShape_);
+    std::memcpy(item.Data(), body.data(), body.size());
+    Tensor result;
+    if (!Infer(item, result)) {
+        return HttpResponse("503 Service Unavailable", "text/plain", "");
+    }
+    return HttpResponse("200 OK", "application/octet-stream",
+                        std::string(reinterpret_cast<const char*>(result.Data()), result.Size() * sizeof(float)));
+}
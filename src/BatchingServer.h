@@ -0,0 +1,105 @@
+#pragma once
+
+#include "AIModel.h"
+#include "Tensor.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Counter;
+class Histogram;
+
+struct BatchingOptions {
+    int maxBatchSize = 16;
+    std::chrono::microseconds maxWait{2000};  // Longest the oldest request waits for company
+    int maxQueuedRequests = 4096;              // Further requests are rejected
+    int maxBatchesInFlight = 2;                // Requests keep queueing (and batching) behind these
+};
+
+// Serving front end that coalesces single-item inference requests into
+// batched runs of a model.
+//
+// Requests queue until maxBatchSize items are waiting or the oldest has
+// waited maxWait. The batch is stacked along N, executed as one run and the
+// sink output is split back per request. The graph must have exactly one
+// entry and one sink node and must not be edited while the server runs.
+//
+// Besides the in-process Infer(), requests can come over loopback HTTP with
+// keep-alive connections:
+//   POST /infer  body: 1xCxHxW float32 values (host byte order), replies
+//                with the 1xC'xH'xW' sink output in the same encoding
+//   GET  /info   input/output shapes and batching limits as text
+class BatchingServer {
+public:
+    explicit BatchingServer(AIModel& model, BatchingOptions options = {});
+    ~BatchingServer();
+
+    BatchingServer(const BatchingServer&) = delete;
+    BatchingServer& operator=(const BatchingServer&) = delete;
+
+    // port 0 picks a free port; a negative port serves in-process only
+    bool Start(int port = 8090);
+    void Stop();
+    int GetPort() const { return port_; }
+
+    // Blocking inference of one item shaped like InputShape(); false if the
+    // item does not fit, the queue is full or the run failed
+    bool Infer(const Tensor& item, Tensor& result);
+
+    const TensorShape& InputShape() const { return inputShape_; }
+    const TensorShape& OutputShape() const { return outputShape_; }
+    uint64_t RequestsServed() const { return requestsServed_.load(); }
+    uint64_t BatchesRun() const { return batchesRun_.load(); }
+
+private:
+    struct Request {
+        Tensor item;
+        std::promise<Tensor> result;  // Empty tensor on failure
+        std::chrono::steady_clock::time_point enqueued;
+    };
+    struct Connection {
+        std::thread thread;
+        std::atomic<bool> finished{false};
+    };
+
+    void BatchLoop();
+    void CompleteBatch(const Tensor* output, std::vector<Request>& requests);
+    void ServeLoop();
+    void HandleConnection(intptr_t client, Connection* connection);
+    std::string HandleRequest(const std::string& method, const std::string& path, const std::string& body);
+
+    AIModel& model_;
+    const BatchingOptions options_;
+    int entryNodeId_ = -1;
+    int sinkNodeId_ = -1;
+    TensorShape inputShape_;
+    TensorShape outputShape_;
+
+    std::atomic<bool> running_{false};
+    std::thread batchThread_;
+
+    std::mutex queueMutex_;
+    std::condition_variable queueCondition_;    // New requests, finished batches, stop
+    std::deque<Request> queue_;
+    int batchesInFlight_ = 0;
+
+    std::atomic<uint64_t> requestsServed_{0};
+    std::atomic<uint64_t> batchesRun_{0};
+    Counter* requestsMetric_;
+    Counter* rejectedMetric_;
+    Histogram* batchSizeMetric_;
+    Histogram* queueWaitMetric_;
+
+    std::thread serverThread_;
+    intptr_t listenSocket_{-1};
+    int port_{0};
+    std::list<Connection> connections_;         // Touched by the accept thread only
+};
@@ -0,0 +1,195 @@
+#include "CostModel.h"
+#include "AIModel.h"
+#include "OperatorRegistry.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <vector>
+
+namespace {
+
+std::string_view ParamText(const AINode& node, std::string_view key) {
+    for (const auto& param : node.parameters) {
+        if (param.first == key) return param.second;
+    }
+    return {};
+}
+
+double Seconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+// Independent multiply-add chains, wide enough for the compiler to keep
+// several vector registers busy
+double MeasureFlops() {
+    constexpr int kLanes = 64;
+    constexpr int kIterations = 1 << 20;
+    float acc[kLanes];
+    for (int i = 0; i < kLanes; ++i) acc[i] = 1.0f + i * 1e-3f;
+    const float scale = 0.9999999f;
+    const float bias = 1e-7f;
+
+    double best = 0.0;
+    for (int rep = 0; rep < 3; ++rep) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int iter = 0; iter < kIterations; ++iter) {
+            for (int i = 0; i < kLanes; ++i) acc[i] = acc[i] * scale + bias;
+        }
+        const double elapsed = Seconds(std::chrono::steady_clock::now() - start);
+        if (elapsed > 0.0) best = std::max(best, 2.0 * kLanes * kIterations / elapsed);
+    }
+
+    volatile float sink = 0.0f;
+    for (int i = 0; i < kLanes; ++i) sink = sink + acc[i];
+    return best;
+}
+
+// STREAM-style triad over arrays well beyond the last-level cache
+double MeasureBandwidth() {
+    constexpr size_t kElements = size_t(8) << 20;  // 32 MB per array
+    std::unique_ptr<float[]> a(new float[kElements]);
+    std::unique_ptr<float[]> b(new float[kElements]);
+    std::unique_ptr<float[]> c(new float[kElements]);
+    std::fill(b.get(), b.get() + kElements, 1.0f);
+    std::fill(c.get(), c.get() + kElements, 2.0f);
+
+    double best = 0.0;
+    for (int rep = 0; rep < 3; ++rep) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < kElements; ++i) a[i] = b[i] + 0.5f * c[i];
+        const double elapsed = Seconds(std::chrono::steady_clock::now() - start);
+        if (elapsed > 0.0) best = std::max(best, 3.0 * sizeof(float) * kElements / elapsed);
+    }
+
+    volatile float sink = a[kElements / 2];
+    (void)sink;
+    return best;
+}
+
+} // namespace
+
+const MachinePeak& CostModel::Peak() {
+    static const MachinePeak peak = MeasurePeak();
+    return peak;
+}
+
+MachinePeak CostModel::MeasurePeak() {
+    PROFILE_ZONE("CostModel::MeasurePeak");
+    MachinePeak peak;
+    peak.flopsPerSecond = MeasureFlops();
+    peak.bytesPerSecond = MeasureBandwidth();
+    return peak;
+}
+
+bool CostModel::ParseShape(std::string_view text, TensorShape& shape) {
+    int64_t dims[4];
+    int count = 0;
+    while (!text.empty() && count < 4) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), dims[count]);
+        if (result.ec != std::errc() || dims[count] <= 0) return false;
+        ++count;
+        text.remove_prefix(static_cast<size_t>(result.ptr - text.data()));
+        if (!text.empty() && text.front() != 'x') return false;
+        if (!text.empty()) text.remove_prefix(1);
+    }
+    if (count == 0 || !text.empty()) return false;
+
+    int64_t padded[4] = {1, 1, 1, 1};
+    std::copy(dims, dims + count, padded + (4 - count));
+    shape = {padded[0], padded[1], padded[2], padded[3]};
+    return true;
+}
+
+NodeCost CostModel::Estimate(const AINode& node, const TensorShape& input, const MachinePeak& peak, const AIModel* model) {
+    NodeCost cost;
+    cost.input = input;
+
+    // Shape rule and FLOPs come from the node type's registered definition
+    const OperatorDef& def = OperatorRegistry::Find(node.type);
+    const double weights = def.estimate(model, node, input, cost);
+    const PrecisionPolicy policy = model ? model->GetPrecisionPolicy() : PrecisionPolicy();
+    if (OperatorRegistry::Supports(def, policy.weights)) cost.precision = policy.weights;
+    for (const auto& param : node.parameters) {
+        Precision precision;
+        if (param.first == "precision" && ParsePrecision(param.second, precision) && OperatorRegistry::Supports(def, precision)) {
+            cost.precision = precision;
+        }
+    }
+    cost.bytes += PrecisionBytes(policy.activations) * static_cast<double>(input.Elements() + cost.output.Elements()) +
+                  PrecisionBytes(cost.precision) * weights;
+    const double computeSeconds = peak.flopsPerSecond > 0.0 ? cost.flops / peak.flopsPerSecond : 0.0;
+    const double memorySeconds = peak.bytesPerSecond > 0.0 ? cost.bytes / peak.bytesPerSecond : 0.0;
+    cost.computeBound = computeSeconds >= memorySeconds;
+    cost.predictedSeconds = std::max(computeSeconds, memorySeconds);
+    return cost;
+}
+
+NodeCostMap CostModel::Analyze(const AIModel& model) {
+    PROFILE_ZONE("CostModel::Analyze");
+    const MachinePeak& peak = Peak();
+    const auto& nodes = model.GetNodes();
+
+    // Dependencies between node indices, in edge order
+    std::unordered_map<int, size_t> indexOf;
+    indexOf.reserve(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) indexOf[nodes[i].id] = i;
+    std::vector<std::vector<size_t>> successors(nodes.size());
+    std::vector<int> indegree(nodes.size(), 0);
+    std::vector<int> firstPredecessor(nodes.size(), -1);
+    for (const auto& edge : model.GetEdges()) {
+        const Port* fromPort = model.GetPort(edge.fromPortId);
+        const Port* toPort = model.GetPort(edge.toPortId);
+        if (!fromPort || !toPort) continue;
+        auto from = indexOf.find(fromPort->nodeId);
+        auto to = indexOf.find(toPort->nodeId);
+        if (from == indexOf.end() || to == indexOf.end()) continue;
+        successors[from->second].push_back(to->second);
+        ++indegree[to->second];
+        if (firstPredecessor[to->second] == -1) firstPredecessor[to->second] = static_cast<int>(from->second);
+    }
+
+    // Kahn order; nodes left on a cycle are estimated from their own input shape
+    std::vector<size_t> order;
+    order.reserve(nodes.size());
+    std::queue<size_t> ready;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (indegree[i] == 0) ready.push(i);
+    }
+    while (!ready.empty()) {
+        const size_t index = ready.front();
+        ready.pop();
+        order.push_back(index);
+        for (size_t succ : successors[index]) {
+            if (--indegree[succ] == 0) ready.push(succ);
+        }
+    }
+    std::vector<bool> ordered(nodes.size(), false);
+    for (size_t index : order) ordered[index] = true;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!ordered[i]) order.push_back(i);
+    }
+
+    NodeCostMap costs;
+    costs.reserve(nodes.size());
+    std::vector<TensorShape> outputs(nodes.size());
+    std::vector<bool> done(nodes.size(), false);
+    for (size_t index : order) {
+        const AINode& node = nodes[index];
+        // A node consumes what its first predecessor produces; only entry
+        // nodes (and nodes left on a cycle) take their declared input shape
+        TensorShape input{1, 3, 224, 224};
+        if (firstPredecessor[index] != -1 && done[firstPredecessor[index]]) {
+            input = outputs[firstPredecessor[index]];
+        } else {
+            ParseShape(ParamText(node, "input_shape"), input);
+        }
+        NodeCost cost = Estimate(node, input, peak, &model);
+        outputs[index] = cost.output;
+        done[index] = true;
+        costs.emplace(node.id, cost);
+    }
+    return costs;
+}
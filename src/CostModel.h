@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Tensor.h"
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+struct AINode;
+class AIModel;
+
+// Analytical per-node cost model.
+//
+// Shapes flow from the graph inputs (an entry node's "input_shape"
+// parameter, or 1x3x224x224) through each node type's shape rule, as
+// registered in the OperatorRegistry; FLOPs and bytes moved follow from the
+// shape and the node parameters (out_channels, kernel, stride, padding,
+// groups, units, ...), with weights and activations stored at the
+// precisions the node and the model's PrecisionPolicy select.
+// Predicted time is the roofline bound max(FLOPs / peak FLOP/s, bytes /
+// peak bandwidth) against peaks measured once per process by a small local
+// microbenchmark. Call and Loop nodes take shape and cost from the compiled
+// subgraph they run.
+
+struct NodeCost {
+    TensorShape input;
+    TensorShape output;
+    double flops = 0.0;
+    double bytes = 0.0;              // Inputs, weights and outputs read or written once
+    double predictedSeconds = 0.0;
+    bool computeBound = false;
+    Precision precision = Precision::FP32;   // Of the weights: "precision" parameter, else the model's policy
+
+    double Intensity() const { return bytes > 0.0 ? flops / bytes : 0.0; }  // FLOP/byte
+};
+
+struct MachinePeak {
+    double flopsPerSecond = 0.0;     // Single-thread FP32
+    double bytesPerSecond = 0.0;     // Streaming main-memory bandwidth
+    double RidgePoint() const { return bytesPerSecond > 0.0 ? flopsPerSecond / bytesPerSecond : 0.0; }
+};
+
+using NodeCostMap = std::unordered_map<int, NodeCost>;
+
+class CostModel {
+public:
+    // Measured on first use (a few tens of milliseconds), then cached
+    static const MachinePeak& Peak();
+    static MachinePeak MeasurePeak();
+
+    // model resolves Call and Loop subgraphs; without it they estimate as elementwise
+    static NodeCost Estimate(const AINode& node, const TensorShape& input, const MachinePeak& peak = Peak(),
+                             const AIModel* model = nullptr);
+    // Costs of every node, with shapes propagated in dependency order
+    static NodeCostMap Analyze(const AIModel& model);
+
+    // "NxCxHxW" (fewer dimensions fill from the right: "64" is 1x64x1x1)
+    static bool ParseShape(std::string_view text, TensorShape& shape);
+};
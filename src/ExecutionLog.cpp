@@ -0,0 +1,36 @@
+#include "ExecutionLog.h"
+
+ExecutionLog::~ExecutionLog() {
+    for (auto& block : blocks_) {
+        delete[] block.load();
+    }
+}
+
+void ExecutionLog::Reset(int numWorkers) {
+    // Blocks are kept for the next run; only the published size goes back to zero
+    size_.store(0, std::memory_order_release);
+    numWorkers_.store(numWorkers, std::memory_order_release);
+    finished_.store(false, std::memory_order_release);
+    endNs_.store(0, std::memory_order_release);
+    runId_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void ExecutionLog::Append(const Span& span) {
+    std::lock_guard<std::mutex> lock(appendMutex_);
+    const size_t index = size_.load(std::memory_order_relaxed);
+    const size_t blockIndex = index / kBlockSize;
+    if (blockIndex >= kMaxBlocks) return;
+
+    Span* block = blocks_[blockIndex].load(std::memory_order_relaxed);
+    if (!block) {
+        block = new Span[kBlockSize];
+        blocks_[blockIndex].store(block, std::memory_order_release);
+    }
+    block[index % kBlockSize] = span;
+    size_.store(index + 1, std::memory_order_release);
+}
+
+void ExecutionLog::MarkFinished(int64_t endNs) {
+    endNs_.store(endNs, std::memory_order_release);
+    finished_.store(true, std::memory_order_release);
+}
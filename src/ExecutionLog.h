@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Append-only record of the node spans of one execution run.
+//
+// Workers append a span as each node finishes; readers (the timeline panel)
+// read spans in place without copying or locking. Spans live in fixed-size
+// blocks that are never moved, and a span becomes visible only once Size()
+// has been published past it. Reset() must not race with readers, so call it
+// from the thread that reads (the UI thread starts runs).
+class ExecutionLog {
+public:
+    struct Span {
+        int nodeId;
+        int worker;          // Index of the worker that ran the node
+        int readyByNodeId;   // Predecessor whose completion made the node ready, -1 for entry nodes
+        int64_t startNs;     // Relative to the run start
+        int64_t endNs;
+    };
+
+    static constexpr size_t kBlockSize = 4096;
+    static constexpr size_t kMaxBlocks = 4096;  // ~16M spans per run
+
+    ExecutionLog() = default;
+    ~ExecutionLog();
+
+    ExecutionLog(const ExecutionLog&) = delete;
+    ExecutionLog& operator=(const ExecutionLog&) = delete;
+
+    void Reset(int numWorkers);
+    void Append(const Span& span);
+    void MarkFinished(int64_t endNs);
+
+    size_t Size() const { return size_.load(std::memory_order_acquire); }
+    const Span& operator[](size_t index) const {
+        return blocks_[index / kBlockSize].load(std::memory_order_relaxed)[index % kBlockSize];
+    }
+
+    int NumWorkers() const { return numWorkers_.load(std::memory_order_acquire); }
+    uint64_t RunId() const { return runId_.load(std::memory_order_acquire); }
+    bool Finished() const { return finished_.load(std::memory_order_acquire); }
+    int64_t EndNs() const { return endNs_.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<Span*> blocks_[kMaxBlocks] = {};
+    std::atomic<size_t> size_{0};
+    std::atomic<int> numWorkers_{0};
+    std::atomic<uint64_t> runId_{0};
+    std::atomic<bool> finished_{false};
+    std::atomic<int64_t> endNs_{0};
+    std::mutex appendMutex_;
+};
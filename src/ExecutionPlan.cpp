@@ -0,0 +1,425 @@
+#include "ExecutionPlan.h"
+#include "AIModel.h"
+#include "GraphOrder.h"
+#include "KernelTuner.h"
+#include "OperatorRegistry.h"
+#include "Metrics.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+// Largest weight tensor a node may materialize (256 MB of FP32)
+constexpr size_t kMaxWeightElements = size_t(64) << 20;
+
+// Deterministic weights in [-scale, scale], seeded by node id so every
+// compile of the same graph computes the same outputs
+void FillWeights(std::vector<float>& values, int nodeId, float scale) {
+    uint32_t state = 2166136261u ^ static_cast<uint32_t>(nodeId);
+    for (float& value : values) {
+        state = state * 1664525u + 1013904223u;
+        value = (static_cast<float>(state >> 8) / 8388608.0f - 1.0f) * scale;
+    }
+}
+
+std::string_view ParamText(const AINode& node, std::string_view key) {
+    for (const auto& param : node.parameters) {
+        if (param.first == key) return param.second;
+    }
+    return {};
+}
+
+// Parses "k" or "k|m|..." (values 0-63) into a mask of predicates
+bool ParseCondition(std::string_view text, uint64_t& mask) {
+    mask = 0;
+    while (true) {
+        const size_t bar = text.find('|');
+        const std::string_view item = text.substr(0, bar);
+        unsigned value = 0;
+        auto result = std::from_chars(item.data(), item.data() + item.size(), value);
+        if (item.empty() || result.ec != std::errc() || result.ptr != item.data() + item.size() || value > 63) return false;
+        mask |= uint64_t(1) << value;
+        if (bar == std::string_view::npos) return true;
+        text.remove_prefix(bar + 1);
+    }
+}
+
+// Conv2D parameters of a node that may take part in a depthwise-pointwise
+// fusion: FP32, with no kernel forced by "impl"
+bool FusableConv(const AIModel& model, const AINode& source, const NodeCostMap& costs, kernels::ConvParams& conv) {
+    auto cost = costs.find(source.id);
+    if (source.type != "Conv2D" || cost == costs.end() || cost->second.precision != Precision::FP32 ||
+        !ParamText(source, "impl").empty()) {
+        return false;
+    }
+    ExecutionPlan::Node scratch{};
+    scratch.name = std::string(source.name);
+    scratch.cost = cost->second;
+    size_t weightCount = 0;
+    if (!OperatorRegistry::Find(source.type).prepare(model, source, scratch, weightCount)) return false;
+    conv = scratch.conv;
+    return true;
+}
+
+void RunDepthwisePointwise(const ExecutionPlan::Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    const ExecutionPlan::Node& depthwise = *node.depthwise;
+    kernels::DepthwisePointwise(*inputs[0], depthwise.weights.data(), depthwise.bias.data(), depthwise.conv,
+                                depthwise.cost.output.c, node.weights.data(), node.bias.data(), output);
+}
+
+} // namespace
+
+int ExecutionPlan::IndexOf(int nodeId) const {
+    auto it = indexOf_.find(nodeId);
+    return it != indexOf_.end() ? static_cast<int>(it->second) : -1;
+}
+
+std::vector<bool> ExecutionPlan::AncestorCone(const std::vector<uint32_t>& targets) const {
+    std::vector<bool> inCone(nodes_.size(), false);
+    std::vector<uint32_t> stack;
+    for (uint32_t target : targets) {
+        if (target < nodes_.size() && !inCone[target]) {
+            inCone[target] = true;
+            stack.push_back(target);
+        }
+    }
+    while (!stack.empty()) {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+        const uint32_t* preds = Predecessors(node);
+        for (uint32_t p = 0; p < node.predecessorCount; ++p) {
+            if (!inCone[preds[p]]) {
+                inCone[preds[p]] = true;
+                stack.push_back(preds[p]);
+            }
+        }
+    }
+    return inCone;
+}
+
+std::shared_ptr<const ExecutionPlan> ExecutionPlan::Compile(const AIModel& model, const NodeCostMap& costs) {
+    PROFILE_ZONE("ExecutionPlan::Compile");
+    MemoryScope memScope(MemTag::Execution);
+    const auto& modelNodes = model.GetNodes();
+
+    // Node dependencies by model index, one (node, edge number) entry per edge
+    std::unordered_map<int, size_t> modelIndex;
+    modelIndex.reserve(modelNodes.size());
+    for (size_t i = 0; i < modelNodes.size(); ++i) modelIndex[modelNodes[i].id] = i;
+    std::vector<std::vector<std::pair<size_t, size_t>>> inputs(modelNodes.size());
+    std::vector<std::vector<std::pair<size_t, size_t>>> outputs(modelNodes.size());
+    std::vector<uint64_t> edgeConditions;
+    for (const auto& edge : model.GetEdges()) {
+        const Port* fromPort = model.GetPort(edge.fromPortId);
+        const Port* toPort = model.GetPort(edge.toPortId);
+        if (!fromPort || !toPort) continue;
+        auto from = modelIndex.find(fromPort->nodeId);
+        auto to = modelIndex.find(toPort->nodeId);
+        if (from == modelIndex.end() || to == modelIndex.end()) continue;
+
+        uint64_t condition = kAlways;
+        for (const auto& entry : edge.metadata) {
+            if (entry.first == "condition" && !ParseCondition(entry.second, condition)) {
+                std::cerr << "ExecutionPlan::Compile: edge " << fromPort->nodeId << "->" << toPort->nodeId
+                          << " has an invalid condition '" << entry.second << "'" << std::endl;
+                return nullptr;
+            }
+        }
+        outputs[from->second].emplace_back(to->second, edgeConditions.size());
+        inputs[to->second].emplace_back(from->second, edgeConditions.size());
+        edgeConditions.push_back(condition);
+    }
+
+    // Kahn order becomes the dense index order
+    std::vector<size_t> order;
+    order.reserve(modelNodes.size());
+    std::vector<size_t> indegree(modelNodes.size());
+    for (size_t i = 0; i < modelNodes.size(); ++i) {
+        indegree[i] = inputs[i].size();
+        if (indegree[i] == 0) order.push_back(i);
+    }
+    for (size_t head = 0; head < order.size(); ++head) {
+        for (const auto& succ : outputs[order[head]]) {
+            if (--indegree[succ.first] == 0) order.push_back(succ.first);
+        }
+    }
+    if (order.size() != modelNodes.size()) {
+        std::vector<int> nodeIds;
+        std::vector<std::pair<int, int>> dependencies;
+        for (size_t i = 0; i < modelNodes.size(); ++i) {
+            nodeIds.push_back(modelNodes[i].id);
+            for (const auto& succ : outputs[i]) dependencies.emplace_back(modelNodes[i].id, modelNodes[succ.first].id);
+        }
+        for (const auto& cycle : GraphOrder::FindCycles(nodeIds, dependencies)) {
+            std::cerr << "ExecutionPlan::Compile: graph has a cycle through nodes";
+            for (int nodeId : cycle) std::cerr << " " << nodeId;
+            std::cerr << std::endl;
+        }
+        return nullptr;
+    }
+
+    // Depthwise-pointwise pairs. The pointwise node reads the depthwise
+    // node's input over a new edge with the same condition; the depthwise
+    // node keeps its input and loses its output edge.
+    std::vector<size_t> fusedWith(modelNodes.size(), modelNodes.size());   // Pointwise <-> depthwise model index
+    for (size_t i = 0; i < modelNodes.size(); ++i) {
+        if (inputs[i].size() != 1 || outputs[i].size() != 1 || edgeConditions[outputs[i][0].second] != kAlways) continue;
+        const size_t pointwise = outputs[i][0].first;
+        kernels::ConvParams depthwiseConv, pointwiseConv;
+        if (inputs[pointwise].size() != 1 || !FusableConv(model, modelNodes[i], costs, depthwiseConv) ||
+            !FusableConv(model, modelNodes[pointwise], costs, pointwiseConv)) {
+            continue;
+        }
+        if (depthwiseConv.groups < 2 || depthwiseConv.groups != costs.at(modelNodes[i].id).input.c || pointwiseConv.kernel != 1 ||
+            pointwiseConv.stride != 1 || pointwiseConv.padding != 0 || pointwiseConv.groups != 1) {
+            continue;
+        }
+        const auto source = inputs[i][0];
+        outputs[i].clear();
+        inputs[pointwise][0] = {source.first, edgeConditions.size()};
+        outputs[source.first].emplace_back(pointwise, edgeConditions.size());
+        edgeConditions.push_back(edgeConditions[source.second]);
+        fusedWith[i] = pointwise;
+        fusedWith[pointwise] = i;
+    }
+
+    auto plan = std::make_shared<ExecutionPlan>();
+    plan->nodes_.reserve(order.size());
+    plan->activationPrecision_ = model.GetPrecisionPolicy().activations;
+    std::vector<uint32_t> denseIndex(modelNodes.size());
+    for (size_t i = 0; i < order.size(); ++i) denseIndex[order[i]] = static_cast<uint32_t>(i);
+
+    MetricsRegistry& metrics = MetricsRegistry::Global();
+    std::vector<uint32_t> edgeSlot(edgeConditions.size());        // Edge number -> predecessors_ index
+    std::vector<uint32_t> successorEdges;                          // successors_ index -> edge number
+    for (size_t i = 0; i < order.size(); ++i) {
+        const AINode& source = modelNodes[order[i]];
+        auto cost = costs.find(source.id);
+        if (cost == costs.end()) {
+            std::cerr << "ExecutionPlan::Compile: no cost estimate for node " << source.id << std::endl;
+            return nullptr;
+        }
+
+        Node node{};
+        node.id = source.id;
+        node.name = std::string(source.name);
+        node.type = std::string(source.type);
+        node.cost = cost->second;
+        node.priority = cost->second.predictedSeconds;
+        node.latency = &metrics.GetHistogram("aishow_node_latency_seconds", "Node execution latency by node type",
+                                             {{"type", node.type}});
+
+        // The cost model produced the shapes with the same definition
+        const OperatorDef& def = OperatorRegistry::Find(source.type);
+        const TensorShape& in = node.cost.input;
+        const TensorShape& out = node.cost.output;
+        size_t weightCount = 0;
+        node.op = &def;
+        if (!def.prepare(model, source, node, weightCount)) return nullptr;
+
+        if (weightCount > kMaxWeightElements) {
+            std::cerr << "ExecutionPlan::Compile: " << node.name << " needs " << weightCount * sizeof(float) / (1 << 20)
+                      << " MB of weights (limit " << kMaxWeightElements * sizeof(float) / (1 << 20) << " MB)" << std::endl;
+            return nullptr;
+        }
+        if (weightCount > 0) {
+            node.weights.resize(weightCount);
+            FillWeights(node.weights, node.id, 1.0f / std::sqrt(static_cast<float>(weightCount / out.c)));
+            node.bias.resize(static_cast<size_t>(out.c));
+            FillWeights(node.bias, ~node.id, 0.1f);
+        }
+
+        // Lower precisions quantize the same FP32 weights, so they stay
+        // comparable with the FP32 graph
+        node.precision = node.cost.precision;
+        if (node.precision == Precision::INT8) {
+            kernels::QuantizeRows(node.weights, out.c, node.weightsInt8, node.weightScales);
+            node.weights = std::vector<float>();
+            const std::string_view scale = ParamText(source, "input_scale");
+            node.inputScale = std::max(0.0f, std::strtof(std::string(scale).c_str(), nullptr));
+        } else if (IsHalf(node.precision)) {
+            node.weightsHalf.resize(node.weights.size());
+            kernels::Narrow(node.weights.data(), node.weights.size(), node.precision, node.weightsHalf.data());
+            node.weights = std::vector<float>();
+        }
+        node.firstPredecessor = static_cast<uint32_t>(plan->predecessors_.size());
+        node.predecessorCount = static_cast<uint32_t>(inputs[order[i]].size());
+        for (const auto& pred : inputs[order[i]]) {
+            // Some ops read all their inputs; the others read the first
+            if (def.sumsInputs && costs.at(modelNodes[pred.first].id).output.Elements() != in.Elements()) {
+                std::cerr << "ExecutionPlan::Compile: inputs of " << node.name << " have different sizes" << std::endl;
+                return nullptr;
+            }
+            edgeSlot[pred.second] = static_cast<uint32_t>(plan->predecessors_.size());
+            plan->predecessors_.push_back(denseIndex[pred.first]);
+        }
+        node.firstSuccessor = static_cast<uint32_t>(plan->successors_.size());
+        node.successorCount = static_cast<uint32_t>(outputs[order[i]].size());
+        node.conditional = false;
+        node.fused = fusedWith[order[i]] < modelNodes.size() && outputs[order[i]].empty();
+        plan->fusedCount_ += node.fused ? 1 : 0;
+        for (const auto& succ : outputs[order[i]]) {
+            plan->successors_.push_back(denseIndex[succ.first]);
+            plan->successorConditions_.push_back(edgeConditions[succ.second]);
+            successorEdges.push_back(static_cast<uint32_t>(succ.second));
+            node.conditional = node.conditional || edgeConditions[succ.second] != kAlways;
+        }
+
+        if (fusedWith[order[i]] < modelNodes.size() && !node.fused) {
+            // Kahn order put the depthwise node first, and nodes_ never reallocates
+            node.depthwise = &plan->nodes_[denseIndex[fusedWith[order[i]]]];
+            node.kernel = RunDepthwisePointwise;
+            node.kernelName = "conv2d_dw_pw";
+        } else {
+            // Chosen once the node is complete, so a tuner can run candidates
+            // on it; an "impl" parameter naming an applicable kernel overrides both
+            const OperatorDef::Kernel* kernel = nullptr;
+            const std::string_view impl = ParamText(source, "impl");
+            if (!impl.empty()) {
+                kernel = OperatorRegistry::FindKernel(def, impl);
+                if (!kernel || !OperatorRegistry::Applies(*kernel, node)) {
+                    std::cerr << "ExecutionPlan::Compile: " << node.name << ": kernel " << impl
+                              << " does not apply, using the default" << std::endl;
+                    kernel = nullptr;
+                }
+            }
+            KernelTuner* tuner = model.GetKernelTuner();
+            if (!kernel && tuner) {
+                std::vector<TensorShape> inputShapes;
+                for (const auto& pred : inputs[order[i]]) inputShapes.push_back(costs.at(modelNodes[pred.first].id).output);
+                if (inputShapes.empty()) inputShapes.push_back(in);
+                kernel = tuner->Choose(def, node, inputShapes);
+            }
+            if (!kernel) kernel = OperatorRegistry::SelectKernel(def, node);
+            if (kernel && kernel->prepare && !kernel->prepare(node)) {
+                // Falls back to the first applicable kernel that needs no preparation
+                const OperatorDef::Kernel* rejected = kernel;
+                kernel = nullptr;
+                for (const auto& candidate : def.kernels) {
+                    if (&candidate != rejected && !candidate.prepare && OperatorRegistry::Applies(candidate, node)) {
+                        kernel = &candidate;
+                        break;
+                    }
+                }
+            }
+            if (!kernel) {
+                std::cerr << "ExecutionPlan::Compile: no kernel for " << node.name << " (" << node.type << ")" << std::endl;
+                return nullptr;
+            }
+            node.kernel = kernel->run;
+            node.kernelName = kernel->name;
+        }
+
+        if (node.predecessorCount == 0) plan->entryNodes_.push_back(static_cast<uint32_t>(i));
+        plan->indexOf_[node.id] = static_cast<uint32_t>(i);
+        plan->nodes_.push_back(std::move(node));
+    }
+
+    plan->successorSlots_.reserve(successorEdges.size());
+    for (uint32_t edge : successorEdges) plan->successorSlots_.push_back(edgeSlot[edge]);
+
+    // Upward rank, sinks first
+    for (size_t i = plan->nodes_.size(); i-- > 0;) {
+        Node& node = plan->nodes_[i];
+        double longest = 0.0;
+        const uint32_t* succ = plan->Successors(node);
+        for (uint32_t s = 0; s < node.successorCount; ++s) longest = std::max(longest, plan->nodes_[succ[s]].priority);
+        node.priority += longest;
+    }
+
+    if (KernelTuner* tuner = model.GetKernelTuner()) tuner->Flush();
+    return plan;
+}
+
+uint64_t ExecutionPlan::Predicate(const Tensor& output) {
+    const size_t itemSize = output.shape.n > 0 ? output.Size() / static_cast<size_t>(output.shape.n) : 0;
+    if (itemSize == 0) return 0;
+    const size_t best = static_cast<size_t>(std::max_element(output.begin(), output.begin() + itemSize) - output.begin());
+    return best < 64 ? uint64_t(1) << best : 0;
+}
+
+void ExecutionPlan::RunInline(const Tensor& input, InlineState& state, Tensor& output) const {
+    state.tensors.resize(nodes_.size());
+    state.edgeLive.assign(predecessors_.size(), 0);
+    bool wroteOutput = false;
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        const Node& node = nodes_[i];
+        if (node.fused) continue;   // Its consumer runs it
+        InputList inputs(std::max<uint32_t>(node.predecessorCount, 1));
+        if (node.predecessorCount == 0) inputs.Push(&input);
+        const uint32_t* preds = Predecessors(node);
+        for (uint32_t p = 0; p < node.predecessorCount; ++p) {
+            if (state.edgeLive[node.firstPredecessor + p]) inputs.Push(&state.tensors[preds[p]]);
+        }
+        if (inputs.Count() == 0) continue;   // Branch not taken
+
+        Tensor* target = &output;
+        if (node.successorCount > 0) {
+            TensorShape shape = node.cost.output;
+            shape.n = input.shape.n;
+            target = &state.tensors[i];
+            if (target->shape != shape || target->Empty()) *target = Tensor(shape);
+        }
+        Evaluate(node, inputs.Data(), inputs.Count(), *target);
+        wroteOutput = wroteOutput || target == &output;
+
+        const uint64_t* conditions = SuccessorConditions(node);
+        const uint32_t* slots = SuccessorSlots(node);
+        const uint64_t predicate = node.conditional ? Predicate(*target) : kAlways;
+        for (uint32_t s = 0; s < node.successorCount; ++s) {
+            state.edgeLive[slots[s]] = (conditions[s] & predicate) != 0;
+        }
+    }
+    if (!wroteOutput) std::fill(output.Data(), output.Data() + output.Size(), 0.0f);
+}
+
+void ExecutionPlan::RunAll(const std::unordered_map<int, Tensor>& inputs, std::vector<Tensor>& tensors) const {
+    const int64_t batch = inputs.empty() ? 1 : inputs.begin()->second.shape.n;
+    std::vector<uint8_t> edgeLive(predecessors_.size(), 0);
+    tensors.assign(nodes_.size(), Tensor());
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        const Node& node = nodes_[i];
+        Tensor entryInput;
+        InputList nodeInputs(std::max<uint32_t>(node.predecessorCount, 1));
+        if (node.predecessorCount == 0) {
+            auto bound = inputs.find(node.id);
+            if (bound == inputs.end()) {
+                TensorShape shape = node.cost.input;
+                shape.n = batch;
+                entryInput = SyntheticInput(shape);
+            }
+            nodeInputs.Push(bound != inputs.end() ? &bound->second : &entryInput);
+        }
+        const uint32_t* preds = Predecessors(node);
+        for (uint32_t p = 0; p < node.predecessorCount; ++p) {
+            if (edgeLive[node.firstPredecessor + p]) nodeInputs.Push(&tensors[preds[p]]);
+        }
+        if (nodeInputs.Count() == 0) continue;   // Branch not taken
+
+        TensorShape shape = node.cost.output;
+        shape.n = batch;
+        tensors[i] = Tensor(shape);
+        Evaluate(node, nodeInputs.Data(), nodeInputs.Count(), tensors[i]);
+
+        const uint64_t* conditions = SuccessorConditions(node);
+        const uint32_t* slots = SuccessorSlots(node);
+        const uint64_t predicate = node.conditional ? Predicate(tensors[i]) : kAlways;
+        for (uint32_t s = 0; s < node.successorCount; ++s) edgeLive[slots[s]] = (conditions[s] & predicate) != 0;
+    }
+}
+
+Tensor ExecutionPlan::SyntheticInput(const TensorShape& shape) {
+    Tensor input(shape);
+    for (size_t i = 0; i < input.Size(); ++i) input[i] = static_cast<float>((i * 7919) % 255) / 255.0f;
+    return input;
+}
+
+bool ExecutionPlan::IsSingleEntrySink() const {
+    size_t sinks = 0;
+    for (const Node& node : nodes_) sinks += node.successorCount == 0 && !node.fused ? 1 : 0;
+    return entryNodes_.size() == 1 && sinks == 1;
+}
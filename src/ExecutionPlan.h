@@ -0,0 +1,167 @@
+#pragma once
+
+#include "CostModel.h"
+#include "Kernels.h"
+#include "Tensor.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class AIModel;
+class Histogram;
+struct OperatorDef;
+
+// Immutable, compiled form of a model graph.
+//
+// Nodes are stored in topological order under dense indices, with
+// predecessor/successor lists flattened into shared arrays, so a run needs
+// no lookups by node id. Shapes come from the cost model and every node's
+// weights are materialized once here, so any number of runs can execute the
+// same plan concurrently while the model itself keeps being edited.
+//
+// An edge whose metadata has a "condition" entry ("k" or "k|m|...", values
+// 0-63) is conditional: it only carries data when the source node's
+// predicate, the index of its largest output value, is one of the listed
+// values. Runs prune nodes none of whose inputs were taken.
+//
+// "Call" and "Loop" nodes re-enter a named subgraph (AIModel::DefineSubgraph),
+// compiled once into its own plan: Call runs it once on its input, Loop runs
+// it "iterations" times, feeding each pass's output back in as the carried
+// state. Subgraph passes run inline on the node's worker.
+//
+// What a node type means comes from the OperatorRegistry; compiling a node
+// resolves its definition and kernel once.
+//
+// A depthwise Conv2D read only by a 1x1 Conv2D (both FP32, neither with an
+// "impl" kernel) is fused into it: the pointwise node reads the depthwise
+// node's input and runs both a band of rows at a time, so the intermediate
+// never leaves cache. The depthwise node stays in the plan, without
+// successors, and runs only when a run asks for its output.
+class ExecutionPlan {
+public:
+    struct Node;
+    // Runs a node's operation; output is shaped for the run's batch and
+    // fully overwritten
+    using KernelFn = void (*)(const Node& node, const Tensor* const* inputs, int inputCount, Tensor& output);
+
+    // Condition mask of an unconditional edge; bit k is set if the edge is
+    // taken for predicate k
+    static constexpr uint64_t kAlways = ~uint64_t(0);
+
+    struct Node {
+        int id;
+        std::string name;
+        std::string type;
+        const OperatorDef* op;
+        KernelFn kernel;
+        const char* kernelName;       // Selected implementation, for reports
+        kernels::ConvParams conv;     // Conv2D; pooling uses kernel and stride
+        kernels::AttentionParams attention;   // Attention
+        NodeCost cost;                // Shapes and predicted time
+        double priority;              // Upward rank: longest predicted path to a sink
+        Precision precision;          // Resolved by the cost model from the "precision" parameter
+        std::vector<float> weights;   // Empty once quantized
+        std::vector<float> bias;
+        std::vector<int8_t> weightsInt8;   // INT8: weights quantized per output channel
+        std::vector<float> weightScales;   // INT8: real value per step, per output channel
+        std::vector<uint16_t> weightsHalf; // FP16 / BF16: weights in that format
+        std::vector<float> packedWeights;  // Weights in the selected kernel's own layout, if it has one
+        float inputScale;             // INT8: "input_scale" from calibration; 0 scales each input by its range
+        uint32_t firstPredecessor, predecessorCount;   // Edges into this node, in edge order
+        uint32_t firstSuccessor, successorCount;
+        bool conditional;             // Some outgoing edge has a condition
+        bool fused;                   // Depthwise node its pointwise consumer runs; runs itself only for its output
+        const Node* depthwise;        // Pointwise node running that fused node first, on the node's input
+        std::shared_ptr<const ExecutionPlan> body;   // Call and Loop: the subgraph
+        int64_t iterations;           // Loop: passes through the body
+        Histogram* latency;           // aishow_node_latency_seconds{type}
+    };
+
+    // Buffers of RunInline; callers keep one per plan and thread, across
+    // passes and runs, so re-entering allocates nothing
+    struct InlineState {
+        std::vector<Tensor> tensors;
+        std::vector<uint8_t> edgeLive;
+    };
+
+    // Input pointers of one node evaluation: on the stack for the usual few
+    // inputs, on the heap for nodes with more predecessors
+    class InputList {
+    public:
+        explicit InputList(size_t capacity)
+            : heap_(capacity > kInline ? capacity : 0),
+              data_(heap_.empty() ? inline_ : heap_.data()) {}
+        InputList(const InputList&) = delete;
+        InputList& operator=(const InputList&) = delete;
+
+        void Push(const Tensor* tensor) { data_[count_++] = tensor; }
+        const Tensor* const* Data() const { return data_; }
+        int Count() const { return count_; }
+
+    private:
+        static constexpr size_t kInline = 8;
+        const Tensor* inline_[kInline];
+        std::vector<const Tensor*> heap_;
+        const Tensor** data_;
+        int count_ = 0;
+    };
+
+    // Returns nullptr (and reports why) if the graph has a cycle or a node
+    // cannot be materialized
+    static std::shared_ptr<const ExecutionPlan> Compile(const AIModel& model, const NodeCostMap& costs);
+
+    static void Evaluate(const Node& node, const Tensor* const* inputs, int inputCount, Tensor& output) {
+        node.kernel(node, inputs, inputCount, output);
+    }
+    // Predicate of a conditional node: bit k for the index k of its largest
+    // output value, taken from the first batch item
+    static uint64_t Predicate(const Tensor& output);
+
+    // Runs the whole plan on the calling thread: the single entry node reads
+    // input and the single sink writes output, or zeros if a conditional
+    // edge pruned the sink. For subgraph plans.
+    void RunInline(const Tensor& input, InlineState& state, Tensor& output) const;
+    // One entry and one sink node, as subgraphs need
+    bool IsSingleEntrySink() const;
+    // Runs every node on the calling thread and keeps every output, by plan
+    // index (empty for branches not taken). inputs maps entry node ids to
+    // their inputs, which set the batch; other entries read SyntheticInput.
+    // For analysis passes such as calibration.
+    void RunAll(const std::unordered_map<int, Tensor>& inputs, std::vector<Tensor>& tensors) const;
+
+    // What an entry node reads when its run binds no input
+    static Tensor SyntheticInput(const TensorShape& shape);
+
+    // Depthwise nodes fused into their consumer
+    size_t FusedCount() const { return fusedCount_; }
+
+    // Format runs hold node outputs in between nodes (PrecisionPolicy::activations)
+    Precision ActivationPrecision() const { return activationPrecision_; }
+
+    size_t Size() const { return nodes_.size(); }
+    size_t EdgeCount() const { return predecessors_.size(); }
+    const Node& operator[](size_t index) const { return nodes_[index]; }
+    const uint32_t* Predecessors(const Node& node) const { return predecessors_.data() + node.firstPredecessor; }
+    const uint32_t* Successors(const Node& node) const { return successors_.data() + node.firstSuccessor; }
+    // Per outgoing edge: its condition mask, and its position in the target's predecessor list
+    const uint64_t* SuccessorConditions(const Node& node) const { return successorConditions_.data() + node.firstSuccessor; }
+    const uint32_t* SuccessorSlots(const Node& node) const { return successorSlots_.data() + node.firstSuccessor; }
+    const std::vector<uint32_t>& EntryNodes() const { return entryNodes_; }
+    int IndexOf(int nodeId) const;
+
+    // Nodes the targets depend on, targets included, by reverse reachability
+    std::vector<bool> AncestorCone(const std::vector<uint32_t>& targets) const;
+
+private:
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> predecessors_;
+    std::vector<uint32_t> successors_;
+    std::vector<uint64_t> successorConditions_;
+    std::vector<uint32_t> successorSlots_;        // Index into predecessors_ of the same edge
+    std::vector<uint32_t> entryNodes_;
+    std::unordered_map<int, uint32_t> indexOf_;
+    Precision activationPrecision_ = Precision::FP32;
+    size_t fusedCount_ = 0;
+};
@@ -0,0 +1,132 @@
+#include "ExecutionTrace.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+
+const char kMagic[4] = {'A', 'I', 'X', 'T'};
+
+void WriteFixed(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+void WriteVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void WriteSigned(std::string& out, int64_t value) {
+    WriteVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+// Reads advance 'pos' and return false on truncated input
+bool ReadFixed(const std::string& in, size_t& pos, uint64_t& value, int bytes) {
+    if (in.size() - pos < static_cast<size_t>(bytes)) return false;
+    value = 0;
+    for (int i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(static_cast<unsigned char>(in[pos++])) << (8 * i);
+    return true;
+}
+
+bool ReadVarint(const std::string& in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        const unsigned char byte = static_cast<unsigned char>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool ReadSigned(const std::string& in, size_t& pos, int64_t& value) {
+    uint64_t raw;
+    if (!ReadVarint(in, pos, raw)) return false;
+    value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+    return true;
+}
+
+} // namespace
+
+ExecutionTrace ExecutionTrace::FromLog(const ExecutionLog& log, uint64_t graphFingerprint) {
+    ExecutionTrace trace;
+    trace.graphFingerprint = graphFingerprint;
+    trace.numWorkers = log.NumWorkers();
+    trace.endNs = log.EndNs();
+    const size_t size = log.Size();
+    trace.spans.reserve(size);
+    for (size_t i = 0; i < size; ++i) trace.spans.push_back(log[i]);
+    return trace;
+}
+
+bool ExecutionTrace::Save(const std::string& filename) const {
+    std::string out(kMagic, sizeof(kMagic));
+    WriteFixed(out, kVersion, 4);
+    WriteFixed(out, graphFingerprint, 8);
+    WriteVarint(out, static_cast<uint64_t>(numWorkers));
+    WriteVarint(out, static_cast<uint64_t>(endNs));
+    WriteVarint(out, spans.size());
+
+    int64_t previousStart = 0;
+    for (const auto& span : spans) {
+        WriteSigned(out, span.nodeId);
+        WriteVarint(out, static_cast<uint64_t>(span.worker));
+        WriteSigned(out, span.readyByNodeId);
+        WriteSigned(out, span.startNs - previousStart);
+        WriteVarint(out, static_cast<uint64_t>(span.endNs - span.startNs));
+        previousStart = span.startNs;
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return file.good();
+}
+
+bool ExecutionTrace::Load(const std::string& filename, ExecutionTrace& trace) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+    const std::string in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    size_t pos = sizeof(kMagic);
+    uint64_t version, numWorkers, endNs, count;
+    if (in.compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) != 0 ||
+        !ReadFixed(in, pos, version, 4) || version != kVersion) {
+        std::cerr << "ExecutionTrace: " << filename << " is not a version " << kVersion << " trace" << std::endl;
+        return false;
+    }
+    if (!ReadFixed(in, pos, trace.graphFingerprint, 8) || !ReadVarint(in, pos, numWorkers) ||
+        !ReadVarint(in, pos, endNs) || !ReadVarint(in, pos, count)) {
+        std::cerr << "ExecutionTrace: truncated header in " << filename << std::endl;
+        return false;
+    }
+    trace.numWorkers = static_cast<int>(numWorkers);
+    trace.endNs = static_cast<int64_t>(endNs);
+
+    // Every record takes at least five bytes, which bounds a corrupt count
+    trace.spans.clear();
+    trace.spans.reserve(std::min<uint64_t>(count, (in.size() - pos) / 5));
+    int64_t previousStart = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        int64_t nodeId, readyBy, startDelta;
+        uint64_t worker, duration;
+        if (!ReadSigned(in, pos, nodeId) || !ReadVarint(in, pos, worker) || !ReadSigned(in, pos, readyBy) ||
+            !ReadSigned(in, pos, startDelta) || !ReadVarint(in, pos, duration)) {
+            std::cerr << "ExecutionTrace: truncated span " << i << " in " << filename << std::endl;
+            return false;
+        }
+        previousStart += startDelta;
+        trace.spans.push_back({static_cast<int>(nodeId), static_cast<int>(worker), static_cast<int>(readyBy),
+                               previousStart, previousStart + static_cast<int64_t>(duration)});
+    }
+    return true;
+}
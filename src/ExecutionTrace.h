@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ExecutionLog.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Recorded schedule of one execution run: which worker ran each node, when,
+// and which predecessor released it. Saved in a compact binary format so a
+// slow run can be replayed and analysed offline without recomputing it.
+//
+// File layout (little-endian): "AIXT", u32 version, u64 graph fingerprint,
+// then varints numWorkers, endNs and span count, followed by one record per
+// span in recording order: zigzag nodeId, worker, zigzag readyByNodeId,
+// zigzag start delta from the previous span, duration.
+struct ExecutionTrace {
+    static constexpr uint32_t kVersion = 1;
+
+    uint64_t graphFingerprint = 0;  // AIModel::GraphFingerprint() of the recorded graph
+    int numWorkers = 0;
+    int64_t endNs = 0;
+    std::vector<ExecutionLog::Span> spans;
+
+    // Copy a finished run out of the log
+    static ExecutionTrace FromLog(const ExecutionLog& log, uint64_t graphFingerprint);
+
+    bool Save(const std::string& filename) const;
+    static bool Load(const std::string& filename, ExecutionTrace& trace);
+};
@@ -0,0 +1,235 @@
+#include "ExecutorService.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+namespace {
+thread_local ExecutorService::TaskContext currentTask;
+} // namespace
+
+ExecutorService::ExecutorService(int numWorkers) {
+    if (numWorkers <= 0) numWorkers = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+
+    MetricsRegistry& metrics = MetricsRegistry::Global();
+    queueDepthMetric_ = &metrics.GetGauge("aishow_ready_queue_depth", "Nodes ready to run but not yet picked up by a worker");
+    workerBusyMetric_ = &metrics.GetCounter("aishow_worker_busy_seconds_total", "Time workers spent executing nodes");
+    workerAvailableMetric_ = &metrics.GetCounter("aishow_worker_available_seconds_total", "Time workers were alive");
+
+    MemoryScope memScope(MemTag::Execution);
+    workers_.reserve(static_cast<size_t>(numWorkers));
+    for (int i = 0; i < numWorkers; ++i) {
+        workers_.emplace_back(&ExecutorService::WorkerLoop, this, i);
+    }
+}
+
+ExecutorService::~ExecutorService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workAvailable_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+ExecutorService& ExecutorService::Shared() {
+    static ExecutorService service;
+    return service;
+}
+
+ExecutorService::TaskContext ExecutorService::Current() {
+    return currentTask;
+}
+
+ExecutorService::ClientId ExecutorService::RegisterClient(const ClientOptions& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const ClientId id = nextClientId_++;
+    Client& client = clients_[id];
+    client.id = id;
+    client.options = options;
+    client.options.weight = std::max(options.weight, 1e-6);
+    client.virtualTime = systemVirtualTime_;
+    client.queueDepthMetric = &MetricsRegistry::Global().GetGauge(
+        "aishow_executor_client_queue_depth", "Tasks queued per executor client", {{"client", options.name}});
+    return id;
+}
+
+void ExecutorService::UnregisterClient(ClientId client) {
+    CancelAndWait(client);
+    std::lock_guard<std::mutex> lock(mutex_);
+    clients_.erase(client);
+}
+
+void ExecutorService::SetWeight(ClientId client, double weight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = clients_.find(client);
+    if (it != clients_.end()) it->second.options.weight = std::max(weight, 1e-6);
+}
+
+void ExecutorService::SetMaxConcurrency(ClientId client, int maxConcurrency) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = clients_.find(client);
+        if (it != clients_.end()) it->second.options.maxConcurrency = maxConcurrency;
+    }
+    // A raised limit may make queued tasks eligible
+    workAvailable_.notify_all();
+}
+
+void ExecutorService::Submit(ClientId clientId, double priority, double cost, Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = clients_.find(clientId);
+        if (it == clients_.end()) {
+            std::cerr << "ExecutorService::Submit: unknown client " << clientId << std::endl;
+            return;
+        }
+        Client& client = it->second;
+        // Returning from idle: start at the system virtual time, not behind it
+        if (client.queue.empty() && client.running == 0) {
+            client.virtualTime = std::max(client.virtualTime, systemVirtualTime_);
+        }
+        client.queue.push_back({priority, nextSequence_++, std::max(cost, 0.0), std::move(task)});
+        std::push_heap(client.queue.begin(), client.queue.end());
+        ++queuedTasks_;
+        client.queueDepthMetric->Set(static_cast<double>(client.queue.size()));
+        queueDepthMetric_->Set(static_cast<double>(queuedTasks_));
+    }
+    workAvailable_.notify_one();
+}
+
+void ExecutorService::ParallelFor(ClientId client, int64_t count, int helpers, const std::function<void(int64_t)>& body) {
+    struct Shared {
+        std::atomic<int64_t> next{0};
+        std::atomic<int64_t> finished{0};
+        int64_t count;
+        const std::function<void(int64_t)>* body;   // Only called while items remain, so while the caller waits
+        std::mutex mutex;
+        std::condition_variable allFinished;
+    };
+    auto shared = std::make_shared<Shared>();
+    shared->count = count;
+    shared->body = &body;
+    auto work = [](Shared& state) {
+        int64_t ran = 0;
+        for (int64_t i = state.next.fetch_add(1); i < state.count; i = state.next.fetch_add(1), ++ran) (*state.body)(i);
+        if (ran > 0 && state.finished.fetch_add(ran) + ran == state.count) {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.allFinished.notify_all();
+        }
+    };
+
+    helpers = static_cast<int>(std::min<int64_t>(helpers, count - 1));
+    for (int h = 0; h < helpers; ++h) {
+        Submit(client, std::numeric_limits<double>::max(), 0.0, [shared, work](int) { work(*shared); });
+    }
+    work(*shared);
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->allFinished.wait(lock, [&]() { return shared->finished.load() == count; });
+}
+
+void ExecutorService::CancelAndWait(ClientId clientId) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = clients_.find(clientId);
+    if (it == clients_.end()) return;
+    Client& client = it->second;
+    auto dropQueued = [this, &client]() {
+        queuedTasks_ -= client.queue.size();
+        client.queue.clear();
+        client.queueDepthMetric->Set(0.0);
+        queueDepthMetric_->Set(static_cast<double>(queuedTasks_));
+    };
+    dropQueued();
+    taskFinished_.wait(lock, [&client]() { return client.running == 0; });
+    // Tasks that were running may have submitted follow-ups meanwhile
+    dropQueued();
+}
+
+ExecutorService::ClientStats ExecutorService::GetClientStats(ClientId clientId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClientStats stats;
+    auto it = clients_.find(clientId);
+    if (it == clients_.end()) return stats;
+    stats.queued = it->second.queue.size();
+    stats.running = it->second.running;
+    stats.completed = it->second.completed;
+    stats.busySeconds = it->second.busySeconds;
+    return stats;
+}
+
+int ExecutorService::ConcurrencyLimit(const Client& client) const {
+    const int poolSize = NumWorkers();
+    return client.options.maxConcurrency > 0 ? std::min(client.options.maxConcurrency, poolSize) : poolSize;
+}
+
+ExecutorService::Client* ExecutorService::PickClient() {
+    Client* best = nullptr;
+    for (auto& entry : clients_) {
+        Client& client = entry.second;
+        if (client.queue.empty() || client.running >= ConcurrencyLimit(client)) continue;
+        if (!best || client.virtualTime < best->virtualTime) best = &client;
+    }
+    return best;
+}
+
+void ExecutorService::WorkerLoop(int index) {
+    MemoryScope memScope(MemTag::Execution);
+    PROFILE_THREAD_NAME("worker");
+    // Time alive is credited as it passes, at least once per idle second, so
+    // the counter keeps up with busy time on workers that never exit
+    auto credited = std::chrono::steady_clock::now();
+    auto creditAvailable = [&]() {
+        const auto now = std::chrono::steady_clock::now();
+        workerAvailableMetric_->Increment(std::chrono::duration<double>(now - credited).count());
+        credited = now;
+    };
+
+    for (;;) {
+        Client* client = nullptr;
+        QueuedTask next;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!workAvailable_.wait_for(lock, std::chrono::seconds(1),
+                                            [&]() { return stopping_ || (client = PickClient()) != nullptr; })) {
+                creditAvailable();
+            }
+            if (stopping_) break;
+
+            std::pop_heap(client->queue.begin(), client->queue.end());
+            next = std::move(client->queue.back());
+            client->queue.pop_back();
+            --queuedTasks_;
+            ++client->running;
+            systemVirtualTime_ = client->virtualTime;
+            client->virtualTime += next.cost / client->options.weight;
+            client->queueDepthMetric->Set(static_cast<double>(client->queue.size()));
+            queueDepthMetric_->Set(static_cast<double>(queuedTasks_));
+        }
+
+        const auto taskStart = std::chrono::steady_clock::now();
+        currentTask = {this, client->id};
+        next.task(index);
+        currentTask = {};
+        const double busy = std::chrono::duration<double>(std::chrono::steady_clock::now() - taskStart).count();
+        creditAvailable();   // First, so busy never runs ahead of it
+        workerBusyMetric_->Increment(busy);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --client->running;
+            ++client->completed;
+            client->busySeconds += busy;
+        }
+        taskFinished_.notify_all();
+        // The finished task may have freed a slot under a client's limit
+        workAvailable_.notify_one();
+    }
+
+    creditAvailable();
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Metrics.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Worker pool shared by every AIModel in the process.
+//
+// Each model registers as a client with a weight and a concurrency limit and
+// submits node tasks to its own queue. Workers pick the next task from the
+// eligible client (queue not empty, below its limit) with the smallest
+// virtual time, then advance that client's virtual time by the task cost
+// divided by its weight (start-time weighted fair queuing). A client that
+// was idle resumes at the current system virtual time, so idling does not
+// bank credit. Within a client, tasks run highest priority first.
+class ExecutorService {
+public:
+    using ClientId = int;
+    // Runs on a worker; receives the worker's index in [0, NumWorkers())
+    using Task = std::function<void(int worker)>;
+
+    struct ClientOptions {
+        std::string name = "model";
+        double weight = 1.0;
+        int maxConcurrency = 0;   // Tasks in flight at once; 0 = no limit beyond the pool size
+    };
+
+    // Pool and client of the task running on a thread
+    struct TaskContext {
+        ExecutorService* executor = nullptr;
+        ClientId client = 0;
+    };
+
+    struct ClientStats {
+        size_t queued = 0;
+        int running = 0;
+        uint64_t completed = 0;
+        double busySeconds = 0.0;
+    };
+
+    explicit ExecutorService(int numWorkers = 0);   // 0 = hardware concurrency
+    ~ExecutorService();
+
+    ExecutorService(const ExecutorService&) = delete;
+    ExecutorService& operator=(const ExecutorService&) = delete;
+
+    // Process-wide pool used by models that are not given one explicitly
+    static ExecutorService& Shared();
+    // The calling thread's task, so a kernel can split its work among tasks
+    // of the same client; a null executor outside tasks
+    static TaskContext Current();
+
+    ClientId RegisterClient(const ClientOptions& options);
+    // Cancels the client's queued tasks and waits for its running ones
+    void UnregisterClient(ClientId client);
+    void SetWeight(ClientId client, double weight);
+    void SetMaxConcurrency(ClientId client, int maxConcurrency);
+
+    // 'cost' is the expected work (e.g. predicted seconds) charged against the
+    // client's share; 'priority' orders tasks within the client
+    void Submit(ClientId client, double priority, double cost, Task task);
+
+    // Runs body(i) for every i in [0, count) on the calling thread and on up
+    // to 'helpers' tasks of the client. The caller claims items too and waits
+    // only for items already started, so a task may call it without holding
+    // up the pool; helpers that start late find nothing left.
+    void ParallelFor(ClientId client, int64_t count, int helpers, const std::function<void(int64_t)>& body);
+
+    // Drop queued tasks and wait until none of the client's tasks is running.
+    // Must not be called from a task.
+    void CancelAndWait(ClientId client);
+
+    int NumWorkers() const { return static_cast<int>(workers_.size()); }
+    ClientStats GetClientStats(ClientId client) const;
+
+private:
+    struct QueuedTask {
+        double priority;
+        uint64_t sequence;   // FIFO among equal priorities
+        double cost;
+        Task task;
+        bool operator<(const QueuedTask& other) const {
+            return priority != other.priority ? priority < other.priority : sequence > other.sequence;
+        }
+    };
+
+    struct Client {
+        ClientId id = 0;
+        ClientOptions options;
+        std::vector<QueuedTask> queue;   // Max-heap on QueuedTask::operator<
+        double virtualTime = 0.0;
+        int running = 0;
+        uint64_t completed = 0;
+        double busySeconds = 0.0;
+        Gauge* queueDepthMetric = nullptr;
+    };
+
+    void WorkerLoop(int index);
+    Client* PickClient();
+    int ConcurrencyLimit(const Client& client) const;
+
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable workAvailable_;
+    std::condition_variable taskFinished_;
+    std::unordered_map<ClientId, Client> clients_;
+    ClientId nextClientId_ = 1;
+    uint64_t nextSequence_ = 0;
+    double systemVirtualTime_ = 0.0;
+    size_t queuedTasks_ = 0;
+    bool stopping_ = false;
+
+    Gauge* queueDepthMetric_ = nullptr;
+    Counter* workerBusyMetric_ = nullptr;
+    Counter* workerAvailableMetric_ = nullptr;
+};
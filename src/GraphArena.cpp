@@ -0,0 +1,98 @@
+#include "GraphArena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+GraphArena::GraphArena(std::pmr::memory_resource* upstream)
+    : upstream_(upstream), interned_(this) {
+}
+
+GraphArena::~GraphArena() {
+    Release();
+}
+
+std::string_view GraphArena::Intern(std::string_view text) {
+    auto it = interned_.find(text);
+    if (it != interned_.end()) return *it;
+
+    char* copy = static_cast<char*>(Bump(strings_, text.size() + 1, 1));
+    std::memcpy(copy, text.data(), text.size());
+    copy[text.size()] = '\0';
+    std::string_view stored(copy, text.size());
+    interned_.insert(stored);
+    stringBytes_ += text.size() + 1;
+    return stored;
+}
+
+void GraphArena::BeginCompaction() {
+    Free(oldStrings_);
+    std::swap(oldStrings_, strings_);
+    InternSet(this).swap(interned_);
+    stringBytes_ = 0;
+}
+
+void GraphArena::EndCompaction() {
+    Free(oldStrings_);
+    compactedStringBytes_ = stringBytes_;
+}
+
+void GraphArena::Release() {
+    // The intern table lives in the arena too; drop it before its chunks go
+    InternSet(this).swap(interned_);
+
+    Free(blocks_);
+    Free(strings_);
+    Free(oldStrings_);
+    stringBytes_ = compactedStringBytes_ = 0;
+    std::fill(std::begin(freeLists_), std::end(freeLists_), nullptr);
+}
+
+void GraphArena::Free(Region& region) {
+    for (const auto& chunk : region.chunks) {
+        upstream_->deallocate(chunk.memory, chunk.size, alignof(std::max_align_t));
+        bytesReserved_ -= chunk.size;
+    }
+    region = Region();
+}
+
+void* GraphArena::Bump(Region& region, size_t bytes, size_t alignment) {
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(region.cursor) + alignment - 1) & ~(alignment - 1);
+    if (!region.cursor || aligned + bytes > reinterpret_cast<uintptr_t>(region.limit)) {
+        // Chunks grow geometrically so a large bulk load needs few of them
+        size_t chunkSize = std::max(region.nextChunkSize, bytes + alignment);
+        region.nextChunkSize = std::min(region.nextChunkSize * 2, kMaxChunkSize);
+        void* memory = upstream_->allocate(chunkSize, alignof(std::max_align_t));
+        region.chunks.push_back({memory, chunkSize});
+        bytesReserved_ += chunkSize;
+        region.cursor = static_cast<char*>(memory);
+        region.limit = region.cursor + chunkSize;
+        aligned = (reinterpret_cast<uintptr_t>(region.cursor) + alignment - 1) & ~(alignment - 1);
+    }
+    region.cursor = reinterpret_cast<char*>(aligned + bytes);
+    return reinterpret_cast<void*>(aligned);
+}
+
+void* GraphArena::do_allocate(size_t bytes, size_t alignment) {
+    if (bytes > kMaxPooledSize || alignment > kGranularity) {
+        return upstream_->allocate(bytes, alignment);
+    }
+
+    const size_t cls = (std::max<size_t>(bytes, 1) - 1) / kGranularity;
+    if (FreeBlock* block = freeLists_[cls]) {
+        freeLists_[cls] = block->next;
+        return block;
+    }
+    return Bump(blocks_, (cls + 1) * kGranularity, kGranularity);
+}
+
+void GraphArena::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+    if (bytes > kMaxPooledSize || alignment > kGranularity) {
+        upstream_->deallocate(ptr, bytes, alignment);
+        return;
+    }
+
+    const size_t cls = (std::max<size_t>(bytes, 1) - 1) / kGranularity;
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = freeLists_[cls];
+    freeLists_[cls] = block;
+}
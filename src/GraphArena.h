@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Memory resource backing a model graph (nodes, ports, edges and their strings).
+//
+// Small blocks are carved from large chunks: a bulk load just bumps a pointer
+// through the current chunk, and blocks released by later edits go onto
+// per-size-class free lists to be reused. Blocks larger than kMaxPooledSize are
+// passed straight to the upstream resource. Release() returns every chunk at
+// once, so clearing a graph costs a handful of deallocations regardless of its
+// size.
+//
+// Strings are interned: Intern() returns a view of a single NUL-terminated copy.
+// They live in chunks of their own, so values that edits replaced can be
+// reclaimed: between BeginCompaction() and EndCompaction() the owner
+// re-interns every view it still holds into fresh chunks, and EndCompaction()
+// frees the old ones. A view stays valid until Release() or the next
+// compaction.
+//
+// Not thread-safe; the owning model serializes mutations.
+class GraphArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t kMaxPooledSize = 1024;
+
+    explicit GraphArena(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+    ~GraphArena() override;
+
+    GraphArena(const GraphArena&) = delete;
+    GraphArena& operator=(const GraphArena&) = delete;
+
+    std::string_view Intern(std::string_view text);
+
+    // True once interned strings take well over twice what the last
+    // compaction kept, i.e. most of them are probably no longer referenced
+    bool StringsNeedCompaction() const { return stringBytes_ > 2 * compactedStringBytes_ + kMinChunkSize; }
+    // Old strings stay readable until EndCompaction; Intern copies anew
+    void BeginCompaction();
+    void EndCompaction();
+
+    // Free all chunks. Every container allocating from this arena must already
+    // have released its memory.
+    void Release();
+
+    size_t ChunkCount() const { return blocks_.chunks.size() + strings_.chunks.size(); }
+    size_t BytesReserved() const { return bytesReserved_; }
+    size_t InternedCount() const { return interned_.size(); }
+    size_t StringBytes() const { return stringBytes_; }   // Interned since the last compaction, NULs included
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kClassCount = kMaxPooledSize / kGranularity;
+    static constexpr size_t kMinChunkSize = 64 * 1024;
+    static constexpr size_t kMaxChunkSize = 4 * 1024 * 1024;
+
+    struct FreeBlock { FreeBlock* next; };
+    struct Chunk { void* memory; size_t size; };
+    // Chunks bumped through in order: one region for blocks, one for strings
+    struct Region {
+        std::vector<Chunk> chunks;
+        char* cursor = nullptr;
+        char* limit = nullptr;
+        size_t nextChunkSize = kMinChunkSize;
+    };
+
+    void* Bump(Region& region, size_t bytes, size_t alignment);
+    void Free(Region& region);
+
+    std::pmr::memory_resource* upstream_;
+    Region blocks_;
+    Region strings_;
+    Region oldStrings_;   // During a compaction
+    size_t bytesReserved_ = 0;
+    size_t stringBytes_ = 0;
+    size_t compactedStringBytes_ = 0;
+    FreeBlock* freeLists_[kClassCount] = {};
+
+    using InternSet = std::pmr::unordered_set<std::string_view>;
+    InternSet interned_;
+};
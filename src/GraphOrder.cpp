@@ -0,0 +1,288 @@
+#include "GraphOrder.h"
+#include <algorithm>
+#include <deque>
+#include <limits>
+
+namespace {
+constexpr uint32_t kNoTarget = std::numeric_limits<uint32_t>::max();
+
+// Removes one entry with the given value, if any
+void EraseOne(std::vector<uint32_t>& values, uint32_t value) {
+    auto it = std::find(values.begin(), values.end(), value);
+    if (it != values.end()) {
+        *it = values.back();
+        values.pop_back();
+    }
+}
+}
+
+void GraphOrder::Clear() {
+    nodes_.clear();
+    free_.clear();
+    slots_.clear();
+    nextPosition_ = 0;
+    searchMark_ = 0;
+}
+
+void GraphOrder::AddNode(int nodeId) {
+    Slot(nodeId);
+}
+
+uint32_t GraphOrder::Slot(int nodeId) {
+    auto it = slots_.find(nodeId);
+    if (it != slots_.end()) return it->second;
+
+    // New nodes go last, which no existing edge can contradict
+    uint32_t slot;
+    if (!free_.empty()) {
+        slot = free_.back();
+        free_.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+    nodes_[slot].id = nodeId;
+    nodes_[slot].position = nextPosition_++;
+    nodes_[slot].mark = 0;
+    slots_.emplace(nodeId, slot);
+    return slot;
+}
+
+void GraphOrder::RemoveNode(int nodeId) {
+    auto it = slots_.find(nodeId);
+    if (it == slots_.end()) return;
+    const uint32_t slot = it->second;
+    Node& node = nodes_[slot];
+    for (uint32_t succ : node.out) {
+        if (succ != slot) EraseOne(nodes_[succ].in, slot);
+    }
+    for (uint32_t pred : node.in) {
+        if (pred != slot) EraseOne(nodes_[pred].out, slot);
+    }
+    node.out.clear();
+    node.in.clear();
+    free_.push_back(slot);
+    slots_.erase(it);
+}
+
+bool GraphOrder::AddEdge(int fromNodeId, int toNodeId, std::vector<int>* cycle) {
+    const uint32_t from = Slot(fromNodeId);
+    const uint32_t to = Slot(toNodeId);
+    if (from == to) {
+        if (cycle) *cycle = {fromNodeId};
+        return false;
+    }
+
+    const int64_t lower = nodes_[to].position;
+    const int64_t upper = nodes_[from].position;
+    if (upper < lower) {
+        nodes_[from].out.push_back(to);
+        nodes_[to].in.push_back(from);
+        return true;
+    }
+
+    if (++searchMark_ == 0) {
+        for (Node& node : nodes_) node.mark = 0;
+        searchMark_ = 1;
+    }
+
+    // Forward from the target, no further than the source's position: reaching
+    // the source means the edge would close a cycle
+    std::vector<uint32_t> forward;
+    std::unordered_map<uint32_t, uint32_t> parents;
+    if (Search(to, upper, true, from, forward, cycle ? &parents : nullptr)) {
+        if (cycle) {
+            cycle->clear();
+            for (uint32_t node = from; node != to; node = parents[node]) cycle->push_back(nodes_[node].id);
+            cycle->push_back(toNodeId);
+            std::reverse(cycle->begin(), cycle->end());
+        }
+        return false;
+    }
+    std::vector<uint32_t> backward;
+    Search(from, lower, false, kNoTarget, backward, nullptr);
+
+    // Everything that reaches the source moves ahead of everything the target
+    // reaches, reusing the positions the two sets occupied
+    auto byPosition = [this](uint32_t a, uint32_t b) { return nodes_[a].position < nodes_[b].position; };
+    std::sort(backward.begin(), backward.end(), byPosition);
+    std::sort(forward.begin(), forward.end(), byPosition);
+    std::vector<int64_t> positions;
+    positions.reserve(backward.size() + forward.size());
+    for (uint32_t node : backward) positions.push_back(nodes_[node].position);
+    for (uint32_t node : forward) positions.push_back(nodes_[node].position);
+    std::sort(positions.begin(), positions.end());
+    size_t next = 0;
+    for (uint32_t node : backward) nodes_[node].position = positions[next++];
+    for (uint32_t node : forward) nodes_[node].position = positions[next++];
+
+    nodes_[from].out.push_back(to);
+    nodes_[to].in.push_back(from);
+    return true;
+}
+
+bool GraphOrder::Search(uint32_t start, int64_t bound, bool forward, uint32_t target, std::vector<uint32_t>& visited,
+                        std::unordered_map<uint32_t, uint32_t>* parents) {
+    std::vector<uint32_t> stack{start};
+    nodes_[start].mark = searchMark_;
+    visited.push_back(start);
+    while (!stack.empty()) {
+        const uint32_t current = stack.back();
+        stack.pop_back();
+        for (uint32_t next : forward ? nodes_[current].out : nodes_[current].in) {
+            if (next == target) {
+                if (parents) (*parents)[next] = current;
+                return true;
+            }
+            Node& node = nodes_[next];
+            if (node.mark == searchMark_) continue;
+            if (forward ? node.position > bound : node.position < bound) continue;
+            node.mark = searchMark_;
+            if (parents) (*parents)[next] = current;
+            visited.push_back(next);
+            stack.push_back(next);
+        }
+    }
+    return false;
+}
+
+void GraphOrder::Unlink(uint32_t from, uint32_t to) {
+    EraseOne(nodes_[from].out, to);
+    EraseOne(nodes_[to].in, from);
+}
+
+void GraphOrder::RemoveEdge(int fromNodeId, int toNodeId) {
+    // Removing an edge never invalidates the order
+    auto from = slots_.find(fromNodeId);
+    auto to = slots_.find(toNodeId);
+    if (from != slots_.end() && to != slots_.end()) Unlink(from->second, to->second);
+}
+
+bool GraphOrder::AddEdges(const std::vector<std::pair<int, int>>& edges) {
+    std::vector<std::pair<uint32_t, uint32_t>> added;
+    added.reserve(edges.size());
+    for (const auto& edge : edges) {
+        const uint32_t from = Slot(edge.first);
+        const uint32_t to = Slot(edge.second);
+        nodes_[from].out.push_back(to);
+        nodes_[to].in.push_back(from);
+        added.emplace_back(from, to);
+    }
+
+    // Kahn over the whole graph, ties broken by the current order
+    std::vector<uint32_t> live;
+    live.reserve(slots_.size());
+    for (const auto& entry : slots_) live.push_back(entry.second);
+    std::sort(live.begin(), live.end(), [this](uint32_t a, uint32_t b) { return nodes_[a].position < nodes_[b].position; });
+    std::vector<uint32_t> indegree(nodes_.size(), 0);
+    std::deque<uint32_t> ready;
+    for (uint32_t node : live) {
+        indegree[node] = static_cast<uint32_t>(nodes_[node].in.size());
+        if (indegree[node] == 0) ready.push_back(node);
+    }
+    std::vector<uint32_t> order;
+    order.reserve(live.size());
+    while (!ready.empty()) {
+        const uint32_t node = ready.front();
+        ready.pop_front();
+        order.push_back(node);
+        for (uint32_t succ : nodes_[node].out) {
+            if (--indegree[succ] == 0) ready.push_back(succ);
+        }
+    }
+
+    if (order.size() != live.size()) {
+        for (const auto& edge : added) Unlink(edge.first, edge.second);
+        return false;
+    }
+    nextPosition_ = 0;
+    for (uint32_t node : order) nodes_[node].position = nextPosition_++;
+    return true;
+}
+
+std::vector<int> GraphOrder::Order() const {
+    std::vector<std::pair<int64_t, int>> ranked;
+    ranked.reserve(slots_.size());
+    for (const auto& entry : slots_) ranked.emplace_back(nodes_[entry.second].position, entry.first);
+    std::sort(ranked.begin(), ranked.end());
+    std::vector<int> ids;
+    ids.reserve(ranked.size());
+    for (const auto& entry : ranked) ids.push_back(entry.second);
+    return ids;
+}
+
+std::vector<std::vector<int>> GraphOrder::FindCycles(const std::vector<int>& nodeIds,
+                                                     const std::vector<std::pair<int, int>>& edges) {
+    // Dense indices and a CSR successor list
+    std::unordered_map<int, uint32_t> indexOf;
+    indexOf.reserve(nodeIds.size());
+    for (int id : nodeIds) indexOf.emplace(id, static_cast<uint32_t>(indexOf.size()));
+    const size_t count = indexOf.size();
+    std::vector<int> idOf(count);
+    for (const auto& entry : indexOf) idOf[entry.second] = entry.first;
+    std::vector<uint32_t> firstEdge(count + 1, 0);
+    std::vector<bool> selfLoop(count, false);
+    std::vector<std::pair<uint32_t, uint32_t>> dense;
+    dense.reserve(edges.size());
+    for (const auto& edge : edges) {
+        auto from = indexOf.find(edge.first);
+        auto to = indexOf.find(edge.second);
+        if (from == indexOf.end() || to == indexOf.end()) continue;
+        if (from->second == to->second) selfLoop[from->second] = true;
+        dense.emplace_back(from->second, to->second);
+        ++firstEdge[from->second + 1];
+    }
+    for (size_t i = 0; i < count; ++i) firstEdge[i + 1] += firstEdge[i];
+    std::vector<uint32_t> targets(dense.size());
+    std::vector<uint32_t> fill(firstEdge.begin(), firstEdge.end() - 1);
+    for (const auto& edge : dense) targets[fill[edge.first]++] = edge.second;
+
+    // Tarjan with an explicit call stack, so long chains cannot overflow ours
+    constexpr uint32_t kUnvisited = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> index(count, kUnvisited), lowLink(count, 0);
+    std::vector<bool> onStack(count, false);
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t, uint32_t>> calls;   // (node, next edge)
+    std::vector<std::vector<int>> cycles;
+    uint32_t nextIndex = 0;
+    for (uint32_t root = 0; root < count; ++root) {
+        if (index[root] != kUnvisited) continue;
+        calls.emplace_back(root, firstEdge[root]);
+        index[root] = lowLink[root] = nextIndex++;
+        stack.push_back(root);
+        onStack[root] = true;
+        while (!calls.empty()) {
+            const uint32_t node = calls.back().first;
+            uint32_t& edge = calls.back().second;
+            if (edge < firstEdge[node + 1]) {
+                const uint32_t next = targets[edge++];
+                if (index[next] == kUnvisited) {
+                    index[next] = lowLink[next] = nextIndex++;
+                    stack.push_back(next);
+                    onStack[next] = true;
+                    calls.emplace_back(next, firstEdge[next]);
+                } else if (onStack[next]) {
+                    lowLink[node] = std::min(lowLink[node], index[next]);
+                }
+                continue;
+            }
+
+            calls.pop_back();
+            if (!calls.empty()) lowLink[calls.back().first] = std::min(lowLink[calls.back().first], lowLink[node]);
+            if (lowLink[node] != index[node]) continue;
+            std::vector<int> component;
+            uint32_t member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = false;
+                component.push_back(idOf[member]);
+            } while (member != node);
+            if (component.size() > 1 || selfLoop[node]) {
+                std::reverse(component.begin(), component.end());
+                cycles.push_back(std::move(component));
+            }
+        }
+    }
+    return cycles;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Topological order of a model graph kept up to date under edits, so edges
+// that would close a cycle are refused when they are inserted.
+//
+// Every node holds a position and every edge points from a lower to a
+// higher one (Pearce & Kelly's dynamic topological sort). An inserted edge
+// that already agrees with the order costs O(1). Otherwise only nodes whose
+// positions lie between the two endpoints are searched, forward from the
+// target and backward from the source, and just those are reordered; the
+// forward search reaching the source means the edge would close a cycle.
+//
+// Nodes are keyed by model node id. Parallel edges are counted, so removing
+// one of two edges between the same nodes keeps the dependency.
+class GraphOrder {
+public:
+    void Clear();
+    void AddNode(int nodeId);
+    void RemoveNode(int nodeId);    // Together with its edges
+
+    // False, leaving the graph unchanged, if the edge would close a cycle;
+    // cycle (if given) then receives the closed path to -> ... -> from
+    bool AddEdge(int fromNodeId, int toNodeId, std::vector<int>* cycle = nullptr);
+    void RemoveEdge(int fromNodeId, int toNodeId);
+    // Adds many edges with a single Kahn pass that replaces the order, for
+    // bulk loads; false, adding nothing, if they contain a cycle
+    bool AddEdges(const std::vector<std::pair<int, int>>& edges);
+
+    size_t NodeCount() const { return slots_.size(); }
+    // Node ids by position
+    std::vector<int> Order() const;
+
+    // Node sets of the graph's cycles: strongly connected components of more
+    // than one node, plus self loops. Tarjan's algorithm, O(V + E).
+    static std::vector<std::vector<int>> FindCycles(const std::vector<int>& nodeIds,
+                                                    const std::vector<std::pair<int, int>>& edges);
+
+private:
+    struct Node {
+        int id;
+        int64_t position;
+        uint32_t mark;                  // Search that last visited the node
+        std::vector<uint32_t> out;      // Node indices, one entry per edge
+        std::vector<uint32_t> in;
+    };
+
+    // Nodes reachable from start within the position bound, forward (up to
+    // an upper bound) or backward (down to a lower bound)
+    bool Search(uint32_t start, int64_t bound, bool forward, uint32_t target, std::vector<uint32_t>& visited,
+                std::unordered_map<uint32_t, uint32_t>* parents);
+    uint32_t Slot(int nodeId);
+    void Unlink(uint32_t from, uint32_t to);
+
+    std::vector<Node> nodes_;           // Removed nodes leave free entries
+    std::vector<uint32_t> free_;
+    std::unordered_map<int, uint32_t> slots_;
+    int64_t nextPosition_ = 0;
+    uint32_t searchMark_ = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Scalar conversions between FP32 and the 16-bit storage formats, rounding
+// to nearest even. Bulk conversions are kernels::Widen / kernels::Narrow.
+
+inline uint16_t FloatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const uint32_t magnitude = bits & 0x7fffffffu;
+    if (magnitude >= 0x7f800000u) return sign | (magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u);   // NaN, infinity
+    if (magnitude >= 0x477ff000u) return sign | 0x7c00u;   // Rounds past 65504
+    if (magnitude < 0x38800000u) {
+        // Subnormal (or zero): units of 2^-24; a carry into 1024 is the smallest normal
+        return sign | static_cast<uint16_t>(std::nearbyint(std::fabs(value) * 16777216.0f));
+    }
+    const uint32_t rounded = magnitude + 0xfffu + ((magnitude >> 13) & 1u);
+    return sign | static_cast<uint16_t>((rounded - 0x38000000u) >> 13);
+}
+
+inline float HalfToFloat(uint16_t half) {
+    // Exponent and mantissa moved into FP32 position and rebased by 2^112,
+    // which is exact for normal and subnormal halves alike
+    const uint32_t shifted = static_cast<uint32_t>(half & 0x7fffu) << 13;
+    uint32_t bits;
+    if ((half & 0x7c00u) == 0x7c00u) {
+        bits = shifted | 0x7f800000u;   // Infinity, NaN
+    } else {
+        float magnitude;
+        std::memcpy(&magnitude, &shifted, sizeof(magnitude));
+        magnitude *= 5.192296858534828e33f;   // 2^112
+        std::memcpy(&bits, &magnitude, sizeof(bits));
+    }
+    bits |= static_cast<uint32_t>(half & 0x8000u) << 16;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline uint16_t FloatToBf16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffffu) > 0x7f800000u) return static_cast<uint16_t>((bits >> 16) | 0x40u);   // Quiet NaN
+    return static_cast<uint16_t>((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+}
+
+inline float Bf16ToFloat(uint16_t bf16) {
+    const uint32_t bits = static_cast<uint32_t>(bf16) << 16;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
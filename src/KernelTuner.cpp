@@ -0,0 +1,252 @@
+#include "KernelTuner.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+namespace {
+
+std::string Trim(std::string text) {
+    const size_t first = text.find_first_not_of(" \t");
+    const size_t last = text.find_last_not_of(" \t\r\n");
+    return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+}
+
+std::string BrandString() {
+    unsigned int regs[12] = {};
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int top = __get_cpuid_max(0x80000000u, nullptr);
+    if (top < 0x80000004u) return {};
+    for (unsigned int leaf = 0; leaf < 3; ++leaf) {
+        __get_cpuid(0x80000002u + leaf, &regs[leaf * 4], &regs[leaf * 4 + 1], &regs[leaf * 4 + 2], &regs[leaf * 4 + 3]);
+    }
+#elif defined(_M_X64) || defined(_M_IX86)
+    int info[4];
+    __cpuid(info, static_cast<int>(0x80000000u));
+    if (static_cast<unsigned int>(info[0]) < 0x80000004u) return {};
+    for (int leaf = 0; leaf < 3; ++leaf) __cpuid(reinterpret_cast<int*>(&regs[leaf * 4]), static_cast<int>(0x80000002u) + leaf);
+#else
+    return {};
+#endif
+    return Trim(std::string(reinterpret_cast<const char*>(regs), sizeof(regs)).c_str());
+}
+
+std::string ShapeText(const TensorShape& shape) {
+    return std::to_string(shape.n) + "x" + std::to_string(shape.c) + "x" + std::to_string(shape.h) + "x" + std::to_string(shape.w);
+}
+
+} // namespace
+
+KernelTuner::KernelTuner(std::string cacheFile)
+    : cacheFile_(std::move(cacheFile)) {
+    Load();
+}
+
+KernelTuner::~KernelTuner() {
+    Flush();
+}
+
+void KernelTuner::SetTuning(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tuning_ = enabled;
+}
+
+size_t KernelTuner::Tuned() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tuned_;
+}
+
+size_t KernelTuner::CacheHits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cacheHits_;
+}
+
+const std::string& KernelTuner::CpuModel() {
+    static const std::string model = []() {
+        std::string name = BrandString();
+        if (name.empty()) {
+            // Other architectures: the first descriptive line of /proc/cpuinfo
+            std::ifstream cpuinfo("/proc/cpuinfo");
+            std::string line;
+            while (name.empty() && std::getline(cpuinfo, line)) {
+                if (line.rfind("model name", 0) == 0 || line.rfind("Hardware", 0) == 0 || line.rfind("CPU part", 0) == 0) {
+                    const size_t colon = line.find(':');
+                    if (colon != std::string::npos) name = Trim(line.substr(colon + 1));
+                }
+            }
+        }
+        std::replace(name.begin(), name.end(), '\t', ' ');
+        return name.empty() ? std::string("unknown") : name;
+    }();
+    return model;
+}
+
+std::string KernelTuner::Key(const ExecutionPlan::Node& node, const std::vector<TensorShape>& inputShapes) {
+    std::ostringstream key;
+    key << node.type << " " << ShapeText(node.cost.input);
+    // Further inputs only when there are any, so single-input keys read as before
+    for (size_t i = 1; i < inputShapes.size(); ++i) key << "+" << ShapeText(inputShapes[i]);
+    key << " " << ShapeText(node.cost.output) << " k" << node.conv.kernel << "s" << node.conv.stride << "p" << node.conv.padding
+        << "g" << node.conv.groups << " " << PrecisionName(node.precision);
+    return key.str();
+}
+
+const OperatorDef::Kernel* KernelTuner::Choose(const OperatorDef& def, const ExecutionPlan::Node& node,
+                                               const std::vector<TensorShape>& inputShapes) {
+    std::vector<const OperatorDef::Kernel*> candidates;
+    for (const auto& kernel : def.kernels) {
+        if (OperatorRegistry::Applies(kernel, node)) candidates.push_back(&kernel);
+    }
+    if (candidates.size() <= 1) return candidates.empty() ? nullptr : candidates[0];
+
+    const std::string key = CpuModel() + "\t" + Key(node, inputShapes);
+    // Requires mutex_
+    auto cachedChoice = [&]() -> const OperatorDef::Kernel* {
+        auto cached = entries_.find(key);
+        if (cached == entries_.end()) return nullptr;
+        for (const auto* kernel : candidates) {
+            if (cached->second.kernel == kernel->name) return kernel;
+        }
+        return nullptr;
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const OperatorDef::Kernel* kernel = cachedChoice()) {
+            ++cacheHits_;
+            return kernel;
+        }
+        if (!tuning_) return candidates[0];
+    }
+
+    // Timed without the lock; two compiles of the same shapes may both time
+    // them, and the first result stored wins
+    PROFILE_ZONE("KernelTuner::Tune");
+    const OperatorDef::Kernel* best = nullptr;
+    double bestSeconds = 0.0;
+    for (const auto* kernel : candidates) {
+        const double seconds = Measure(*kernel, node, inputShapes);
+        if (seconds < 0.0) continue;
+        if (!best || seconds < bestSeconds) {
+            best = kernel;
+            bestSeconds = seconds;
+        }
+    }
+    if (!best) return candidates[0];
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (const OperatorDef::Kernel* kernel = cachedChoice()) {
+        ++cacheHits_;
+        return kernel;
+    }
+    entries_[key] = {best->name, bestSeconds};
+    dirty_ = true;
+    ++tuned_;
+    return best;
+}
+
+double KernelTuner::Measure(const OperatorDef::Kernel& kernel, const ExecutionPlan::Node& node,
+                            const std::vector<TensorShape>& inputShapes) {
+    // Kernels with their own data run on a prepared copy; the plan prepares
+    // only the winner
+    ExecutionPlan::Node prepared;
+    if (kernel.prepare) {
+        prepared = node;
+        if (!kernel.prepare(prepared)) return -1.0;
+    }
+    const ExecutionPlan::Node& target = kernel.prepare ? prepared : node;
+    std::vector<Tensor> tensors;
+    tensors.reserve(std::max<size_t>(inputShapes.size(), 1));
+    if (inputShapes.empty()) tensors.push_back(ExecutionPlan::SyntheticInput(target.cost.input));
+    for (const TensorShape& shape : inputShapes) tensors.push_back(ExecutionPlan::SyntheticInput(shape));
+    ExecutionPlan::InputList inputs(tensors.size());
+    for (const Tensor& tensor : tensors) inputs.Push(&tensor);
+    Tensor output(target.cost.output);
+
+    // Best of several runs after a warm-up, bounded to a few milliseconds
+    using Clock = std::chrono::steady_clock;
+    kernel.run(target, inputs.Data(), inputs.Count(), output);
+    double best = 0.0;
+    double total = 0.0;
+    for (int rep = 0; rep < 20 && (rep < 3 || total < 0.005); ++rep) {
+        const auto start = Clock::now();
+        kernel.run(target, inputs.Data(), inputs.Count(), output);
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        best = rep == 0 ? seconds : std::min(best, seconds);
+        total += seconds;
+    }
+    return best;
+}
+
+bool KernelTuner::Load() {
+    if (cacheFile_.empty()) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ReadCache(cacheFile_, entries_);
+}
+
+bool KernelTuner::ReadCache(const std::string& path, std::unordered_map<std::string, Entry>& entries) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    // cpu<TAB>key<TAB>kernel<TAB>seconds
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t cpuEnd = line.find('\t');
+        const size_t keyEnd = cpuEnd == std::string::npos ? cpuEnd : line.find('\t', cpuEnd + 1);
+        const size_t kernelEnd = keyEnd == std::string::npos ? keyEnd : line.find('\t', keyEnd + 1);
+        if (kernelEnd == std::string::npos) continue;
+        entries.emplace(line.substr(0, keyEnd), Entry{line.substr(keyEnd + 1, kernelEnd - keyEnd - 1),
+                                                      std::strtod(line.c_str() + kernelEnd + 1, nullptr)});
+    }
+    return true;
+}
+
+bool KernelTuner::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!dirty_ || cacheFile_.empty()) return true;
+
+    // Other processes (the editor and aishow_serve share the default file)
+    // may have flushed since Load; their entries are kept, and this tuner's
+    // choices win where both timed the same key
+    ReadCache(cacheFile_, entries_);
+
+    // Written beside the cache and renamed over it, so a crash or a
+    // concurrent flush leaves either the old file or a complete new one
+    const std::string temporary = cacheFile_ + ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream file(temporary);
+        if (!file.is_open()) {
+            std::cerr << "KernelTuner: cannot write " << temporary << std::endl;
+            return false;
+        }
+        const std::map<std::string, Entry> sorted(entries_.begin(), entries_.end());
+        for (const auto& entry : sorted) {
+            file << entry.first << "\t" << entry.second.kernel << "\t" << entry.second.seconds << "\n";
+        }
+        file.close();
+        if (!file) {
+            std::cerr << "KernelTuner: cannot write " << temporary << std::endl;
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    // Windows' rename does not replace an existing file
+    if (std::rename(temporary.c_str(), cacheFile_.c_str()) != 0 &&
+        (std::remove(cacheFile_.c_str()) != 0 || std::rename(temporary.c_str(), cacheFile_.c_str()) != 0)) {
+        std::cerr << "KernelTuner: cannot replace " << cacheFile_ << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ExecutionPlan.h"
+#include "OperatorRegistry.h"
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Chooses among the kernels an op registers by timing each applicable one on
+// the node's actual shapes, once per host.
+//
+// Choices are keyed by op type, input and output shapes, kernel parameters and
+// precision, and kept in a text cache file under the CPU model name, so
+// later loads of any model reuse them and tuning cost is paid once per host
+// (the file may hold entries for several hosts). Set on a model with
+// AIModel::SetKernelTuner; plan compilation then asks it instead of taking
+// each op's first kernel. Thread-safe, so one tuner can serve every model.
+class KernelTuner {
+public:
+    // Loads cacheFile if it exists; an empty name keeps choices in memory only
+    explicit KernelTuner(std::string cacheFile = "aishow_kernels.cache");
+    ~KernelTuner();
+
+    KernelTuner(const KernelTuner&) = delete;
+    KernelTuner& operator=(const KernelTuner&) = delete;
+
+    // With tuning off only cached choices are used; unknown nodes get the
+    // op's first applicable kernel
+    void SetTuning(bool enabled);
+
+    // Kernel for a prepared plan node (weights materialized) reading inputs
+    // of these shapes, one per predecessor (the node's own input for entry
+    // nodes); nullptr if none applies. Candidates are timed without holding
+    // the tuner, so compiles in other models are not held up.
+    const OperatorDef::Kernel* Choose(const OperatorDef& def, const ExecutionPlan::Node& node,
+                                      const std::vector<TensorShape>& inputShapes);
+    // Writes new choices to the cache file, merged with entries other
+    // processes have added since it was loaded; the file is replaced whole,
+    // so readers never see a partial write
+    bool Flush();
+
+    size_t Tuned() const;       // Choices measured by this tuner
+    size_t CacheHits() const;   // Choices answered from the cache
+
+    // Processor name the cache is keyed by, e.g. the x86 brand string
+    static const std::string& CpuModel();
+    static std::string Key(const ExecutionPlan::Node& node, const std::vector<TensorShape>& inputShapes);
+
+private:
+    struct Entry {
+        std::string kernel;
+        double seconds;
+    };
+
+    bool Load();
+    // Adds the file's "cpu\tkey" entries to entries, keeping ones already there
+    static bool ReadCache(const std::string& path, std::unordered_map<std::string, Entry>& entries);
+    // Seconds per run, or negative if the kernel's prepare rejects the node
+    static double Measure(const OperatorDef::Kernel& kernel, const ExecutionPlan::Node& node,
+                          const std::vector<TensorShape>& inputShapes);
+
+    const std::string cacheFile_;
+    mutable std::mutex mutex_;
+    bool tuning_ = true;
+    bool dirty_ = false;
+    // (cpu, key) -> choice, as "cpu\tkey"; other hosts' entries are kept for Flush
+    std::unordered_map<std::string, Entry> entries_;
+    size_t tuned_ = 0;
+    size_t cacheHits_ = 0;
+};
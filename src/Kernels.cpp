@@ -0,0 +1,931 @@
+#include "Kernels.h"
+#include "Half.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#if defined(__F16C__) || defined(__AVX512BF16__)
+#include <immintrin.h>
+#endif
+
+namespace kernels {
+
+void Conv2D(const Tensor& input, const float* weights, const float* bias, const ConvParams& params, Tensor& output) {
+    const TensorShape& in = input.shape;
+    const TensorShape& out = output.shape;
+    const int64_t inPerGroup = in.c / params.groups;
+    const int64_t outPerGroup = out.c / params.groups;
+    const int64_t k = params.kernel;
+
+    for (int64_t n = 0; n < out.n; ++n) {
+        for (int64_t oc = 0; oc < out.c; ++oc) {
+            const int64_t group = oc / outPerGroup;
+            const float* filter = weights + oc * inPerGroup * k * k;
+            float* dst = output.Data() + ((n * out.c + oc) * out.h) * out.w;
+            std::fill(dst, dst + out.h * out.w, bias[oc]);
+
+            // Accumulate one input channel and kernel tap at a time so the
+            // inner loop runs along contiguous output columns
+            for (int64_t ic = 0; ic < inPerGroup; ++ic) {
+                const float* src = input.Data() + ((n * in.c + group * inPerGroup + ic) * in.h) * in.w;
+                for (int64_t ky = 0; ky < k; ++ky) {
+                    for (int64_t kx = 0; kx < k; ++kx) {
+                        const float weight = filter[(ic * k + ky) * k + kx];
+                        for (int64_t oy = 0; oy < out.h; ++oy) {
+                            const int64_t iy = oy * params.stride + ky - params.padding;
+                            if (iy < 0 || iy >= in.h) continue;
+                            const float* srcRow = src + iy * in.w;
+                            float* dstRow = dst + oy * out.w;
+                            // Output columns whose tap lands inside the input row
+                            const int64_t lastInput = in.w - 1 + params.padding - kx;
+                            if (lastInput < 0) continue;
+                            const int64_t firstX = std::max<int64_t>(0, (params.padding - kx + params.stride - 1) / params.stride);
+                            const int64_t lastX = std::min<int64_t>(out.w, lastInput / params.stride + 1);
+                            for (int64_t ox = firstX; ox < lastX; ++ox) {
+                                dstRow[ox] += weight * srcRow[ox * params.stride + kx - params.padding];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Conv2DIm2col(const Tensor& input, const float* weights, const float* bias, const ConvParams& params, Tensor& output) {
+    const TensorShape& in = input.shape;
+    const TensorShape& out = output.shape;
+    const int64_t inPerGroup = in.c / params.groups;
+    const int64_t outPerGroup = out.c / params.groups;
+    const int64_t k = params.kernel;
+    const int64_t rows = inPerGroup * k * k;   // One per (input channel, tap), in Conv2D's order
+    const int64_t plane = out.h * out.w;
+    thread_local std::vector<float> columns;
+    columns.resize(static_cast<size_t>(rows * plane));
+
+    for (int64_t n = 0; n < out.n; ++n) {
+        for (int64_t group = 0; group < params.groups; ++group) {
+            // Padding taps read zeros, which leaves the sums unchanged
+            for (int64_t ic = 0; ic < inPerGroup; ++ic) {
+                const float* src = input.Data() + ((n * in.c + group * inPerGroup + ic) * in.h) * in.w;
+                for (int64_t ky = 0; ky < k; ++ky) {
+                    for (int64_t kx = 0; kx < k; ++kx) {
+                        float* column = columns.data() + ((ic * k + ky) * k + kx) * plane;
+                        for (int64_t oy = 0; oy < out.h; ++oy) {
+                            const int64_t iy = oy * params.stride + ky - params.padding;
+                            for (int64_t ox = 0; ox < out.w; ++ox) {
+                                const int64_t ix = ox * params.stride + kx - params.padding;
+                                column[oy * out.w + ox] = iy >= 0 && iy < in.h && ix >= 0 && ix < in.w ? src[iy * in.w + ix] : 0.0f;
+                            }
+                        }
+                    }
+                }
+            }
+
+            for (int64_t oc = group * outPerGroup; oc < (group + 1) * outPerGroup; oc += 4) {
+                const int64_t count = std::min<int64_t>(4, (group + 1) * outPerGroup - oc);
+                float* dst[4];
+                const float* filter[4];
+                for (int64_t i = 0; i < 4; ++i) {
+                    const int64_t channel = oc + std::min(i, count - 1);
+                    dst[i] = output.Data() + (n * out.c + channel) * plane;
+                    filter[i] = weights + channel * rows;
+                    std::fill(dst[i], dst[i] + plane, bias[channel]);
+                }
+                if (count == 4) {
+                    for (int64_t row = 0; row < rows; ++row) {
+                        const float* column = columns.data() + row * plane;
+                        const float w0 = filter[0][row], w1 = filter[1][row], w2 = filter[2][row], w3 = filter[3][row];
+                        for (int64_t i = 0; i < plane; ++i) {
+                            dst[0][i] += w0 * column[i];
+                            dst[1][i] += w1 * column[i];
+                            dst[2][i] += w2 * column[i];
+                            dst[3][i] += w3 * column[i];
+                        }
+                    }
+                } else {
+                    for (int64_t c = 0; c < count; ++c) {
+                        for (int64_t row = 0; row < rows; ++row) {
+                            const float* column = columns.data() + row * plane;
+                            const float w = filter[c][row];
+                            for (int64_t i = 0; i < plane; ++i) dst[c][i] += w * column[i];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <int64_t K, int64_t Stride, int64_t Padding>
+void Conv2DFixed(const Tensor& input, const float* weights, const float* bias, const ConvParams& params, Tensor& output) {
+    const TensorShape& in = input.shape;
+    const TensorShape& out = output.shape;
+    const int64_t inPerGroup = in.c / params.groups;
+    const int64_t outPerGroup = out.c / params.groups;
+    // Output columns whose taps all land inside the input row
+    const int64_t firstFull = std::min<int64_t>(out.w, (Padding + Stride - 1) / Stride);
+    const int64_t lastTap = in.w - K + Padding;
+    const int64_t lastFull = lastTap < 0 ? firstFull : std::max<int64_t>(firstFull, std::min<int64_t>(out.w, lastTap / Stride + 1));
+
+    for (int64_t n = 0; n < out.n; ++n) {
+        for (int64_t oc = 0; oc < out.c; ++oc) {
+            const int64_t group = oc / outPerGroup;
+            const float* filter = weights + oc * inPerGroup * K * K;
+            float* dst = output.Data() + ((n * out.c + oc) * out.h) * out.w;
+            std::fill(dst, dst + out.h * out.w, bias[oc]);
+
+            // Each output value still adds its taps in Conv2D's order (input
+            // channel, then row, then column), one kernel row per pass
+            for (int64_t ic = 0; ic < inPerGroup; ++ic) {
+                const float* src = input.Data() + ((n * in.c + group * inPerGroup + ic) * in.h) * in.w;
+                for (int64_t oy = 0; oy < out.h; ++oy) {
+                    float* dstRow = dst + oy * out.w;
+                    for (int64_t ky = 0; ky < K; ++ky) {
+                        const int64_t iy = oy * Stride + ky - Padding;
+                        if (iy < 0 || iy >= in.h) continue;
+                        const float* srcRow = src + iy * in.w;
+                        const float* w = filter + (ic * K + ky) * K;
+                        auto edge = [&](int64_t ox) {
+                            float acc = dstRow[ox];
+                            for (int64_t kx = 0; kx < K; ++kx) {
+                                const int64_t ix = ox * Stride + kx - Padding;
+                                if (ix >= 0 && ix < in.w) acc += w[kx] * srcRow[ix];
+                            }
+                            dstRow[ox] = acc;
+                        };
+                        for (int64_t ox = 0; ox < firstFull; ++ox) edge(ox);
+                        for (int64_t ox = firstFull; ox < lastFull; ++ox) {
+                            const float* taps = srcRow + ox * Stride - Padding;
+                            float acc = dstRow[ox];
+                            for (int64_t kx = 0; kx < K; ++kx) acc += w[kx] * taps[kx];
+                            dstRow[ox] = acc;
+                        }
+                        for (int64_t ox = lastFull; ox < out.w; ++ox) edge(ox);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template void Conv2DFixed<3, 1, 1>(const Tensor&, const float*, const float*, const ConvParams&, Tensor&);
+template void Conv2DFixed<1, 1, 0>(const Tensor&, const float*, const float*, const ConvParams&, Tensor&);
+
+namespace {
+// Winograd F(MxM, 3x3) transforms, from Lavin & Gray: U = G g G^T for a 3x3
+// filter g, V = B^T d B for an (M+2)^2 input tile d, and Y = A^T (U . V) A
+template <int M>
+struct Winograd;
+
+template <>
+struct Winograd<2> {
+    static constexpr float G[4][3] = {{1, 0, 0}, {0.5f, 0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0, 0, 1}};
+    static constexpr float BT[4][4] = {{1, 0, -1, 0}, {0, 1, 1, 0}, {0, -1, 1, 0}, {0, 1, 0, -1}};
+    static constexpr float AT[2][4] = {{1, 1, 1, 0}, {0, 1, -1, -1}};
+};
+
+template <>
+struct Winograd<4> {
+    static constexpr float G[6][3] = {{1.0f / 4, 0, 0},
+                                      {-1.0f / 6, -1.0f / 6, -1.0f / 6},
+                                      {-1.0f / 6, 1.0f / 6, -1.0f / 6},
+                                      {1.0f / 24, 1.0f / 12, 1.0f / 6},
+                                      {1.0f / 24, -1.0f / 12, 1.0f / 6},
+                                      {0, 0, 1}};
+    static constexpr float BT[6][6] = {{4, 0, -5, 0, 1, 0},  {0, -4, -4, 1, 1, 0}, {0, 4, -4, -1, 1, 0},
+                                       {0, -2, -1, 2, 1, 0}, {0, 2, -1, -2, 1, 0}, {0, 4, 0, -5, 0, 1}};
+    static constexpr float AT[4][6] = {{1, 1, 1, 1, 1, 0}, {0, 1, -1, 2, -2, 0}, {0, 1, 1, 4, 4, 0}, {0, 1, -1, 8, -8, 1}};
+};
+
+// y = L x L^T for count tiles at once: x is KxK and y is RxR, each element a
+// row of count values, so the inner loops run along contiguous tiles
+template <int R, int K>
+void Sandwich(const float (&left)[R][K], const float* x, float* scratch, float* y, int64_t count, int64_t stride) {
+    for (int i = 0; i < R; ++i) {
+        for (int j = 0; j < K; ++j) {
+            float* dst = scratch + (i * K + j) * count;
+            std::fill(dst, dst + count, 0.0f);
+            for (int k = 0; k < K; ++k) {
+                const float l = left[i][k];
+                if (l == 0.0f) continue;
+                const float* src = x + (k * K + j) * stride;
+                for (int64_t t = 0; t < count; ++t) dst[t] += l * src[t];
+            }
+        }
+    }
+    for (int i = 0; i < R; ++i) {
+        for (int j = 0; j < R; ++j) {
+            float* dst = y + (i * R + j) * count;
+            std::fill(dst, dst + count, 0.0f);
+            for (int k = 0; k < K; ++k) {
+                const float l = left[j][k];
+                if (l == 0.0f) continue;
+                const float* src = scratch + (i * K + k) * count;
+                for (int64_t t = 0; t < count; ++t) dst[t] += l * src[t];
+            }
+        }
+    }
+}
+
+// Floats of transformed input and products kept per tile block; half of a
+// typical 1 MB L2
+constexpr int64_t kWinogradBlockFloats = 1 << 17;
+} // namespace
+
+template <int M>
+void WinogradWeights(const float* weights, int64_t outChannels, int64_t inPerGroup, std::vector<float>& transformed) {
+    constexpr int A = M + 2;
+    transformed.assign(static_cast<size_t>(A * A * outChannels * inPerGroup), 0.0f);
+    float scratch[A * 3], u[A * A];
+    for (int64_t oc = 0; oc < outChannels; ++oc) {
+        for (int64_t ic = 0; ic < inPerGroup; ++ic) {
+            Sandwich(Winograd<M>::G, weights + (oc * inPerGroup + ic) * 9, scratch, u, 1, 1);
+            // [position][output channel][input channel]: one matrix per position
+            for (int p = 0; p < A * A; ++p) transformed[(p * outChannels + oc) * inPerGroup + ic] = u[p];
+        }
+    }
+}
+
+template <int M>
+void Conv2DWinograd(const Tensor& input, const float* transformed, const float* bias, const ConvParams& params, Tensor& output) {
+    constexpr int A = M + 2;
+    const TensorShape& in = input.shape;
+    const TensorShape& out = output.shape;
+    const int64_t inPerGroup = in.c / params.groups;
+    const int64_t outPerGroup = out.c / params.groups;
+    const int64_t tilesX = (out.w + M - 1) / M;
+    const int64_t tiles = ((out.h + M - 1) / M) * tilesX;
+    // Tiles per block, so its transformed inputs and products stay in L2
+    const int64_t block = std::clamp<int64_t>(kWinogradBlockFloats / (A * A * (inPerGroup + outPerGroup)) / 8 * 8, 8, 256);
+
+    thread_local std::vector<float> buffer;
+    const int64_t transformedInputs = A * A * inPerGroup * block;
+    const int64_t products = A * A * outPerGroup * block;
+    buffer.resize(static_cast<size_t>(transformedInputs + products + 3 * A * A * block));
+    float* v = buffer.data();                 // [position][input channel][tile]
+    float* m = v + transformedInputs;         // [position][output channel][tile]
+    float* tile = m + products;               // One channel's tiles, [element][tile]
+    float* scratch = tile + A * A * block;
+    float* y = scratch + A * A * block;
+
+    for (int64_t n = 0; n < out.n; ++n) {
+        for (int64_t group = 0; group < params.groups; ++group) {
+            for (int64_t first = 0; first < tiles; first += block) {
+                const int64_t count = std::min(block, tiles - first);
+
+                // Input tiles, zero outside the input, then V = B^T d B
+                for (int64_t ic = 0; ic < inPerGroup; ++ic) {
+                    const float* src = input.Data() + ((n * in.c + group * inPerGroup + ic) * in.h) * in.w;
+                    for (int64_t t = 0; t < count; ++t) {
+                        const int64_t y0 = (first + t) / tilesX * M - params.padding;
+                        const int64_t x0 = (first + t) % tilesX * M - params.padding;
+                        for (int i = 0; i < A; ++i) {
+                            const int64_t iy = y0 + i;
+                            const bool rowInside = iy >= 0 && iy < in.h;
+                            for (int j = 0; j < A; ++j) {
+                                const int64_t ix = x0 + j;
+                                tile[(i * A + j) * count + t] = rowInside && ix >= 0 && ix < in.w ? src[iy * in.w + ix] : 0.0f;
+                            }
+                        }
+                    }
+                    Sandwich(Winograd<M>::BT, tile, scratch, tile, count, count);
+                    for (int p = 0; p < A * A; ++p) {
+                        std::copy(tile + p * count, tile + (p + 1) * count, v + (p * inPerGroup + ic) * count);
+                    }
+                }
+
+                // One (output channel x input channel) by (input channel x
+                // tile) product per position, four output channels at a time
+                for (int p = 0; p < A * A; ++p) {
+                    const float* vp = v + p * inPerGroup * count;
+                    for (int64_t oc = 0; oc < outPerGroup; oc += 4) {
+                        const int64_t rows = std::min<int64_t>(4, outPerGroup - oc);
+                        float* dst[4];
+                        const float* u[4];
+                        for (int64_t r = 0; r < 4; ++r) {
+                            const int64_t channel = oc + std::min(r, rows - 1);
+                            dst[r] = m + (p * outPerGroup + channel) * count;
+                            u[r] = transformed + (p * out.c + group * outPerGroup + channel) * inPerGroup;
+                        }
+                        for (int64_t r = 0; r < rows; ++r) std::fill(dst[r], dst[r] + count, 0.0f);
+                        if (rows == 4) {
+                            for (int64_t ic = 0; ic < inPerGroup; ++ic) {
+                                const float* row = vp + ic * count;
+                                const float u0 = u[0][ic], u1 = u[1][ic], u2 = u[2][ic], u3 = u[3][ic];
+                                for (int64_t t = 0; t < count; ++t) {
+                                    dst[0][t] += u0 * row[t];
+                                    dst[1][t] += u1 * row[t];
+                                    dst[2][t] += u2 * row[t];
+                                    dst[3][t] += u3 * row[t];
+                                }
+                            }
+                        } else {
+                            for (int64_t r = 0; r < rows; ++r) {
+                                for (int64_t ic = 0; ic < inPerGroup; ++ic) {
+                                    const float* row = vp + ic * count;
+                                    const float weight = u[r][ic];
+                                    for (int64_t t = 0; t < count; ++t) dst[r][t] += weight * row[t];
+                                }
+                            }
+                        }
+                    }
+                }
+
+                // Y = A^T m A, cropped to the output
+                for (int64_t oc = 0; oc < outPerGroup; ++oc) {
+                    const int64_t channel = group * outPerGroup + oc;
+                    Sandwich(Winograd<M>::AT, m + oc * count, scratch, y, count, outPerGroup * count);
+                    float* dst = output.Data() + (n * out.c + channel) * out.h * out.w;
+                    for (int64_t t = 0; t < count; ++t) {
+                        const int64_t y0 = (first + t) / tilesX * M;
+                        const int64_t x0 = (first + t) % tilesX * M;
+                        for (int i = 0; i < M && y0 + i < out.h; ++i) {
+                            for (int j = 0; j < M && x0 + j < out.w; ++j) {
+                                dst[(y0 + i) * out.w + x0 + j] = y[(i * M + j) * count + t] + bias[channel];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+template void WinogradWeights<2>(const float*, int64_t, int64_t, std::vector<float>&);
+template void WinogradWeights<4>(const float*, int64_t, int64_t, std::vector<float>&);
+template void Conv2DWinograd<2>(const Tensor&, const float*, const float*, const ConvParams&, Tensor&);
+template void Conv2DWinograd<4>(const Tensor&, const float*, const float*, const ConvParams&, Tensor&);
+
+namespace {
+constexpr int64_t kChannelBlock = 8;   // Output channels per vector of the blocked layout
+
+// GroupedConv2D's view of one convolution, with the input zero padded
+struct BlockedConv {
+    BlockedConv(const TensorShape& in, const TensorShape& out, const ConvParams& params)
+        : in(in), out(out), inPerGroup(in.c / params.groups), outPerGroup(out.c / params.groups), k(params.kernel),
+          stride(params.stride), padding(params.padding),
+          paddedH(std::max(in.h + 2 * padding, (out.h - 1) * stride + k)),
+          paddedW(std::max(in.w + 2 * padding, (out.w - 1) * stride + k)) {}
+
+    int64_t PackedSize() const { return inPerGroup * paddedH * paddedW * kChannelBlock; }
+    int64_t TapsSize() const { return inPerGroup * k * k * kChannelBlock; }
+
+    TensorShape in, out;
+    int64_t inPerGroup, outPerGroup, k, stride, padding, paddedH, paddedW;
+};
+
+// For output channels [oc, oc + 8) of batch item n: each lane's own input
+// channels as [input channel][row][column][lane], and its weights as
+// [input channel][tap][lane]. Lanes past the last channel repeat it.
+void PackBlock(const BlockedConv& conv, const Tensor& input, const float* weights, int64_t n, int64_t oc, float* packed,
+               float* taps) {
+    const int64_t lanes = std::min(kChannelBlock, conv.out.c - oc);
+    const int64_t taps2 = conv.k * conv.k;
+    const float* src[kChannelBlock];
+    for (int64_t ic = 0; ic < conv.inPerGroup; ++ic) {
+        for (int64_t lane = 0; lane < kChannelBlock; ++lane) {
+            const int64_t channel = oc + std::min(lane, lanes - 1);
+            src[lane] = input.Data() + ((n * conv.in.c + channel / conv.outPerGroup * conv.inPerGroup + ic) * conv.in.h) * conv.in.w;
+            for (int64_t tap = 0; tap < taps2; ++tap) {
+                taps[(ic * taps2 + tap) * kChannelBlock + lane] = weights[(channel * conv.inPerGroup + ic) * taps2 + tap];
+            }
+        }
+        float* dst = packed + ic * conv.paddedH * conv.paddedW * kChannelBlock;
+        for (int64_t y = 0; y < conv.paddedH; ++y) {
+            float* dstRow = dst + y * conv.paddedW * kChannelBlock;
+            const int64_t iy = y - conv.padding;
+            if (iy < 0 || iy >= conv.in.h) {
+                std::fill(dstRow, dstRow + conv.paddedW * kChannelBlock, 0.0f);
+                continue;
+            }
+            std::fill(dstRow, dstRow + conv.padding * kChannelBlock, 0.0f);
+            for (int64_t x = 0; x < conv.in.w; ++x) {
+                float* value = dstRow + (conv.padding + x) * kChannelBlock;
+                for (int64_t lane = 0; lane < kChannelBlock; ++lane) value[lane] = src[lane][iy * conv.in.w + x];
+            }
+            std::fill(dstRow + (conv.padding + conv.in.w) * kChannelBlock, dstRow + conv.paddedW * kChannelBlock, 0.0f);
+        }
+    }
+}
+
+// Output rows [firstRow, lastRow) of a packed block; row firstRow of lane's
+// channel goes to dst[lane]. Each output sums its taps in Conv2D's order
+// (input channel, row, column) in one vector of lanes.
+void BlockRows(const BlockedConv& conv, const float* packed, const float* taps, const float* bias, int64_t oc,
+               int64_t firstRow, int64_t lastRow, float* const* dst) {
+    const int64_t lanes = std::min(kChannelBlock, conv.out.c - oc);
+    const int64_t plane = conv.paddedH * conv.paddedW;
+    float first[kChannelBlock];
+    for (int64_t lane = 0; lane < kChannelBlock; ++lane) first[lane] = bias[oc + std::min(lane, lanes - 1)];
+    for (int64_t oy = firstRow; oy < lastRow; ++oy) {
+        const int64_t rowOffset = (oy - firstRow) * conv.out.w;
+        for (int64_t ox = 0; ox < conv.out.w; ++ox) {
+            float acc[kChannelBlock];
+            std::copy(first, first + kChannelBlock, acc);
+            const float* w = taps;
+            for (int64_t ic = 0; ic < conv.inPerGroup; ++ic) {
+                const float* window = packed + (ic * plane + oy * conv.stride * conv.paddedW + ox * conv.stride) * kChannelBlock;
+                for (int64_t ky = 0; ky < conv.k; ++ky) {
+                    const float* value = window + ky * conv.paddedW * kChannelBlock;
+                    for (int64_t kx = 0; kx < conv.k; ++kx, w += kChannelBlock, value += kChannelBlock) {
+                        for (int64_t lane = 0; lane < kChannelBlock; ++lane) acc[lane] += w[lane] * value[lane];
+                    }
+                }
+            }
+            // Repeated lanes store their channel's value again, last lane first
+            for (int64_t lane = kChannelBlock; lane-- > 0;) dst[lane][rowOffset + ox] = acc[lane];
+        }
+    }
+}
+
+// Floats of depthwise output DepthwisePointwise keeps per band of rows, so
+// the band and the output rows it feeds stay in L2
+constexpr int64_t kFusedBandFloats = 1 << 15;
+} // namespace
+
+void GroupedConv2D(const Tensor& input, const float* weights, const float* bias, const ConvParams& params, Tensor& output) {
+    const BlockedConv conv(input.shape, output.shape, params);
+    const TensorShape& out = output.shape;
+    thread_local std::vector<float> buffer;
+    buffer.resize(static_cast<size_t>(conv.PackedSize() + conv.TapsSize()));
+    float* packed = buffer.data();
+    float* taps = packed + conv.PackedSize();
+
+    for (int64_t n = 0; n < out.n; ++n) {
+        for (int64_t oc = 0; oc < out.c; oc += kChannelBlock) {
+            PackBlock(conv, input, weights, n, oc, packed, taps);
+            float* dst[kChannelBlock];
+            for (int64_t lane = 0; lane < kChannelBlock; ++lane) {
+                dst[lane] = output.Data() + (n * out.c + oc + std::min(lane, out.c - oc - 1)) * out.h * out.w;
+            }
+            BlockRows(conv, packed, taps, bias, oc, 0, out.h, dst);
+        }
+    }
+}
+
+void DepthwisePointwise(const Tensor& input, const float* dwWeights, const float* dwBias, const ConvParams& dwParams,
+                        int64_t dwChannels, const float* pwWeights, const float* pwBias, Tensor& output) {
+    const TensorShape& out = output.shape;
+    const BlockedConv conv(input.shape, {out.n, dwChannels, out.h, out.w}, dwParams);
+    const int64_t blocks = (dwChannels + kChannelBlock - 1) / kChannelBlock;
+    const int64_t bandRows = std::clamp<int64_t>(kFusedBandFloats / (dwChannels * out.w), 1, out.h);
+    const int64_t plane = out.h * out.w;
+    thread_local std::vector<float> buffer;
+    buffer.resize(static_cast<size_t>(blocks * (conv.PackedSize() + conv.TapsSize()) + dwChannels * bandRows * out.w));
+    float* packed = buffer.data();
+    float* taps = packed + blocks * conv.PackedSize();
+    float* band = taps + blocks * conv.TapsSize();   // [channel][row][column]
+
+    for (int64_t n = 0; n < out.n; ++n) {
+        for (int64_t block = 0; block < blocks; ++block) {
+            PackBlock(conv, input, dwWeights, n, block * kChannelBlock, packed + block * conv.PackedSize(),
+                      taps + block * conv.TapsSize());
+        }
+        for (int64_t firstRow = 0; firstRow < out.h; firstRow += bandRows) {
+            const int64_t rows = std::min(bandRows, out.h - firstRow);
+            const int64_t pixels = rows * out.w;
+            for (int64_t block = 0; block < blocks; ++block) {
+                const int64_t oc = block * kChannelBlock;
+                float* dst[kChannelBlock];
+                for (int64_t lane = 0; lane < kChannelBlock; ++lane) {
+                    dst[lane] = band + (oc + std::min(lane, dwChannels - oc - 1)) * pixels;
+                }
+                BlockRows(conv, packed + block * conv.PackedSize(), taps + block * conv.TapsSize(), dwBias, oc, firstRow,
+                          firstRow + rows, dst);
+            }
+
+            // The pointwise sums, as Conv2D orders them: bias, then input channels
+            for (int64_t oc = 0; oc < out.c; oc += 4) {
+                const int64_t count = std::min<int64_t>(4, out.c - oc);
+                float* dst[4];
+                const float* filter[4];
+                for (int64_t i = 0; i < 4; ++i) {
+                    const int64_t channel = oc + std::min(i, count - 1);
+                    dst[i] = output.Data() + (n * out.c + channel) * plane + firstRow * out.w;
+                    filter[i] = pwWeights + channel * dwChannels;
+                    std::fill(dst[i], dst[i] + pixels, pwBias[channel]);
+                }
+                for (int64_t c = 0; c < dwChannels; ++c) {
+                    const float* src = band + c * pixels;
+                    if (count == 4) {
+                        const float w0 = filter[0][c], w1 = filter[1][c], w2 = filter[2][c], w3 = filter[3][c];
+                        for (int64_t i = 0; i < pixels; ++i) {
+                            dst[0][i] += w0 * src[i];
+                            dst[1][i] += w1 * src[i];
+                            dst[2][i] += w2 * src[i];
+                            dst[3][i] += w3 * src[i];
+                        }
+                    } else {
+                        for (int64_t r = 0; r < count; ++r) {
+                            const float w = filter[r][c];
+                            for (int64_t i = 0; i < pixels; ++i) dst[r][i] += w * src[i];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+namespace {
+template <bool kMax>
+void Pool(const Tensor& input, int64_t kernel, int64_t stride, Tensor& output) {
+    const TensorShape& in = input.shape;
+    const TensorShape& out = output.shape;
+    for (int64_t plane = 0; plane < out.n * out.c; ++plane) {
+        const float* src = input.Data() + plane * in.h * in.w;
+        float* dst = output.Data() + plane * out.h * out.w;
+        for (int64_t oy = 0; oy < out.h; ++oy) {
+            for (int64_t ox = 0; ox < out.w; ++ox) {
+                float acc = kMax ? -std::numeric_limits<float>::infinity() : 0.0f;
+                int64_t taps = 0;
+                for (int64_t ky = 0; ky < kernel; ++ky) {
+                    const int64_t iy = oy * stride + ky;
+                    if (iy >= in.h) break;
+                    for (int64_t kx = 0; kx < kernel; ++kx) {
+                        const int64_t ix = ox * stride + kx;
+                        if (ix >= in.w) break;
+                        const float value = src[iy * in.w + ix];
+                        acc = kMax ? std::max(acc, value) : acc + value;
+                        ++taps;
+                    }
+                }
+                dst[oy * out.w + ox] = kMax ? acc : (taps ? acc / static_cast<float>(taps) : 0.0f);
+            }
+        }
+    }
+}
+} // namespace
+
+void MaxPool(const Tensor& input, int64_t kernel, int64_t stride, Tensor& output) {
+    Pool<true>(input, kernel, stride, output);
+}
+
+void AvgPool(const Tensor& input, int64_t kernel, int64_t stride, Tensor& output) {
+    Pool<false>(input, kernel, stride, output);
+}
+
+void Dense(const Tensor& input, const float* weights, const float* bias, Tensor& output) {
+    const int64_t features = input.shape.c * input.shape.h * input.shape.w;
+    const int64_t units = output.shape.c;
+    for (int64_t n = 0; n < input.shape.n; ++n) {
+        const float* x = input.Data() + n * features;
+        float* y = output.Data() + n * units;
+        for (int64_t u = 0; u < units; ++u) {
+            const float* row = weights + u * features;
+            float acc = bias[u];
+            for (int64_t f = 0; f < features; ++f) acc += row[f] * x[f];
+            y[u] = acc;
+        }
+    }
+}
+
+void DenseRows4(const Tensor& input, const float* weights, const float* bias, Tensor& output) {
+    const int64_t features = input.shape.c * input.shape.h * input.shape.w;
+    const int64_t units = output.shape.c;
+    for (int64_t n = 0; n < input.shape.n; ++n) {
+        const float* x = input.Data() + n * features;
+        float* y = output.Data() + n * units;
+        int64_t u = 0;
+        for (; u + 4 <= units; u += 4) {
+            const float* row0 = weights + u * features;
+            const float* row1 = row0 + features;
+            const float* row2 = row1 + features;
+            const float* row3 = row2 + features;
+            float acc0 = bias[u], acc1 = bias[u + 1], acc2 = bias[u + 2], acc3 = bias[u + 3];
+            for (int64_t f = 0; f < features; ++f) {
+                acc0 += row0[f] * x[f];
+                acc1 += row1[f] * x[f];
+                acc2 += row2[f] * x[f];
+                acc3 += row3[f] * x[f];
+            }
+            y[u] = acc0;
+            y[u + 1] = acc1;
+            y[u + 2] = acc2;
+            y[u + 3] = acc3;
+        }
+        for (; u < units; ++u) {
+            const float* row = weights + u * features;
+            float acc = bias[u];
+            for (int64_t f = 0; f < features; ++f) acc += row[f] * x[f];
+            y[u] = acc;
+        }
+    }
+}
+
+namespace {
+// Symmetric step covering [-maxAbs, maxAbs] with 127 levels a side
+float StepFor(float maxAbs) {
+    return maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+}
+
+int8_t QuantizeValue(float value, float inverseStep) {
+    return static_cast<int8_t>(std::lrint(std::clamp(value * inverseStep, -127.0f, 127.0f)));
+}
+
+// Quantizes count values with step (0: from their own range); returns the step used
+float QuantizeInput(const float* src, int64_t count, float step, int8_t* dst) {
+    if (step <= 0.0f) {
+        float maxAbs = 0.0f;
+        for (int64_t i = 0; i < count; ++i) maxAbs = std::max(maxAbs, std::fabs(src[i]));
+        step = StepFor(maxAbs);
+    }
+    const float inverse = 1.0f / step;
+    for (int64_t i = 0; i < count; ++i) dst[i] = QuantizeValue(src[i], inverse);
+    return step;
+}
+
+// Widening int8 dot products, written so compilers emit multiply-add pairs
+// (pmaddwd, or vpdpbusd-class instructions where enabled)
+int32_t Dot(const int8_t* a, const int8_t* b, int64_t count) {
+    int32_t sum = 0;
+    for (int64_t i = 0; i < count; ++i) sum += static_cast<int16_t>(a[i]) * static_cast<int16_t>(b[i]);
+    return sum;
+}
+
+// Four rows against one vector, sharing the loads of the vector
+void Dot4(const int8_t* const* rows, const int8_t* b, int64_t count, int32_t* sums) {
+    int32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int64_t i = 0; i < count; ++i) {
+        const int16_t value = b[i];
+        s0 += static_cast<int16_t>(rows[0][i]) * value;
+        s1 += static_cast<int16_t>(rows[1][i]) * value;
+        s2 += static_cast<int16_t>(rows[2][i]) * value;
+        s3 += static_cast<int16_t>(rows[3][i]) * value;
+    }
+    sums[0] = s0;
+    sums[1] = s1;
+    sums[2] = s2;
+    sums[3] = s3;
+}
+
+// rows x count weights against vector b: out[r] = bias[r] + dot * step * scales[r]
+void QuantizedRows(const int8_t* weights, const float* scales, const float* bias, int64_t first, int64_t last,
+                   int64_t count, const int8_t* b, float step, float* out, int64_t outStride) {
+    int64_t r = first;
+    for (; r + 4 <= last; r += 4) {
+        const int8_t* rows[4] = {weights + r * count, weights + (r + 1) * count, weights + (r + 2) * count,
+                                 weights + (r + 3) * count};
+        int32_t sums[4];
+        Dot4(rows, b, count, sums);
+        for (int64_t i = 0; i < 4; ++i) out[(r + i) * outStride] = bias[r + i] + static_cast<float>(sums[i]) * step * scales[r + i];
+    }
+    for (; r < last; ++r) {
+        out[r * outStride] = bias[r] + static_cast<float>(Dot(weights + r * count, b, count)) * step * scales[r];
+    }
+}
+} // namespace
+
+void QuantizeRows(const std::vector<float>& weights, int64_t rows, std::vector<int8_t>& quantized, std::vector<float>& scales) {
+    const size_t columns = rows > 0 ? weights.size() / static_cast<size_t>(rows) : 0;
+    quantized.resize(weights.size());
+    scales.resize(static_cast<size_t>(rows));
+    for (size_t r = 0; r < scales.size(); ++r) {
+        const float* row = weights.data() + r * columns;
+        float maxAbs = 0.0f;
+        for (size_t i = 0; i < columns; ++i) maxAbs = std::max(maxAbs, std::fabs(row[i]));
+        scales[r] = StepFor(maxAbs);
+        const float inverse = 1.0f / scales[r];
+        for (size_t i = 0; i < columns; ++i) quantized[r * columns + i] = QuantizeValue(row[i], inverse);
+    }
+}
+
+void Conv2DInt8(const Tensor& input, const int8_t* weights, const float* scales, const float* bias, float inputScale,
+                const ConvParams& params, Tensor& output) {
+    const TensorShape& in = input.shape;
+    const TensorShape& out = output.shape;
+    const int64_t inPerGroup = in.c / params.groups;
+    const int64_t outPerGroup = out.c / params.groups;
+    const int64_t k = params.kernel;
+    const int64_t taps = inPerGroup * k * k;   // One weight row per output channel
+    const int64_t plane = out.h * out.w;
+    const int64_t item = in.c * in.h * in.w;
+    thread_local std::vector<int8_t> quantized;
+    thread_local std::vector<int8_t> patches;
+    quantized.resize(static_cast<size_t>(item));
+    patches.resize(static_cast<size_t>(plane * taps));
+
+    for (int64_t n = 0; n < out.n; ++n) {
+        // Each batch item is quantized on its own, so items stay independent
+        const float step = QuantizeInput(input.Data() + n * item, item, inputScale, quantized.data());
+        for (int64_t group = 0; group < params.groups; ++group) {
+            // The taps of each output pixel, contiguous and in weight order;
+            // padding reads zero, which is exact in int8
+            for (int64_t oy = 0; oy < out.h; ++oy) {
+                for (int64_t ox = 0; ox < out.w; ++ox) {
+                    int8_t* patch = patches.data() + (oy * out.w + ox) * taps;
+                    const int64_t x0 = ox * params.stride - params.padding;
+                    const bool inside = x0 >= 0 && x0 + k <= in.w;
+                    for (int64_t ic = 0; ic < inPerGroup; ++ic) {
+                        const int8_t* src = quantized.data() + (group * inPerGroup + ic) * in.h * in.w;
+                        for (int64_t ky = 0; ky < k; ++ky, patch += k) {
+                            const int64_t iy = oy * params.stride + ky - params.padding;
+                            if (iy < 0 || iy >= in.h) {
+                                std::fill(patch, patch + k, int8_t(0));
+                            } else if (inside) {
+                                std::copy(src + iy * in.w + x0, src + iy * in.w + x0 + k, patch);
+                            } else {
+                                for (int64_t kx = 0; kx < k; ++kx) {
+                                    patch[kx] = x0 + kx >= 0 && x0 + kx < in.w ? src[iy * in.w + x0 + kx] : 0;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            float* dst = output.Data() + n * out.c * plane;
+            for (int64_t pixel = 0; pixel < plane; ++pixel) {
+                QuantizedRows(weights, scales, bias, group * outPerGroup, (group + 1) * outPerGroup, taps,
+                              patches.data() + pixel * taps, step, dst + pixel, plane);
+            }
+        }
+    }
+}
+
+void DenseInt8(const Tensor& input, const int8_t* weights, const float* scales, const float* bias, float inputScale,
+               Tensor& output) {
+    const int64_t features = input.shape.c * input.shape.h * input.shape.w;
+    const int64_t units = output.shape.c;
+    thread_local std::vector<int8_t> quantized;
+    quantized.resize(static_cast<size_t>(features));
+    for (int64_t n = 0; n < input.shape.n; ++n) {
+        const float step = QuantizeInput(input.Data() + n * features, features, inputScale, quantized.data());
+        QuantizedRows(weights, scales, bias, 0, units, features, quantized.data(), step, output.Data() + n * units, 1);
+    }
+}
+
+void Widen(const uint16_t* src, Precision precision, size_t count, float* dst) {
+    size_t i = 0;
+    if (precision == Precision::BF16) {
+        for (; i < count; ++i) dst[i] = Bf16ToFloat(src[i]);
+        return;
+    }
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    }
+#endif
+    for (; i < count; ++i) dst[i] = HalfToFloat(src[i]);
+}
+
+void Narrow(const float* src, size_t count, Precision precision, uint16_t* dst) {
+    size_t i = 0;
+    if (precision == Precision::BF16) {
+#if defined(__AVX512BF16__)
+        for (; i + 16 <= count; i += 16) {
+            const __m256bh packed = _mm512_cvtneps_pbh(_mm512_loadu_ps(src + i));
+            std::memcpy(dst + i, &packed, sizeof(packed));
+        }
+#endif
+        for (; i < count; ++i) dst[i] = FloatToBf16(src[i]);
+        return;
+    }
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+    for (; i < count; ++i) dst[i] = FloatToHalf(src[i]);
+}
+
+void DenseHalf(const Tensor& input, const uint16_t* weights, Precision precision, const float* bias, Tensor& output) {
+    const int64_t features = input.shape.c * input.shape.h * input.shape.w;
+    const int64_t units = output.shape.c;
+    constexpr int64_t kLanes = 8;
+    thread_local std::vector<float> row;
+    row.resize(static_cast<size_t>(features));
+    // Units outermost, so each weight row is read and widened once per call.
+    // Rounding already differs from FP32 weights, so the sum may be split
+    // into independent lanes the compiler can vectorize.
+    for (int64_t u = 0; u < units; ++u) {
+        Widen(weights + u * features, precision, static_cast<size_t>(features), row.data());
+        for (int64_t n = 0; n < input.shape.n; ++n) {
+            const float* x = input.Data() + n * features;
+            float lanes[kLanes] = {};
+            int64_t f = 0;
+            for (; f + kLanes <= features; f += kLanes) {
+                for (int64_t l = 0; l < kLanes; ++l) lanes[l] += row[f + l] * x[f + l];
+            }
+            float acc = bias[u];
+            for (; f < features; ++f) acc += row[f] * x[f];
+            for (int64_t l = 0; l < kLanes; ++l) acc += lanes[l];
+            output.Data()[n * units + u] = acc;
+        }
+    }
+}
+
+namespace {
+constexpr int64_t kQueryTile = 32;          // Queries sharing each key block
+constexpr int64_t kKeyBlockFloats = 4096;   // Keys and values of one block fill 32 KB of L1
+} // namespace
+
+int64_t AttentionTasks(const TensorShape& qkv, const AttentionParams& params) {
+    return qkv.n * params.heads * ((qkv.h + kQueryTile - 1) / kQueryTile);
+}
+
+void Attention(const Tensor& qkv, const Tensor* cache, const AttentionParams& params, Tensor& output, int64_t first,
+               int64_t last) {
+    const int64_t positions = qkv.shape.h;
+    const int64_t width = qkv.shape.w;
+    const int64_t headDim = width / params.heads;
+    const int64_t past = cache ? cache->shape.h : 0;
+    const int64_t tiles = (positions + kQueryTile - 1) / kQueryTile;
+    const int64_t keyBlock = std::clamp<int64_t>(kKeyBlockFloats / headDim, 8, 256);
+    const float scale = 1.0f / std::sqrt(static_cast<float>(headDim));
+
+    thread_local std::vector<float> buffer;
+    buffer.resize(static_cast<size_t>(2 * kQueryTile * headDim + 2 * keyBlock * headDim + kQueryTile * keyBlock + 2 * kQueryTile));
+    float* queries = buffer.data();                        // [query][dim], scaled
+    float* acc = queries + kQueryTile * headDim;           // [query][dim], unnormalized output
+    float* keysT = acc + kQueryTile * headDim;             // [dim][key]
+    float* values = keysT + keyBlock * headDim;            // [key][dim]
+    float* scores = values + keyBlock * headDim;           // [query][key]
+    float* runningMax = scores + kQueryTile * keyBlock;
+    float* runningSum = runningMax + kQueryTile;
+
+    for (int64_t task = first; task < last; ++task) {
+        const int64_t n = task / (params.heads * tiles);
+        const int64_t head = task / tiles % params.heads;
+        const int64_t firstQuery = task % tiles * kQueryTile;
+        const int64_t rows = std::min(kQueryTile, positions - firstQuery);
+        // Row p of a [n, c, positions, width] tensor, at this head's columns
+        auto row = [&](const Tensor& tensor, int64_t c, int64_t p) {
+            return tensor.Data() + ((n * tensor.shape.c + c) * tensor.shape.h + p) * width + head * headDim;
+        };
+        auto key = [&](int64_t k) { return k < past ? row(*cache, 0, k) : row(qkv, 1, k - past); };
+        auto value = [&](int64_t k) { return k < past ? row(*cache, 1, k) : row(qkv, 2, k - past); };
+
+        for (int64_t i = 0; i < rows; ++i) {
+            const float* q = row(qkv, 0, firstQuery + i);
+            for (int64_t d = 0; d < headDim; ++d) queries[i * headDim + d] = q[d] * scale;
+        }
+        std::fill(acc, acc + rows * headDim, 0.0f);
+        std::fill(runningMax, runningMax + rows, -std::numeric_limits<float>::infinity());
+        std::fill(runningSum, runningSum + rows, 0.0f);
+
+        // Queries sit after the cached positions; causally the tile's last
+        // query sees the most keys
+        const int64_t keyEnd = params.causal ? past + firstQuery + rows : past + positions;
+        for (int64_t firstKey = 0; firstKey < keyEnd; firstKey += keyBlock) {
+            const int64_t cols = std::min(keyBlock, keyEnd - firstKey);
+            for (int64_t j = 0; j < cols; ++j) {
+                const float* k = key(firstKey + j);
+                for (int64_t d = 0; d < headDim; ++d) keysT[d * keyBlock + j] = k[d];
+                std::copy(value(firstKey + j), value(firstKey + j) + headDim, values + j * headDim);
+            }
+
+            for (int64_t i = 0; i < rows; ++i) {
+                float* s = scores + i * keyBlock;
+                std::fill(s, s + cols, 0.0f);
+                for (int64_t d = 0; d < headDim; ++d) {
+                    const float q = queries[i * headDim + d];
+                    const float* k = keysT + d * keyBlock;
+                    for (int64_t j = 0; j < cols; ++j) s[j] += q * k[j];
+                }
+
+                // Online softmax: rescale what was summed under the old maximum
+                const int64_t visible = params.causal ? std::min(cols, past + firstQuery + i + 1 - firstKey) : cols;
+                if (visible <= 0) continue;
+                const float blockMax = *std::max_element(s, s + visible);
+                const float newMax = std::max(runningMax[i], blockMax);
+                const float rescale = std::exp(runningMax[i] - newMax);
+                float sum = 0.0f;
+                for (int64_t j = 0; j < visible; ++j) {
+                    s[j] = std::exp(s[j] - newMax);
+                    sum += s[j];
+                }
+                runningMax[i] = newMax;
+                runningSum[i] = runningSum[i] * rescale + sum;
+                float* o = acc + i * headDim;
+                for (int64_t d = 0; d < headDim; ++d) o[d] *= rescale;
+                for (int64_t j = 0; j < visible; ++j) {
+                    const float p = s[j];
+                    const float* v = values + j * headDim;
+                    for (int64_t d = 0; d < headDim; ++d) o[d] += p * v[d];
+                }
+            }
+        }
+
+        for (int64_t i = 0; i < rows; ++i) {
+            float* dst = output.Data() + (n * positions + firstQuery + i) * width + head * headDim;
+            const float inverse = 1.0f / runningSum[i];
+            for (int64_t d = 0; d < headDim; ++d) dst[d] = acc[i * headDim + d] * inverse;
+        }
+    }
+}
+
+void AddRelu(const Tensor* const* inputs, int count, Tensor& output) {
+    const int64_t elements = output.shape.Elements();
+    float* dst = output.Data();
+    std::copy(inputs[0]->Data(), inputs[0]->Data() + elements, dst);
+    for (int i = 1; i < count; ++i) {
+        const float* src = inputs[i]->Data();
+        for (int64_t e = 0; e < elements; ++e) dst[e] += src[e];
+    }
+    for (int64_t e = 0; e < elements; ++e) dst[e] = std::max(dst[e], 0.0f);
+}
+
+} // namespace kernels
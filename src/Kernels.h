@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Tensor.h"
+#include <cstdint>
+#include <vector>
+
+// Reference FP32 kernels (NCHW). Outputs must already have the right shape;
+// every kernel overwrites its whole output, which may be uninitialized.
+namespace kernels {
+
+struct ConvParams {
+    int64_t kernel = 3;
+    int64_t stride = 1;
+    int64_t padding = 1;
+    int64_t groups = 1;
+};
+
+// weights: [outC][inC / groups][kernel][kernel], bias: [outC]
+void Conv2D(const Tensor& input, const float* weights, const float* bias, const ConvParams& params, Tensor& output);
+// Same result via an im2col buffer (per thread) and a matrix multiply that
+// updates four output channels per pass over the columns
+void Conv2DIm2col(const Tensor& input, const float* weights, const float* bias, const ConvParams& params, Tensor& output);
+// Same result with kernel size, stride and padding fixed at compile time:
+// the taps unroll and row interiors need no bounds checks. params must match
+// the arguments. Instantiated for 3x3 stride 1 padding 1 and 1x1 stride 1
+// padding 0; add instantiations in Kernels.cpp for other hot shapes.
+template <int64_t K, int64_t Stride, int64_t Padding>
+void Conv2DFixed(const Tensor& input, const float* weights, const float* bias, const ConvParams& params, Tensor& output);
+
+// Winograd F(MxM, 3x3) for 3x3 stride 1 (any padding), M = 2 or 4: each
+// MxM output tile costs (M+2)^2 multiplies per channel pair instead of 9M^2.
+// weights come pre-transformed by WinogradWeights; tiles are processed in
+// blocks sized for L2. Rounding differs slightly from Conv2D, more so for M = 4.
+template <int M>
+void WinogradWeights(const float* weights, int64_t outChannels, int64_t inPerGroup, std::vector<float>& transformed);
+template <int M>
+void Conv2DWinograd(const Tensor& input, const float* transformed, const float* bias, const ConvParams& params, Tensor& output);
+
+// Grouped and depthwise convolution, any kernel, stride and padding, for
+// groups of few input channels: vectorized over blocks of 8 output channels,
+// each reading its own group from an interleaved, zero-padded copy of the
+// input. Sums in Conv2D's order, so results match it exactly.
+void GroupedConv2D(const Tensor& input, const float* weights, const float* bias, const ConvParams& params, Tensor& output);
+// Depthwise (or grouped) convolution producing dwChannels, then a 1x1
+// convolution over them, a band of rows at a time so the intermediate stays
+// in cache. Matches GroupedConv2D followed by Conv2D exactly.
+void DepthwisePointwise(const Tensor& input, const float* dwWeights, const float* dwBias, const ConvParams& dwParams,
+                        int64_t dwChannels, const float* pwWeights, const float* pwBias, Tensor& output);
+
+void MaxPool(const Tensor& input, int64_t kernel, int64_t stride, Tensor& output);
+void AvgPool(const Tensor& input, int64_t kernel, int64_t stride, Tensor& output);
+
+// Flattens each batch item; weights: [units][features], bias: [units]
+void Dense(const Tensor& input, const float* weights, const float* bias, Tensor& output);
+// Same result computing four units per pass over the input
+void DenseRows4(const Tensor& input, const float* weights, const float* bias, Tensor& output);
+
+// INT8: weights are quantized symmetrically per output row (real value =
+// q * scales[row]). The input is quantized on entry with inputScale (real
+// value per step; 0 takes it from the input's own range), products sum in
+// int32, and each output is bias + sum * inputScale * scales[row].
+void QuantizeRows(const std::vector<float>& weights, int64_t rows, std::vector<int8_t>& quantized, std::vector<float>& scales);
+void Conv2DInt8(const Tensor& input, const int8_t* weights, const float* scales, const float* bias, float inputScale,
+                const ConvParams& params, Tensor& output);
+void DenseInt8(const Tensor& input, const int8_t* weights, const float* scales, const float* bias, float inputScale,
+               Tensor& output);
+
+// FP16 / BF16 storage, converted with F16C and AVX512-BF16 where the build
+// enables them
+void Widen(const uint16_t* src, Precision precision, size_t count, float* dst);
+void Narrow(const float* src, size_t count, Precision precision, uint16_t* dst);
+// Dense with 16-bit weights, widened one row at a time and summed in FP32
+void DenseHalf(const Tensor& input, const uint16_t* weights, Precision precision, const float* bias, Tensor& output);
+
+struct AttentionParams {
+    int64_t heads = 8;
+    bool causal = true;     // Each position sees the keys up to its own
+};
+
+// Multi-head scaled dot-product attention, flash style: per batch item,
+// head and tile of queries, key blocks sized for L1 are scored and folded
+// into a running softmax, so no positions x keys matrix is materialized.
+// qkv is [n, 3, positions, heads * headDim] (queries, keys, values); output
+// is [n, 1, positions, heads * headDim]. cache, if not null, is
+// [n, 2, past, heads * headDim]: keys and values of earlier positions,
+// which come before qkv's (incremental decoding). Runs tasks [first, last)
+// of AttentionTasks, so callers can spread them over threads.
+int64_t AttentionTasks(const TensorShape& qkv, const AttentionParams& params);
+void Attention(const Tensor& qkv, const Tensor* cache, const AttentionParams& params, Tensor& output, int64_t first,
+               int64_t last);
+
+// output = max(0, sum of inputs); every input has the output's element count
+void AddRelu(const Tensor* const* inputs, int count, Tensor& output);
+
+} // namespace kernels
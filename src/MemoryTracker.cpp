@@ -0,0 +1,214 @@
+#include "MemoryTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <iomanip>
+
+namespace {
+
+struct alignas(64) TagCounters {
+    std::atomic<int64_t> currentBytes{0};
+    std::atomic<int64_t> peakBytes{0};
+    std::atomic<int64_t> allocatedBytes{0};
+    std::atomic<int64_t> allocations{0};
+    std::atomic<int64_t> frees{0};
+};
+
+// Constant-initialized so that allocations made during static initialization
+// are counted safely
+TagCounters g_counters[kMemTagCount];
+thread_local MemTag t_currentTag = MemTag::Other;
+
+std::mutex g_lastRunMutex;
+MemorySnapshot g_lastRun{};
+
+#ifdef AISHOW_TRACK_ALLOCATIONS
+// Every tracked block is prefixed with its size and tag so that frees can be
+// attributed to the subsystem that made the allocation. 16 bytes keeps the
+// default new alignment.
+struct alignas(16) BlockHeader {
+    uint64_t size;
+    MemTag tag;
+};
+static_assert(sizeof(BlockHeader) == 16, "BlockHeader must preserve 16-byte alignment");
+
+void CountAllocation(MemTag tag, size_t size) {
+    TagCounters& c = g_counters[static_cast<size_t>(tag)];
+    const int64_t bytes = static_cast<int64_t>(size);
+    const int64_t current = c.currentBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    c.allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t peak = c.peakBytes.load(std::memory_order_relaxed);
+    while (current > peak &&
+           !c.peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+    }
+}
+
+void CountFree(MemTag tag, size_t size) {
+    TagCounters& c = g_counters[static_cast<size_t>(tag)];
+    c.currentBytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+    c.frees.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+} // namespace
+
+const char* MemTagName(MemTag tag) {
+    switch (tag) {
+    case MemTag::Other:     return "Other";
+    case MemTag::Model:     return "AIModel";
+    case MemTag::Editor:    return "NodeEditor";
+    case MemTag::ImGui:     return "ImGui";
+    case MemTag::ImNodes:   return "ImNodes";
+    case MemTag::Sync:      return "SyncManager";
+    case MemTag::Execution: return "Execution";
+    default:                return "?";
+    }
+}
+
+bool MemoryTracker::Enabled() {
+#ifdef AISHOW_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void* MemoryTracker::Allocate(size_t size) {
+#ifdef AISHOW_TRACK_ALLOCATIONS
+    void* raw = std::malloc(sizeof(BlockHeader) + size);
+    if (!raw) return nullptr;
+    BlockHeader* header = static_cast<BlockHeader*>(raw);
+    header->size = size;
+    header->tag = t_currentTag;
+    CountAllocation(header->tag, size);
+    return header + 1;
+#else
+    return std::malloc(size);
+#endif
+}
+
+void MemoryTracker::Free(void* ptr) {
+    if (!ptr) return;
+#ifdef AISHOW_TRACK_ALLOCATIONS
+    BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+    CountFree(header->tag, header->size);
+    std::free(header);
+#else
+    std::free(ptr);
+#endif
+}
+
+void* MemoryTracker::ImGuiAlloc(size_t size, void*) {
+    // ImGui calls made inside the node editor are ImNodes' allocations
+    if (t_currentTag == MemTag::ImNodes) return Allocate(size);
+    MemTag previous = SwapTag(MemTag::ImGui);
+    void* ptr = Allocate(size);
+    SwapTag(previous);
+    return ptr;
+}
+
+void MemoryTracker::ImGuiFree(void* ptr, void*) {
+    Free(ptr);
+}
+
+MemTag MemoryTracker::CurrentTag() {
+    return t_currentTag;
+}
+
+MemTag MemoryTracker::SwapTag(MemTag tag) {
+    MemTag previous = t_currentTag;
+    t_currentTag = tag;
+    return previous;
+}
+
+MemTagStats MemoryTracker::Stats(MemTag tag) {
+    const TagCounters& c = g_counters[static_cast<size_t>(tag)];
+    MemTagStats stats;
+    stats.currentBytes = c.currentBytes.load(std::memory_order_relaxed);
+    stats.peakBytes = c.peakBytes.load(std::memory_order_relaxed);
+    stats.allocatedBytes = c.allocatedBytes.load(std::memory_order_relaxed);
+    stats.allocations = c.allocations.load(std::memory_order_relaxed);
+    stats.frees = c.frees.load(std::memory_order_relaxed);
+    return stats;
+}
+
+MemorySnapshot MemoryTracker::Snapshot() {
+    MemorySnapshot snapshot;
+    for (size_t i = 0; i < kMemTagCount; ++i) {
+        snapshot[i] = Stats(static_cast<MemTag>(i));
+    }
+    return snapshot;
+}
+
+MemorySnapshot MemoryTracker::Delta(const MemorySnapshot& before, const MemorySnapshot& after) {
+    MemorySnapshot delta;
+    for (size_t i = 0; i < kMemTagCount; ++i) {
+        delta[i].currentBytes = after[i].currentBytes;
+        delta[i].peakBytes = after[i].peakBytes;
+        delta[i].allocatedBytes = after[i].allocatedBytes - before[i].allocatedBytes;
+        delta[i].allocations = after[i].allocations - before[i].allocations;
+        delta[i].frees = after[i].frees - before[i].frees;
+    }
+    return delta;
+}
+
+void MemoryTracker::SetLastRun(const MemorySnapshot& delta) {
+    std::lock_guard<std::mutex> lock(g_lastRunMutex);
+    g_lastRun = delta;
+}
+
+MemorySnapshot MemoryTracker::LastRun() {
+    std::lock_guard<std::mutex> lock(g_lastRunMutex);
+    return g_lastRun;
+}
+
+std::string MemoryTracker::Report(const MemorySnapshot& snapshot) {
+    std::ostringstream out;
+    out << std::left << std::setw(12) << "subsystem" << std::right
+        << std::setw(12) << "live KB" << std::setw(12) << "peak KB"
+        << std::setw(14) << "alloc KB" << std::setw(10) << "allocs" << std::setw(10) << "frees" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < kMemTagCount; ++i) {
+        const MemTagStats& s = snapshot[i];
+        out << std::left << std::setw(12) << MemTagName(static_cast<MemTag>(i)) << std::right
+            << std::setw(12) << s.currentBytes / 1024.0 << std::setw(12) << s.peakBytes / 1024.0
+            << std::setw(14) << s.allocatedBytes / 1024.0
+            << std::setw(10) << s.allocations << std::setw(10) << s.frees << "\n";
+    }
+    return out.str();
+}
+
+#ifdef AISHOW_TRACK_ALLOCATIONS
+// Counting replacements for the global allocation functions. Over-aligned
+// variants are left to the standard library and are not counted.
+void* operator new(std::size_t size) {
+    void* ptr = MemoryTracker::Allocate(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    void* ptr = MemoryTracker::Allocate(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return MemoryTracker::Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return MemoryTracker::Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept { MemoryTracker::Free(ptr); }
+void operator delete[](void* ptr) noexcept { MemoryTracker::Free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { MemoryTracker::Free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { MemoryTracker::Free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { MemoryTracker::Free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { MemoryTracker::Free(ptr); }
+#endif
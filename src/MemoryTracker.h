@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Subsystems that allocations are attributed to. The tag is taken from the
+// innermost MemoryScope active on the allocating thread.
+enum class MemTag : uint8_t {
+    Other,
+    Model,      // AIModel graph storage and file parsing
+    Editor,     // NodeEditor UI state
+    ImGui,      // ImGui allocations outside of the node editor
+    ImNodes,    // ImNodes pools and editor context
+    Sync,       // SyncManager buffers and deltas
+    Execution,  // Scheduler and worker state while a run is in flight
+    Count
+};
+
+constexpr size_t kMemTagCount = static_cast<size_t>(MemTag::Count);
+
+const char* MemTagName(MemTag tag);
+
+struct MemTagStats {
+    int64_t currentBytes = 0;  // Live bytes still owned by the subsystem
+    int64_t peakBytes = 0;     // High-water mark of currentBytes
+    int64_t allocatedBytes = 0;// Cumulative bytes allocated
+    int64_t allocations = 0;   // Cumulative allocation count
+    int64_t frees = 0;         // Cumulative free count
+};
+
+using MemorySnapshot = std::array<MemTagStats, kMemTagCount>;
+
+// Process-wide allocation accounting. With AISHOW_TRACK_ALLOCATIONS defined the
+// global operator new/delete are replaced by counting versions; otherwise all
+// statistics stay at zero and scopes only cost a thread-local store.
+class MemoryTracker {
+public:
+    static bool Enabled();
+
+    // Counted allocation entry points, also used as the ImGui allocator
+    static void* Allocate(size_t size);
+    static void  Free(void* ptr);
+    static void* ImGuiAlloc(size_t size, void* userData);
+    static void  ImGuiFree(void* ptr, void* userData);
+
+    static MemTag CurrentTag();
+    static MemTagStats Stats(MemTag tag);
+    static MemorySnapshot Snapshot();
+    // Per-tag difference of cumulative counters (current/peak taken from 'after')
+    static MemorySnapshot Delta(const MemorySnapshot& before, const MemorySnapshot& after);
+
+    // Allocation activity of the most recent execution run
+    static void SetLastRun(const MemorySnapshot& delta);
+    static MemorySnapshot LastRun();
+
+    static std::string Report(const MemorySnapshot& snapshot);
+
+private:
+    friend class MemoryScope;
+    static MemTag SwapTag(MemTag tag);
+};
+
+// Attributes allocations made by this thread to 'tag' until destroyed
+class MemoryScope {
+public:
+    explicit MemoryScope(MemTag tag) : previous_(MemoryTracker::SwapTag(tag)) {}
+    ~MemoryScope() { MemoryTracker::SwapTag(previous_); }
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+    MemTag previous_;
+};
@@ -0,0 +1,288 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+using SocketHandle = SOCKET;
+#define AISHOW_CLOSE_SOCKET closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketHandle = int;
+#define AISHOW_CLOSE_SOCKET close
+#endif
+
+namespace metrics_detail {
+size_t ThreadShard() {
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+} // namespace metrics_detail
+
+namespace {
+
+std::string FormatLabels(const MetricLabels& labels, const std::string& extraKey = "", const std::string& extraValue = "") {
+    if (labels.empty() && extraKey.empty()) return "";
+    std::string out = "{";
+    bool first = true;
+    auto append = [&](const std::string& key, const std::string& value) {
+        if (!first) out += ",";
+        first = false;
+        out += key + "=\"";
+        for (char c : value) {
+            if (c == '\\' || c == '"') out += '\\';
+            if (c == '\n') { out += "\\n"; continue; }
+            out += c;
+        }
+        out += "\"";
+    };
+    for (const auto& label : labels) append(label.first, label.second);
+    if (!extraKey.empty()) append(extraKey, extraValue);
+    return out + "}";
+}
+
+std::string FormatValue(double value) {
+    if (std::isinf(value)) return value > 0 ? "+Inf" : "-Inf";
+    std::ostringstream out;
+    out.precision(17);
+    out << value;
+    return out.str();
+}
+
+} // namespace
+
+double Counter::Value() const {
+    double total = 0.0;
+    for (const auto& shard : shards_) total += shard.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+Histogram::Histogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+    std::sort(bounds_.begin(), bounds_.end());
+    for (auto& shard : shards_) {
+        shard.buckets.reset(new std::atomic<uint64_t>[bounds_.size() + 1]);
+        for (size_t i = 0; i <= bounds_.size(); ++i) shard.buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::Observe(double value) {
+    // Bucket i counts values <= bounds_[i]; the last bucket is +Inf
+    const size_t bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+    Shard& shard = shards_[metrics_detail::ThreadShard()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.Add(value);
+}
+
+Histogram::Snapshot Histogram::Read() const {
+    Snapshot snapshot;
+    snapshot.bounds = bounds_;
+    snapshot.cumulativeCounts.assign(bounds_.size() + 1, 0);
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i <= bounds_.size(); ++i) {
+            snapshot.cumulativeCounts[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        snapshot.sum += shard.sum.value.load(std::memory_order_relaxed);
+    }
+    for (size_t i = 1; i < snapshot.cumulativeCounts.size(); ++i) {
+        snapshot.cumulativeCounts[i] += snapshot.cumulativeCounts[i - 1];
+    }
+    snapshot.count = snapshot.cumulativeCounts.back();
+    return snapshot;
+}
+
+std::vector<double> Histogram::ExponentialBounds(double start, double factor, size_t count) {
+    std::vector<double> bounds;
+    bounds.reserve(count);
+    double bound = start;
+    for (size_t i = 0; i < count; ++i, bound *= factor) bounds.push_back(bound);
+    return bounds;
+}
+
+MetricsRegistry& MetricsRegistry::Global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Family& MetricsRegistry::GetFamily(const std::string& name, const std::string& help, Kind kind) {
+    auto it = families_.find(name);
+    if (it == families_.end()) {
+        it = families_.emplace(name, Family{kind, help, {}, {}, {}}).first;
+    } else if (it->second.kind != kind) {
+        std::cerr << "MetricsRegistry: " << name << " registered with a different type" << std::endl;
+    }
+    return it->second;
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = GetFamily(name, help, Kind::Counter).counters[labels];
+    if (!series) series = std::make_unique<Counter>();
+    return *series;
+}
+
+Gauge& MetricsRegistry::GetGauge(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = GetFamily(name, help, Kind::Gauge).gauges[labels];
+    if (!series) series = std::make_unique<Gauge>();
+    return *series;
+}
+
+Histogram& MetricsRegistry::GetHistogram(const std::string& name, const std::string& help,
+                                         const MetricLabels& labels, const std::vector<double>& bounds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = GetFamily(name, help, Kind::Histogram).histograms[labels];
+    if (!series) series = std::make_unique<Histogram>(bounds);
+    return *series;
+}
+
+std::string MetricsRegistry::RenderPrometheus() const {
+    std::ostringstream out;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : families_) {
+        const std::string& name = entry.first;
+        const Family& family = entry.second;
+        const char* type = family.kind == Kind::Counter ? "counter"
+                         : family.kind == Kind::Gauge   ? "gauge" : "histogram";
+        out << "# HELP " << name << " " << family.help << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+
+        for (const auto& series : family.counters) {
+            out << name << FormatLabels(series.first) << " " << FormatValue(series.second->Value()) << "\n";
+        }
+        for (const auto& series : family.gauges) {
+            out << name << FormatLabels(series.first) << " " << FormatValue(series.second->Value()) << "\n";
+        }
+        for (const auto& series : family.histograms) {
+            const Histogram::Snapshot snapshot = series.second->Read();
+            for (size_t i = 0; i < snapshot.bounds.size(); ++i) {
+                out << name << "_bucket" << FormatLabels(series.first, "le", FormatValue(snapshot.bounds[i]))
+                    << " " << snapshot.cumulativeCounts[i] << "\n";
+            }
+            out << name << "_bucket" << FormatLabels(series.first, "le", "+Inf") << " " << snapshot.count << "\n";
+            out << name << "_sum" << FormatLabels(series.first) << " " << FormatValue(snapshot.sum) << "\n";
+            out << name << "_count" << FormatLabels(series.first) << " " << snapshot.count << "\n";
+        }
+    }
+    return out.str();
+}
+
+bool MetricsRegistry::DumpToFile(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+    file << RenderPrometheus();
+    return file.good();
+}
+
+MetricsServer::MetricsServer(MetricsRegistry& registry)
+    : registry_(registry) {
+}
+
+MetricsServer::~MetricsServer() {
+    Stop();
+}
+
+bool MetricsServer::Start(int port) {
+    if (running_) return true;
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return false;
+#endif
+
+    SocketHandle sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == static_cast<SocketHandle>(-1)) {
+        std::cerr << "MetricsServer: socket() failed" << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    // Loopback only: the endpoint is meant for a local scraper or agent
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(sock, 8) != 0) {
+        std::cerr << "MetricsServer: cannot listen on 127.0.0.1:" << port << std::endl;
+        AISHOW_CLOSE_SOCKET(sock);
+        return false;
+    }
+
+    socklen_t addrLen = sizeof(addr);
+    getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addrLen);
+    port_ = ntohs(addr.sin_port);
+    listenSocket_ = static_cast<intptr_t>(sock);
+    running_ = true;
+    serverThread_ = std::thread(&MetricsServer::ServeLoop, this);
+    std::cout << "Metrics available at http://127.0.0.1:" << port_ << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsServer::Stop() {
+    if (!running_) return;
+    running_ = false;
+    if (serverThread_.joinable()) serverThread_.join();
+    AISHOW_CLOSE_SOCKET(static_cast<SocketHandle>(listenSocket_));
+    listenSocket_ = -1;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void MetricsServer::ServeLoop() {
+    const SocketHandle sock = static_cast<SocketHandle>(listenSocket_);
+    while (running_) {
+        // Poll with a timeout so Stop() is noticed without closing the socket under us
+#ifdef _WIN32
+        WSAPOLLFD pfd{sock, POLLRDNORM, 0};
+        int ready = WSAPoll(&pfd, 1, 200);
+#else
+        pollfd pfd{sock, POLLIN, 0};
+        int ready = poll(&pfd, 1, 200);
+#endif
+        if (ready <= 0) continue;
+
+        SocketHandle client = accept(sock, nullptr, nullptr);
+        if (client == static_cast<SocketHandle>(-1)) continue;
+        HandleClient(static_cast<intptr_t>(client));
+        AISHOW_CLOSE_SOCKET(client);
+    }
+}
+
+void MetricsServer::HandleClient(intptr_t clientHandle) {
+    const SocketHandle client = static_cast<SocketHandle>(clientHandle);
+    char request[1024];
+    int received = recv(client, request, sizeof(request) - 1, 0);
+    if (received <= 0) return;
+    request[received] = '\0';
+
+    std::string response;
+    if (std::strncmp(request, "GET /metrics", 12) == 0) {
+        const std::string body = registry_.RenderPrometheus();
+        response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                   std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    } else {
+        response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    }
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        int n = send(client, response.data() + sent, static_cast<int>(response.size() - sent), 0);
+        if (n <= 0) break;
+        sent += static_cast<size_t>(n);
+    }
+}
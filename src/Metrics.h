@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counters, gauges and histograms for dashboards.
+//
+// Hot-path updates go to one of kMetricShards cache-line-sized slots picked by
+// the calling thread, so workers never contend on a shared atomic; readers sum
+// the shards. Metrics are owned by the registry and never destroyed, so the
+// references it hands out can be cached.
+
+constexpr size_t kMetricShards = 16;
+
+namespace metrics_detail {
+size_t ThreadShard();
+
+struct alignas(64) AtomicDouble {
+    std::atomic<double> value{0.0};
+    void Add(double delta) {
+        double current = value.load(std::memory_order_relaxed);
+        while (!value.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+        }
+    }
+};
+} // namespace metrics_detail
+
+class Counter {
+public:
+    void Increment(double delta = 1.0) { shards_[metrics_detail::ThreadShard()].Add(delta); }
+    double Value() const;
+
+private:
+    metrics_detail::AtomicDouble shards_[kMetricShards];
+};
+
+class Gauge {
+public:
+    void Set(double value) { value_.store(value, std::memory_order_relaxed); }
+    void Add(double delta) {
+        double current = value_.load(std::memory_order_relaxed);
+        while (!value_.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+        }
+    }
+    double Value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds);
+
+    void Observe(double value);
+
+    struct Snapshot {
+        std::vector<double> bounds;
+        std::vector<uint64_t> cumulativeCounts;  // One per bound, plus +Inf
+        double sum = 0.0;
+        uint64_t count = 0;
+    };
+    Snapshot Read() const;
+
+    // Exponential bucket bounds: start, start*factor, ... (count bounds)
+    static std::vector<double> ExponentialBounds(double start, double factor, size_t count);
+
+private:
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+        metrics_detail::AtomicDouble sum;
+    };
+
+    std::vector<double> bounds_;
+    Shard shards_[kMetricShards];
+};
+
+using MetricLabels = std::map<std::string, std::string>;
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& Global();
+
+    Counter& GetCounter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Gauge& GetGauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    // Bounds are only used when the series is first created
+    Histogram& GetHistogram(const std::string& name, const std::string& help, const MetricLabels& labels = {},
+                            const std::vector<double>& bounds = Histogram::ExponentialBounds(0.0001, 2.0, 20));
+
+    // Prometheus text exposition format (version 0.0.4)
+    std::string RenderPrometheus() const;
+    bool DumpToFile(const std::string& filename) const;
+
+private:
+    enum class Kind { Counter, Gauge, Histogram };
+    struct Family {
+        Kind kind;
+        std::string help;
+        std::map<MetricLabels, std::unique_ptr<Counter>> counters;
+        std::map<MetricLabels, std::unique_ptr<Gauge>> gauges;
+        std::map<MetricLabels, std::unique_ptr<Histogram>> histograms;
+    };
+
+    Family& GetFamily(const std::string& name, const std::string& help, Kind kind);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+};
+
+// Serves the global registry as GET /metrics on a loopback TCP port
+class MetricsServer {
+public:
+    explicit MetricsServer(MetricsRegistry& registry = MetricsRegistry::Global());
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    bool Start(int port = 9464);
+    void Stop();
+    int GetPort() const { return port_; }
+
+private:
+    void ServeLoop();
+    void HandleClient(intptr_t client);
+
+    MetricsRegistry& registry_;
+    std::thread serverThread_;
+    std::atomic<bool> running_{false};
+    intptr_t listenSocket_{-1};
+    int port_{0};
+};
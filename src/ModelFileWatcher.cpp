@@ -0,0 +1,149 @@
+#include "ModelFileWatcher.h"
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+namespace {
+// Files are usually rewritten in several write() calls or via a temp file and
+// rename; wait until the directory has been quiet this long before parsing.
+constexpr int kDebounceMs = 50;
+}
+
+ModelFileWatcher::ModelFileWatcher(const std::string& filename)
+    : filename_(filename) {
+}
+
+ModelFileWatcher::~ModelFileWatcher() {
+    Stop();
+}
+
+bool ModelFileWatcher::Start() {
+    if (running_) return true;
+
+#ifdef __linux__
+    std::filesystem::path path(filename_);
+    std::string directory = path.has_parent_path() ? path.parent_path().string() : ".";
+
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        std::cerr << "ModelFileWatcher: inotify_init1 failed" << std::endl;
+        return false;
+    }
+    // Watch the directory rather than the file so that editors and tools that
+    // replace the file (write temp + rename) keep being picked up.
+    watchFd_ = inotify_add_watch(inotifyFd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (watchFd_ < 0 || wakeFd_ < 0) {
+        std::cerr << "ModelFileWatcher: failed to watch " << directory << std::endl;
+        if (wakeFd_ >= 0) close(wakeFd_);
+        close(inotifyFd_);
+        inotifyFd_ = watchFd_ = wakeFd_ = -1;
+        return false;
+    }
+#endif
+
+    running_ = true;
+    watchThread_ = std::thread(&ModelFileWatcher::WatchLoop, this);
+    std::cout << "Watching model file: " << filename_ << std::endl;
+    return true;
+}
+
+void ModelFileWatcher::Stop() {
+    if (!running_) return;
+
+    running_ = false;
+#ifdef __linux__
+    uint64_t one = 1;
+    if (write(wakeFd_, &one, sizeof(one)) < 0) {
+        // The watch loop also wakes up on its poll timeout
+    }
+#endif
+
+    if (watchThread_.joinable()) {
+        watchThread_.join();
+    }
+
+#ifdef __linux__
+    close(wakeFd_);
+    close(inotifyFd_);
+    inotifyFd_ = watchFd_ = wakeFd_ = -1;
+#endif
+}
+
+bool ModelFileWatcher::TakeSnapshot(ModelSnapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    if (!hasPendingSnapshot_) return false;
+    snapshot = std::move(pendingSnapshot_);
+    pendingSnapshot_ = ModelSnapshot();
+    hasPendingSnapshot_ = false;
+    return true;
+}
+
+void ModelFileWatcher::ParseAndPublish() {
+    MemoryScope memScope(MemTag::Model);
+    ModelSnapshot snapshot;
+    if (!AIModel::ParseFile(filename_, snapshot)) return;
+
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    pendingSnapshot_ = std::move(snapshot);
+    hasPendingSnapshot_ = true;
+}
+
+#ifdef __linux__
+void ModelFileWatcher::WatchLoop() {
+    const std::string basename = std::filesystem::path(filename_).filename().string();
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+
+    while (running_) {
+        pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+        // While a change is pending, a quiet timeout means the writer is done
+        int ready = poll(fds, 2, changed ? kDebounceMs : 1000);
+        if (!running_) break;
+
+        if (ready == 0) {
+            if (changed) {
+                changed = false;
+                ParseAndPublish();
+            }
+            continue;
+        }
+        if (ready < 0 || !(fds[0].revents & POLLIN)) continue;
+
+        ssize_t length;
+        while ((length = read(inotifyFd_, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                if (event->len > 0 && basename == event->name) {
+                    changed = true;
+                }
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+}
+#else
+void ModelFileWatcher::WatchLoop() {
+    // Portable fallback: poll the modification time
+    std::error_code ec;
+    auto lastWrite = std::filesystem::last_write_time(filename_, ec);
+
+    while (running_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        auto writeTime = std::filesystem::last_write_time(filename_, ec);
+        if (!ec && writeTime != lastWrite) {
+            lastWrite = writeTime;
+            std::this_thread::sleep_for(std::chrono::milliseconds(kDebounceMs));
+            ParseAndPublish();
+        }
+    }
+}
+#endif
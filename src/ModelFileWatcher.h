@@ -0,0 +1,46 @@
+#pragma once
+
+#include "AIModel.h"
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// Watches a model file and re-parses it on a background thread whenever it
+// changes. Only parsing happens off the main thread: the resulting snapshot is
+// handed over through TakeSnapshot() so the caller can diff and apply it to the
+// model (and editor) from the thread that owns them.
+class ModelFileWatcher {
+public:
+    explicit ModelFileWatcher(const std::string& filename);
+    ~ModelFileWatcher();
+
+    ModelFileWatcher(const ModelFileWatcher&) = delete;
+    ModelFileWatcher& operator=(const ModelFileWatcher&) = delete;
+
+    bool Start();
+    void Stop();
+    bool IsRunning() const { return running_.load(); }
+
+    // Retrieve the most recently parsed snapshot, if a new one is available.
+    // Intermediate versions written faster than they are consumed are dropped.
+    bool TakeSnapshot(ModelSnapshot& snapshot);
+
+private:
+    void WatchLoop();
+    void ParseAndPublish();
+
+    std::string filename_;
+    std::thread watchThread_;
+    std::atomic<bool> running_{false};
+
+    std::mutex snapshotMutex_;
+    ModelSnapshot pendingSnapshot_;
+    bool hasPendingSnapshot_{false};
+
+#ifdef __linux__
+    int inotifyFd_{-1};
+    int watchFd_{-1};
+    int wakeFd_{-1};   // eventfd used to interrupt poll() on Stop()
+#endif
+};
@@ -1,5 +1,10 @@
 #include "NodeEditor.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include "Metrics.h"
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 #include <unordered_map>
 #include <map>
@@ -35,8 +40,11 @@ bool NodeEditor::Initialize() {
     glfwSwapInterval(1); // Enable vsync
     glfwShowWindow(window_); // Explicitly show the window
 
-    // Initialize ImGui
+    // Initialize ImGui; its allocations (and ImNodes', which go through ImGui)
+    // are routed through the memory tracker
+    MemoryScope memScope(MemTag::Editor);
     IMGUI_CHECKVERSION();
+    ImGui::SetAllocatorFunctions(&MemoryTracker::ImGuiAlloc, &MemoryTracker::ImGuiFree, nullptr);
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
@@ -48,7 +56,10 @@ bool NodeEditor::Initialize() {
     ImGui_ImplOpenGL3_Init("#version 330");
 
     // Initialize ImNodes
-    imnodes_context_ = ImNodes::CreateContext();
+    {
+        MemoryScope imnodesScope(MemTag::ImNodes);
+        imnodes_context_ = ImNodes::CreateContext();
+    }
     ImNodes::SetCurrentContext(imnodes_context_);
 
     std::cout << "NodeEditor initialized successfully" << std::endl;
@@ -76,6 +87,8 @@ void NodeEditor::Shutdown() {
 
 void NodeEditor::Render() {
     if (!window_) return;
+    PROFILE_ZONE("NodeEditor::Render");
+    MemoryScope memScope(MemTag::Editor);
 
     // Process operations queued during the last frame before starting a new ImGui frame
     deferredOps_ = pendingOps_;
@@ -83,10 +96,13 @@ void NodeEditor::Render() {
     ProcessDeferredOps();
 
     // Poll events and start ImGui frame
-    glfwPollEvents();
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
+    {
+        PROFILE_ZONE("NewFrame");
+        glfwPollEvents();
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+    }
 
     // Main window
     // std::cout << "Render: Creating main window" << std::endl;
@@ -102,12 +118,152 @@ void NodeEditor::Render() {
         if (ImGui::Button("Sync Model -> Editor")) {
             if (onSyncRequest_) onSyncRequest_();
         }
+        if (ImGui::BeginMenu("View")) {
+            ImGui::MenuItem("Memory", nullptr, &showMemoryPanel_);
+            ImGui::MenuItem("Profiler", nullptr, &showProfilerPanel_);
+            ImGui::MenuItem("Timeline", nullptr, &showTimelinePanel_);
+            ImGui::MenuItem("Roofline", nullptr, &showRooflinePanel_);
+            ImGui::Separator();
+            if (ImGui::MenuItem("Dump metrics")) {
+                MetricsRegistry::Global().DumpToFile("aishow_metrics.prom");
+            }
+            ImGui::EndMenu();
+        }
+        if (ImGui::BeginMenu("Precision")) {
+            if (ImGui::MenuItem("FP32", nullptr, false, onSetPrecision_ != nullptr)) {
+                onSetPrecision_(Precision::FP32);
+            }
+            if (ImGui::MenuItem("FP16 storage", nullptr, false, onSetPrecision_ != nullptr)) {
+                onSetPrecision_(Precision::FP16);
+            }
+            if (ImGui::MenuItem("BF16 storage", nullptr, false, onSetPrecision_ != nullptr)) {
+                onSetPrecision_(Precision::BF16);
+            }
+            if (ImGui::MenuItem("INT8 (calibrate)", nullptr, false, onSetPrecision_ != nullptr)) {
+                onSetPrecision_(Precision::INT8);
+            }
+            ImGui::EndMenu();
+        }
+        if (ImGui::BeginMenu("Trace")) {
+            if (ImGui::MenuItem("Save last run", nullptr, false, onSaveTrace_ != nullptr)) {
+                onSaveTrace_();
+            }
+            ImGui::Separator();
+            ImGui::Checkbox("Virtual time", &replayVirtualTime_);
+            ImGui::BeginDisabled(replayVirtualTime_);
+            ImGui::SliderFloat("Speed", &replaySpeed_, 0.1f, 10.0f, "%.2fx", ImGuiSliderFlags_Logarithmic);
+            ImGui::EndDisabled();
+            if (ImGui::MenuItem("Replay saved run", nullptr, false, onReplayTrace_ != nullptr)) {
+                onReplayTrace_(replayVirtualTime_ ? 0.0 : static_cast<double>(replaySpeed_));
+            }
+            ImGui::EndMenu();
+        }
         ImGui::EndMenuBar();
     }
 
     // Node editor
+    RenderGraph();
+
+    // Update node positions from ImNodes (after user interaction)
+    for (auto& node : nodes_.elements()) {
+        ImVec2 currentPos = ImNodes::GetNodeGridSpacePos(node.id);
+        if (currentPos.x != node.positionX || currentPos.y != node.positionY) {
+            node.positionX = currentPos.x;
+            node.positionY = currentPos.y;
+        }
+    }
+
+    // Handle new links
+    int start_attr, end_attr;
+    if (ImNodes::IsLinkCreated(&start_attr, &end_attr)) {
+        // Find nodes for these attributes
+        int start_node = -1, end_node = -1;
+        for (const auto& node : nodes_.elements()) {
+            for (int input : node.inputs) {
+                if (input == start_attr) start_node = node.id;
+                if (input == end_attr) end_node = node.id;
+            }
+            for (int output : node.outputs) {
+                if (output == start_attr) start_node = node.id;
+                if (output == end_attr) end_node = node.id;
+            }
+        }
+
+        if (start_node != -1 && end_node != -1) {
+            AddLink(start_node, end_node, start_attr, end_attr);
+        }
+    }
+
+    // Handle deleted links
+    int link_id;
+    if (ImNodes::IsLinkDestroyed(&link_id)) {
+        RemoveLink(link_id);
+    }
+
+    {
+        const int num_selected = ImNodes::NumSelectedLinks();
+        if (num_selected > 0 && ImGui::IsKeyReleased(ImGuiKey_Delete))
+        {
+            static std::vector<int> selected_links;
+            selected_links.resize(static_cast<size_t>(num_selected));
+            ImNodes::GetSelectedLinks(selected_links.data());
+            for (const int edge_id : selected_links)
+            {
+                RemoveLink(edge_id);
+            }
+        }
+    }
+
+
+    // Handle node deletion (Delete key)
+    if (ImGui::IsKeyPressed(ImGuiKey_Delete)) {
+        // Get selected nodes
+        std::vector<int> selectedNodes;
+        for (const auto& node : nodes_.elements()) {
+            if (ImNodes::IsNodeSelected(node.id)) {
+                selectedNodes.push_back(node.id);
+            }
+        }
+
+        // Remove selected nodes
+        for (int nodeId : selectedNodes) {
+            RemoveNode(nodeId);
+        }
+    }
+
+    ImGui::End();
+
+    if (showMemoryPanel_) RenderMemoryPanel();
+    if (showProfilerPanel_) RenderProfilerPanel();
+    if (showTimelinePanel_) RenderTimelinePanel();
+    if (showRooflinePanel_) RenderRooflinePanel();
+
+    // Render (the zone runs to the end of the frame)
+    PROFILE_ZONE("Present");
+    // std::cout << "Render: Calling ImGui::Render()" << std::endl;
+    ImGui::Render();
+    // std::cout << "Render: Getting framebuffer size" << std::endl;
+    int display_w, display_h;
+    glfwGetFramebufferSize(window_, &display_w, &display_h);
+    // std::cout << "Render: Setting viewport to " << display_w << "x" << display_h << std::endl;
+    glViewport(0, 0, display_w, display_h);
+    glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    // std::cout << "Render: Drawing render data" << std::endl;
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+    // std::cout << "Render: Swapping buffers" << std::endl;
+    glfwSwapBuffers(window_);
+}
+
+void NodeEditor::RenderGraph() {
+    PROFILE_ZONE("NodeEditor::RenderGraph");
+    // Everything ImGui allocates while drawing the graph is ImNodes state
+    MemoryScope memScope(MemTag::ImNodes);
     ImNodes::BeginNodeEditor();
 
+    const NodeCostMap* costs = nodeCostSource_ ? &nodeCostSource_() : nullptr;
+
     // Render nodes
     for (const auto& node : nodes_.elements()) {
         // Set node position in ImNodes
@@ -118,6 +274,15 @@ void NodeEditor::Render() {
         ImGui::Text("%s", node.name.c_str());
         ImNodes::EndNodeTitleBar();
 
+        // Predicted time and which roof bounds it
+        if (costs && node.boundAINodeId >= 0) {
+            auto cost = costs->find(node.boundAINodeId);
+            if (cost != costs->end()) {
+                ImGui::TextDisabled("~%.3f ms, %s, %s", cost->second.predictedSeconds * 1e3,
+                                    cost->second.computeBound ? "compute" : "memory", PrecisionName(cost->second.precision));
+            }
+        }
+
         // Draw progress bar below the title if node is executing
         if (node.boundAINodeId >= 0) {
             auto it = executionProgress_.find(node.boundAINodeId);
@@ -195,90 +360,462 @@ void NodeEditor::Render() {
 
     ImNodes::EndNodeEditor();
 
-    // Update node positions from ImNodes (after user interaction)
-    for (auto& node : nodes_.elements()) {
-        ImVec2 currentPos = ImNodes::GetNodeGridSpacePos(node.id);
-        if (currentPos.x != node.positionX || currentPos.y != node.positionY) {
-            node.positionX = currentPos.x;
-            node.positionY = currentPos.y;
+    // Selection requested by another panel (e.g. a timeline click)
+    if (nodeToSelect_ != -1 && nodes_.contains(nodeToSelect_)) {
+        ImNodes::ClearNodeSelection();
+        ImNodes::SelectNode(nodeToSelect_);
+    }
+    nodeToSelect_ = -1;
+}
+
+void NodeEditor::RenderMemoryPanel() {
+    ImGui::SetNextWindowSize(ImVec2(520, 260), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Memory", &showMemoryPanel_)) {
+        ImGui::End();
+        return;
+    }
+
+    if (!MemoryTracker::Enabled()) {
+        ImGui::TextDisabled("Allocation tracking is disabled (AISHOW_TRACK_ALLOCATIONS=OFF)");
+    }
+
+    auto drawTable = [](const char* id, const MemorySnapshot& snapshot) {
+        if (!ImGui::BeginTable(id, 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) return;
+        ImGui::TableSetupColumn("Subsystem");
+        ImGui::TableSetupColumn("Live KB");
+        ImGui::TableSetupColumn("Peak KB");
+        ImGui::TableSetupColumn("Alloc KB");
+        ImGui::TableSetupColumn("Allocs");
+        ImGui::TableSetupColumn("Frees");
+        ImGui::TableHeadersRow();
+        for (size_t i = 0; i < kMemTagCount; ++i) {
+            const MemTagStats& stats = snapshot[i];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(MemTagName(static_cast<MemTag>(i)));
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", stats.currentBytes / 1024.0);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", stats.peakBytes / 1024.0);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", stats.allocatedBytes / 1024.0);
+            ImGui::TableNextColumn(); ImGui::Text("%lld", static_cast<long long>(stats.allocations));
+            ImGui::TableNextColumn(); ImGui::Text("%lld", static_cast<long long>(stats.frees));
+        }
+        ImGui::EndTable();
+    };
+
+    ImGui::TextUnformatted("Process totals");
+    drawTable("##memory_totals", MemoryTracker::Snapshot());
+    ImGui::Spacing();
+    ImGui::TextUnformatted("Last execution run");
+    drawTable("##memory_last_run", MemoryTracker::LastRun());
+
+    ImGui::End();
+}
+
+void NodeEditor::RenderProfilerPanel() {
+    ImGui::SetNextWindowSize(ImVec2(900, 320), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", &showProfilerPanel_)) {
+        ImGui::End();
+        return;
+    }
+
+    if (!Profiler::Enabled()) {
+        ImGui::TextDisabled("Profiler is compiled out (AISHOW_ENABLE_PROFILER=OFF)");
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Checkbox("Pause", &profilerPaused_);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(200.0f);
+    ImGui::SliderFloat("Window (ms)", &profilerWindowMs_, 16.0f, 5000.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome trace")) {
+        const char* path = "aishow_trace.json";
+        if (Profiler::ExportChromeTrace(path)) {
+            std::cout << "Profiler: wrote " << path << std::endl;
+        } else {
+            std::cerr << "Profiler: failed to write " << path << std::endl;
         }
     }
 
-    // Handle new links
-    int start_attr, end_attr;
-    if (ImNodes::IsLinkCreated(&start_attr, &end_attr)) {
-        // Find nodes for these attributes
-        int start_node = -1, end_node = -1;
-        for (const auto& node : nodes_.elements()) {
-            for (int input : node.inputs) {
-                if (input == start_attr) start_node = node.id;
-                if (input == end_attr) end_node = node.id;
+    const int64_t windowNs = static_cast<int64_t>(profilerWindowMs_ * 1e6);
+    if (!profilerPaused_) {
+        profilerEndNs_ = Profiler::NowNs();
+        profilerLanes_ = Profiler::Collect(profilerEndNs_ - windowNs);
+    }
+    const int64_t startNs = profilerEndNs_ - windowNs;
+
+    // One flame graph per thread: x is time, rows are nesting depth
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const float width = ImGui::GetContentRegionAvail().x;
+    const double pxPerNs = width / static_cast<double>(windowNs);
+
+    ImGui::BeginChild("##flame", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
+    for (const auto& lane : profilerLanes_) {
+        uint32_t maxDepth = 0;
+        for (const auto& zone : lane.zones) maxDepth = std::max(maxDepth, zone.depth);
+
+        ImGui::TextUnformatted(lane.threadName.c_str());
+        const ImVec2 origin = ImGui::GetCursorScreenPos();
+        const float laneHeight = (maxDepth + 1) * rowHeight;
+        ImGui::InvisibleButton(("##lane" + std::to_string(lane.lane)).c_str(), ImVec2(width, laneHeight));
+        const bool laneHovered = ImGui::IsItemHovered();
+        const ImVec2 mouse = ImGui::GetIO().MousePos;
+
+        for (const auto& zone : lane.zones) {
+            if (zone.endNs < startNs) continue;
+            float x0 = origin.x + static_cast<float>((std::max(zone.beginNs, startNs) - startNs) * pxPerNs);
+            float x1 = origin.x + static_cast<float>((zone.endNs - startNs) * pxPerNs);
+            x1 = std::max(x1, x0 + 1.0f);
+            const float y0 = origin.y + zone.depth * rowHeight;
+            const float y1 = y0 + rowHeight - 1.0f;
+
+            // Color by name so the same zone keeps its color across frames
+            ImU32 hash = 2166136261u;
+            for (const char* c = zone.name; *c; ++c) hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+            const ImU32 color = IM_COL32(80 + (hash & 0x7F), 80 + ((hash >> 8) & 0x7F), 80 + ((hash >> 16) & 0x7F), 255);
+            drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), color);
+
+            const ImVec2 textSize = ImGui::CalcTextSize(zone.name);
+            if (x1 - x0 > textSize.x + 4.0f) {
+                drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32_WHITE, zone.name);
             }
-            for (int output : node.outputs) {
-                if (output == start_attr) start_node = node.id;
-                if (output == end_attr) end_node = node.id;
+            if (laneHovered && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1) {
+                ImGui::SetTooltip("%s\n%.3f ms", zone.name, (zone.endNs - zone.beginNs) / 1e6);
             }
         }
+    }
+    ImGui::EndChild();
 
-        if (start_node != -1 && end_node != -1) {
-            AddLink(start_node, end_node, start_attr, end_attr);
+    ImGui::End();
+}
+
+void NodeEditor::UpdateTimelineIndex() {
+    const ExecutionLog& log = *executionLog_;
+    if (log.RunId() != timeline_.runId) {
+        timeline_.runId = log.RunId();
+        timeline_.indexed = 0;
+        timeline_.lanes.assign(static_cast<size_t>(std::max(log.NumWorkers(), 1)), {});
+        timeline_.spanByNode.clear();
+        timeline_.critical.clear();
+        timeline_.criticalComputed = false;
+        timeline_.follow = true;
+    }
+
+    // Only new entries are indexed; a worker runs one node at a time, so
+    // appending in log order keeps every lane sorted by time
+    const size_t size = log.Size();
+    for (size_t i = timeline_.indexed; i < size; ++i) {
+        const ExecutionLog::Span& span = log[i];
+        const size_t lane = static_cast<size_t>(std::max(span.worker, 0));
+        if (lane >= timeline_.lanes.size()) timeline_.lanes.resize(lane + 1);
+        timeline_.lanes[lane].push_back(static_cast<uint32_t>(i));
+        timeline_.spanByNode[span.nodeId] = static_cast<uint32_t>(i);
+    }
+    timeline_.indexed = size;
+
+    // Critical path: walk back from the last node to finish through the
+    // predecessor that released each node
+    if (log.Finished() && !timeline_.criticalComputed && size > 0) {
+        timeline_.critical.assign(size, false);
+        size_t last = 0;
+        for (size_t i = 1; i < size; ++i) {
+            if (log[i].endNs > log[last].endNs) last = i;
         }
+        for (size_t current = last;;) {
+            timeline_.critical[current] = true;
+            auto it = timeline_.spanByNode.find(log[current].readyByNodeId);
+            if (it == timeline_.spanByNode.end() || timeline_.critical[it->second]) break;
+            current = it->second;
+        }
+        timeline_.criticalComputed = true;
     }
+}
 
-    // Handle deleted links
-    int link_id;
-    if (ImNodes::IsLinkDestroyed(&link_id)) {
-        RemoveLink(link_id);
+void NodeEditor::RenderTimelinePanel() {
+    ImGui::SetNextWindowSize(ImVec2(900, 300), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Timeline", &showTimelinePanel_)) {
+        ImGui::End();
+        return;
+    }
+    if (!executionLog_) {
+        ImGui::TextDisabled("No execution log attached");
+        ImGui::End();
+        return;
     }
 
-    {
-        const int num_selected = ImNodes::NumSelectedLinks();
-        if (num_selected > 0 && ImGui::IsKeyReleased(ImGuiKey_Delete))
-        {
-            static std::vector<int> selected_links;
-            selected_links.resize(static_cast<size_t>(num_selected));
-            ImNodes::GetSelectedLinks(selected_links.data());
-            for (const int edge_id : selected_links)
-            {
-                RemoveLink(edge_id);
-            }
-        }
+    UpdateTimelineIndex();
+    const ExecutionLog& log = *executionLog_;
+    const size_t size = log.Size();
+
+    // Latest time covered by the log
+    double runEndNs = log.Finished() ? static_cast<double>(log.EndNs()) : 0.0;
+    for (const auto& lane : timeline_.lanes) {
+        if (!lane.empty()) runEndNs = std::max(runEndNs, static_cast<double>(log[lane.back()].endNs));
     }
 
+    if (ImGui::Button("Fit")) timeline_.follow = true;
+    ImGui::SameLine();
+    ImGui::Checkbox("Follow", &timeline_.follow);
+    ImGui::SameLine();
+    ImGui::Text("%zu spans, %.3f ms%s", size, runEndNs / 1e6, log.Finished() ? "" : " (running)");
+    if (timeline_.follow) {
+        timeline_.viewStartNs = 0.0;
+        timeline_.viewEndNs = std::max(runEndNs, 1e6);
+    }
 
-    // Handle node deletion (Delete key)
-    if (ImGui::IsKeyPressed(ImGuiKey_Delete)) {
-        // Get selected nodes
-        std::vector<int> selectedNodes;
-        for (const auto& node : nodes_.elements()) {
-            if (ImNodes::IsNodeSelected(node.id)) {
-                selectedNodes.push_back(node.id);
+    const float laneHeight = ImGui::GetTextLineHeight() + 8.0f;
+    const float labelWidth = 70.0f;
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const ImVec2 avail = ImGui::GetContentRegionAvail();
+    const float trackWidth = std::max(avail.x - labelWidth, 50.0f);
+    const float height = std::max(laneHeight * timeline_.lanes.size(), laneHeight);
+    ImGui::InvisibleButton("##timeline", ImVec2(avail.x, height));
+    const bool hovered = ImGui::IsItemHovered();
+    ImGuiIO& io = ImGui::GetIO();
+
+    double viewSpan = std::max(timeline_.viewEndNs - timeline_.viewStartNs, 1.0);
+    const float trackX = origin.x + labelWidth;
+
+    // Wheel zooms around the cursor, dragging pans
+    if (hovered && io.MouseWheel != 0.0f) {
+        const double mouseNs = timeline_.viewStartNs + (io.MousePos.x - trackX) / trackWidth * viewSpan;
+        const double scale = io.MouseWheel > 0.0f ? 0.8 : 1.25;
+        timeline_.viewStartNs = mouseNs - (mouseNs - timeline_.viewStartNs) * scale;
+        timeline_.viewEndNs = mouseNs + (timeline_.viewEndNs - mouseNs) * scale;
+        timeline_.follow = false;
+    }
+    if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
+        const double deltaNs = -io.MouseDelta.x / trackWidth * viewSpan;
+        timeline_.viewStartNs += deltaNs;
+        timeline_.viewEndNs += deltaNs;
+        timeline_.follow = false;
+    }
+    viewSpan = std::max(timeline_.viewEndNs - timeline_.viewStartNs, 1.0);
+    const double pxPerNs = trackWidth / viewSpan;
+    const double viewStart = timeline_.viewStartNs;
+    const double viewEnd = timeline_.viewEndNs;
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->PushClipRect(origin, ImVec2(origin.x + avail.x, origin.y + height), true);
+
+    const ImU32 spanColor = IM_COL32(70, 130, 200, 255);
+    const ImU32 criticalColor = IM_COL32(230, 90, 60, 255);
+    const ImU32 idleColor = IM_COL32(120, 40, 40, 90);
+    int hoveredSpan = -1;
+
+    for (size_t laneIndex = 0; laneIndex < timeline_.lanes.size(); ++laneIndex) {
+        const auto& lane = timeline_.lanes[laneIndex];
+        const float y0 = origin.y + laneIndex * laneHeight + 2.0f;
+        const float y1 = y0 + laneHeight - 4.0f;
+        drawList->AddText(ImVec2(origin.x + 4.0f, y0 + 2.0f), IM_COL32_WHITE, ("worker " + std::to_string(laneIndex)).c_str());
+
+        // Cull: start at the first span that ends inside the view
+        auto it = std::lower_bound(lane.begin(), lane.end(), viewStart,
+            [&log](uint32_t index, double t) { return log[index].endNs < t; });
+
+        double previousEnd = it != lane.begin() ? static_cast<double>(log[*(it - 1)].endNs) : 0.0;
+        while (it != lane.end()) {
+            const ExecutionLog::Span& span = log[*it];
+            if (span.startNs > viewEnd) break;
+
+            const float x0 = trackX + static_cast<float>((span.startNs - viewStart) * pxPerNs);
+            const float x1 = std::max(trackX + static_cast<float>((span.endNs - viewStart) * pxPerNs), x0 + 1.0f);
+            const float gapX0 = trackX + static_cast<float>((previousEnd - viewStart) * pxPerNs);
+            if (x0 - gapX0 >= 1.0f) {
+                drawList->AddRectFilled(ImVec2(gapX0, y0), ImVec2(x0, y1), idleColor);
             }
-        }
 
-        // Remove selected nodes
-        for (int nodeId : selectedNodes) {
-            RemoveNode(nodeId);
+            const bool critical = timeline_.criticalComputed && timeline_.critical[*it];
+            drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), critical ? criticalColor : spanColor);
+            if (x1 - x0 > 40.0f) {
+                int uiId = FindNodeByAINodeId(span.nodeId);
+                const char* label = uiId != -1 ? nodes_.find(uiId)->name.c_str() : "?";
+                drawList->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+                drawList->AddText(ImVec2(x0 + 3.0f, y0 + 2.0f), IM_COL32_WHITE, label);
+                drawList->PopClipRect();
+            }
+            if (hovered && io.MousePos.x >= x0 && io.MousePos.x < x1 && io.MousePos.y >= y0 && io.MousePos.y < y1) {
+                hoveredSpan = static_cast<int>(*it);
+            }
+            previousEnd = static_cast<double>(span.endNs);
+
+            // Spans narrower than a pixel: skip ahead to the next pixel column,
+            // so a lane costs O(visible pixels * log n) however many spans it has
+            if (x1 - x0 <= 1.0f) {
+                const double nextPixelNs = viewStart + (std::floor(x1 - trackX) + 1.0) / pxPerNs;
+                auto next = std::lower_bound(it + 1, lane.end(), nextPixelNs,
+                    [&log](uint32_t index, double t) { return log[index].endNs < t; });
+                if (next != it + 1) previousEnd = static_cast<double>(log[*(next - 1)].endNs);
+                it = next;
+            } else {
+                ++it;
+            }
+        }
+    }
+    drawList->PopClipRect();
+
+    if (hoveredSpan >= 0) {
+        const ExecutionLog::Span& span = log[static_cast<size_t>(hoveredSpan)];
+        int uiId = FindNodeByAINodeId(span.nodeId);
+        ImGui::SetTooltip("%s (node %d)\n%.3f ms .. %.3f ms (%.3f ms)%s",
+                          uiId != -1 ? nodes_.find(uiId)->name.c_str() : "?", span.nodeId,
+                          span.startNs / 1e6, span.endNs / 1e6, (span.endNs - span.startNs) / 1e6,
+                          timeline_.criticalComputed && timeline_.critical[hoveredSpan] ? "\ncritical path" : "");
+        if (ImGui::IsMouseReleased(ImGuiMouseButton_Left) && io.MouseDragMaxDistanceSqr[0] < 9.0f) {
+            nodeToSelect_ = uiId;
         }
     }
 
     ImGui::End();
+}
 
-    // Render
-    // std::cout << "Render: Calling ImGui::Render()" << std::endl;
-    ImGui::Render();
-    // std::cout << "Render: Getting framebuffer size" << std::endl;
-    int display_w, display_h;
-    glfwGetFramebufferSize(window_, &display_w, &display_h);
-    // std::cout << "Render: Setting viewport to " << display_w << "x" << display_h << std::endl;
-    glViewport(0, 0, display_w, display_h);
-    glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    // std::cout << "Render: Drawing render data" << std::endl;
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+void NodeEditor::RenderRooflinePanel() {
+    ImGui::SetNextWindowSize(ImVec2(760, 560), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Roofline", &showRooflinePanel_)) {
+        ImGui::End();
+        return;
+    }
+    if (!nodeCostSource_) {
+        ImGui::TextDisabled("No cost model attached");
+        ImGui::End();
+        return;
+    }
 
-    // std::cout << "Render: Swapping buffers" << std::endl;
-    glfwSwapBuffers(window_);
+    const NodeCostMap& costs = nodeCostSource_();
+    const MachinePeak& peak = CostModel::Peak();
+    ImGui::Text("Peak %.1f GFLOP/s, %.1f GB/s, ridge point %.2f FLOP/byte",
+                peak.flopsPerSecond / 1e9, peak.bytesPerSecond / 1e9, peak.RidgePoint());
+
+    // Measured durations from the last run, when there is one
+    std::unordered_map<int, double> measuredSeconds;
+    if (executionLog_) {
+        const size_t size = executionLog_->Size();
+        for (size_t i = 0; i < size; ++i) {
+            const ExecutionLog::Span& span = (*executionLog_)[i];
+            measuredSeconds[span.nodeId] = (span.endNs - span.startNs) / 1e9;
+        }
+    }
+
+    // Log-log plot: arithmetic intensity (FLOP/byte) against GFLOP/s
+    const double peakGflops = std::max(peak.flopsPerSecond / 1e9, 1e-3);
+    const double minX = -2.0, maxX = 3.0;
+    const double maxY = std::log10(peakGflops) + 0.5, minY = maxY - 5.0;
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const ImVec2 plotSize(ImGui::GetContentRegionAvail().x, 260.0f);
+    ImGui::InvisibleButton("##roofline", plotSize);
+    const bool plotHovered = ImGui::IsItemHovered();
+    auto toScreen = [&](double intensity, double gflops) {
+        const double x = (std::log10(std::max(intensity, 1e-12)) - minX) / (maxX - minX);
+        const double y = (std::log10(std::max(gflops, 1e-12)) - minY) / (maxY - minY);
+        return ImVec2(origin.x + static_cast<float>(std::clamp(x, 0.0, 1.0)) * plotSize.x,
+                      origin.y + static_cast<float>(1.0 - std::clamp(y, 0.0, 1.0)) * plotSize.y);
+    };
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    const ImVec2 plotMax(origin.x + plotSize.x, origin.y + plotSize.y);
+    drawList->AddRectFilled(origin, plotMax, IM_COL32(25, 25, 30, 255));
+    for (int decade = static_cast<int>(minX); decade <= static_cast<int>(maxX); ++decade) {
+        const ImVec2 p = toScreen(std::pow(10.0, decade), std::pow(10.0, minY));
+        drawList->AddLine(ImVec2(p.x, origin.y), ImVec2(p.x, plotMax.y), IM_COL32(60, 60, 70, 255));
+        char label[16];
+        std::snprintf(label, sizeof(label), "%g", std::pow(10.0, decade));
+        drawList->AddText(ImVec2(p.x + 2.0f, plotMax.y - ImGui::GetTextLineHeight()), IM_COL32(150, 150, 160, 255), label);
+    }
+    for (int decade = static_cast<int>(std::ceil(minY)); decade <= static_cast<int>(std::floor(maxY)); ++decade) {
+        const ImVec2 p = toScreen(std::pow(10.0, minX), std::pow(10.0, decade));
+        drawList->AddLine(ImVec2(origin.x, p.y), ImVec2(plotMax.x, p.y), IM_COL32(60, 60, 70, 255));
+        char label[24];
+        std::snprintf(label, sizeof(label), "%g GFLOP/s", std::pow(10.0, decade));
+        drawList->AddText(ImVec2(origin.x + 2.0f, p.y), IM_COL32(150, 150, 160, 255), label);
+    }
+
+    // Roof: bandwidth slope up to the ridge point, then the compute ceiling
+    const double bandwidthGBs = peak.bytesPerSecond / 1e9;
+    const double ridge = std::clamp(peak.RidgePoint(), std::pow(10.0, minX), std::pow(10.0, maxX));
+    const ImU32 roofColor = IM_COL32(230, 200, 80, 255);
+    drawList->AddLine(toScreen(std::pow(10.0, minX), bandwidthGBs * std::pow(10.0, minX)),
+                      toScreen(ridge, bandwidthGBs * ridge), roofColor, 2.0f);
+    drawList->AddLine(toScreen(ridge, peakGflops), toScreen(std::pow(10.0, maxX), peakGflops), roofColor, 2.0f);
+
+    // Predicted positions sit on the roof (filled); measured ones (hollow) show
+    // how far the last run was from it
+    const ImU32 computeColor = IM_COL32(230, 90, 60, 255);
+    const ImU32 memoryColor = IM_COL32(70, 130, 200, 255);
+    int hoveredNode = -1;
+    float hoveredDistance = 36.0f;  // Squared pixels
+    for (const auto& node : nodes_.elements()) {
+        auto cost = costs.find(node.boundAINodeId);
+        if (node.boundAINodeId < 0 || cost == costs.end() || cost->second.predictedSeconds <= 0.0) continue;
+        const NodeCost& c = cost->second;
+        const ImU32 color = c.computeBound ? computeColor : memoryColor;
+        const ImVec2 predicted = toScreen(c.Intensity(), c.flops / c.predictedSeconds / 1e9);
+        drawList->AddCircleFilled(predicted, 4.0f, color);
+        auto measured = measuredSeconds.find(node.boundAINodeId);
+        if (measured != measuredSeconds.end() && measured->second > 0.0) {
+            const ImVec2 achieved = toScreen(c.Intensity(), c.flops / measured->second / 1e9);
+            drawList->AddLine(predicted, achieved, IM_COL32(150, 150, 160, 120));
+            drawList->AddCircle(achieved, 4.0f, color);
+        }
+        const ImVec2 mouse = ImGui::GetIO().MousePos;
+        const float dx = mouse.x - predicted.x, dy = mouse.y - predicted.y;
+        if (plotHovered && dx * dx + dy * dy < hoveredDistance) {
+            hoveredDistance = dx * dx + dy * dy;
+            hoveredNode = node.id;
+        }
+    }
+    if (hoveredNode != -1) {
+        const UINode& node = *nodes_.find(hoveredNode);
+        const NodeCost& c = costs.at(node.boundAINodeId);
+        ImGui::SetTooltip("%s\n%.3f GFLOP, %.2f MB, %.2f FLOP/byte\npredicted %.3f ms (%s-bound)",
+                          node.name.c_str(), c.flops / 1e9, c.bytes / 1e6, c.Intensity(),
+                          c.predictedSeconds * 1e3, c.computeBound ? "compute" : "memory");
+        if (ImGui::IsMouseClicked(ImGuiMouseButton_Left)) nodeToSelect_ = hoveredNode;
+    }
+
+    // Per-node table
+    if (ImGui::BeginTable("##costs", 9, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Node");
+        ImGui::TableSetupColumn("Output");
+        ImGui::TableSetupColumn("GFLOP");
+        ImGui::TableSetupColumn("MB");
+        ImGui::TableSetupColumn("FLOP/B");
+        ImGui::TableSetupColumn("Bound");
+        ImGui::TableSetupColumn("Precision");
+        ImGui::TableSetupColumn("Predicted ms");
+        ImGui::TableSetupColumn("Measured ms");
+        ImGui::TableHeadersRow();
+
+        const auto elements = nodes_.elements();
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(elements.end() - elements.begin()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const UINode& node = elements.begin()[row];
+                auto cost = costs.find(node.boundAINodeId);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(node.name.c_str());
+                if (node.boundAINodeId < 0 || cost == costs.end()) continue;
+                const NodeCost& c = cost->second;
+                ImGui::TableNextColumn();
+                ImGui::Text("%lldx%lldx%lldx%lld", static_cast<long long>(c.output.n), static_cast<long long>(c.output.c),
+                            static_cast<long long>(c.output.h), static_cast<long long>(c.output.w));
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", c.flops / 1e9);
+                ImGui::TableNextColumn(); ImGui::Text("%.2f", c.bytes / 1e6);
+                ImGui::TableNextColumn(); ImGui::Text("%.2f", c.Intensity());
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(c.computeBound ? "compute" : "memory");
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(PrecisionName(c.precision));
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", c.predictedSeconds * 1e3);
+                ImGui::TableNextColumn();
+                auto measured = measuredSeconds.find(node.boundAINodeId);
+                if (measured != measuredSeconds.end()) ImGui::Text("%.3f", measured->second * 1e3);
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
 }
 
 void NodeEditor::AddNode(const std::string& name, float posX, float posY, int boundAINodeId) {
@@ -336,6 +873,44 @@ void NodeEditor::QueueConnectionForSync(int fromAiNodeId, int toAiNodeId, int fr
     pendingConnections_.push_back(conn);
 }
 
+void NodeEditor::RenameNode(int nodeId, const std::string& name) {
+    auto iter = nodes_.find(nodeId);
+    if (iter != nodes_.end()) {
+        iter->name = name;
+    }
+}
+
+void NodeEditor::RemoveLink(int startNode, int startPort, int endNode, int endPort) {
+    auto start = nodes_.find(startNode);
+    auto end = nodes_.find(endNode);
+    if (start == nodes_.end() || end == nodes_.end() || start->outputs.empty() || end->inputs.empty()) return;
+    const int startAttr = PortAttribute(start->outputs, startPort);
+    const int endAttr = PortAttribute(end->inputs, endPort);
+    for (const auto& link : links_.elements()) {
+        if (link.start_node == startNode && link.end_node == endNode && link.start_attr == startAttr &&
+            link.end_attr == endAttr) {
+            links_.erase(link.id);
+            return;
+        }
+    }
+}
+
+int NodeEditor::PortAttribute(const std::vector<int>& attributes, int port) {
+    return port >= 0 && static_cast<size_t>(port) < attributes.size() ? attributes[port] : attributes[0];
+}
+
+int NodeEditor::FindNodeByAINodeId(int aiNodeId) const {
+    if (aiToUiNodeDirty_) {
+        aiToUiNode_.clear();
+        for (const auto& node : nodes_.elements()) {
+            if (node.boundAINodeId != -1) aiToUiNode_[node.boundAINodeId] = node.id;
+        }
+        aiToUiNodeDirty_ = false;
+    }
+    auto it = aiToUiNode_.find(aiNodeId);
+    return it != aiToUiNode_.end() ? it->second : -1;
+}
+
 void NodeEditor::UpdateNodePosition(int nodeId, float posX, float posY) {
     auto iter = nodes_.find(nodeId);
     if (iter != nodes_.end()) {
@@ -390,9 +965,11 @@ std::vector<Link> NodeEditor::GetLinks() const {
 }
 
 void NodeEditor::ProcessDeferredOps() {
-    if (deferredOps_.empty()) {
+    PROFILE_ZONE("NodeEditor::ProcessDeferredOps");
+    if (deferredOps_.empty() && pendingConnections_.empty()) {
         return;
     }
+    aiToUiNodeDirty_ = true;
     try {
         for (const auto& op : deferredOps_) {
             if (op.type == DeferredNodeOp::ADD) {
@@ -454,8 +1031,8 @@ void NodeEditor::ProcessDeferredOps() {
                 }
 
                 if (fromNode && toNode && !fromNode->outputs.empty() && !toNode->inputs.empty()) {
-                    int startAttr = fromNode->outputs[0];
-                    int endAttr = toNode->inputs[0];
+                    int startAttr = PortAttribute(fromNode->outputs, conn.fromOutput);
+                    int endAttr = PortAttribute(toNode->inputs, conn.toInput);
                     AddLink(fromUiNodeId, toUiNodeId, startAttr, endAttr);
                 }
             }
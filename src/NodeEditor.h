@@ -10,6 +10,10 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "imnodes.h"
+#include "Profiler.h"
+#include "ExecutionLog.h"
+#include "CostModel.h"
+#include <unordered_map>
 
 template<typename ElementType>
 struct Span
@@ -200,6 +204,11 @@ public:
     void RemoveLink(int linkId);
     void UpdateNodePosition(int nodeId, float posX, float posY);
     void QueueConnectionForSync(int fromAiNodeId, int toAiNodeId, int fromOutput, int toInput);
+    void RenameNode(int nodeId, const std::string& name);
+    // Removes one link from startNode's output startPort to endNode's input
+    // endPort, given as model port indices; other links between them stay
+    void RemoveLink(int startNode, int startPort, int endNode, int endPort);
+    int FindNodeByAINodeId(int aiNodeId) const; // -1 if no UI node is bound to it
 
     // Element access
     UINode&       node(int node_id);
@@ -217,12 +226,21 @@ public:
 
     void SetNodeChangeCallback(std::function<void()> callback) { onNodeChange_ = callback; }
     void SetSyncRequestCallback(std::function<void()> callback) { onSyncRequest_ = callback; }
+    // Trace menu: save the last run, replay the saved run (speed <= 0 means virtual time)
+    void SetSaveTraceCallback(std::function<void()> callback) { onSaveTrace_ = callback; }
+    void SetReplayTraceCallback(std::function<void(double)> callback) { onReplayTrace_ = callback; }
+    // Precision menu: converts the whole model
+    void SetPrecisionCallback(std::function<void(Precision)> callback) { onSetPrecision_ = callback; }
     void UpdateExecutionProgress(int nodeId, float progress, const std::string& status) {
         executionProgress_[nodeId] = {progress, status};
     }
     void ClearExecutionProgress() {
         executionProgress_.clear();
     }
+    // Event log read by the timeline panel (owned by the model)
+    void SetExecutionLog(const ExecutionLog* log) { executionLog_ = log; }
+    // Predicted node costs keyed by AI node id, shown on nodes and in the roofline panel
+    void SetNodeCostSource(std::function<const NodeCostMap&()> source) { nodeCostSource_ = source; }
 
     GLFWwindow* GetWindow() { return window_; }
 
@@ -234,6 +252,11 @@ private:
     ImNodesContext* imnodes_context_;
     std::function<void()> onNodeChange_;
     std::function<void()> onSyncRequest_;
+    std::function<void()> onSaveTrace_;
+    std::function<void(double)> onReplayTrace_;
+    std::function<void(Precision)> onSetPrecision_;
+    float replaySpeed_ = 1.0f;
+    bool replayVirtualTime_ = false;
 
     // Track execution progress for each AI node ID
     struct ExecutionState {
@@ -260,5 +283,49 @@ private:
     std::vector<DeferredNodeOp> pendingOps_; // Operations queued during this frame
     std::vector<PendingConnection> pendingConnections_; // Connections to be made after nodes are created
     void ProcessDeferredOps();
+
+    void RenderGraph();
+
+    // Debug panels (toggled from the View menu)
+    bool showMemoryPanel_ = false;
+    void RenderMemoryPanel();
+
+    bool showProfilerPanel_ = false;
+    bool profilerPaused_ = false;
+    float profilerWindowMs_ = 250.0f;
+    int64_t profilerEndNs_ = 0;
+    std::vector<ProfileLane> profilerLanes_;
+    void RenderProfilerPanel();
+
+    // Per-worker Gantt view of the execution log. Lane indices are built
+    // incrementally from the log; span data itself is read in place.
+    bool showTimelinePanel_ = false;
+    const ExecutionLog* executionLog_ = nullptr;
+    struct TimelineState {
+        uint64_t runId = 0;
+        size_t indexed = 0;                           // Log entries sorted into lanes so far
+        std::vector<std::vector<uint32_t>> lanes;     // Span indices per worker, in time order
+        std::unordered_map<int, uint32_t> spanByNode; // AI node id -> span index
+        std::vector<bool> critical;                   // Per span, set once the run has finished
+        bool criticalComputed = false;
+        double viewStartNs = 0.0;
+        double viewEndNs = 1e9;
+        bool follow = true;
+    } timeline_;
+    bool showRooflinePanel_ = false;
+    std::function<const NodeCostMap&()> nodeCostSource_;
+    void RenderRooflinePanel();
+
+    int nodeToSelect_ = -1;  // UI node to select after the graph has been drawn
+    void UpdateTimelineIndex();
+    void RenderTimelinePanel();
+
+    // AI node id -> UI node id, rebuilt lazily after node adds/removes
+    mutable std::unordered_map<int, int> aiToUiNode_;
+    mutable bool aiToUiNodeDirty_ = true;
+
+    // Attribute of a model port index on one side of a UI node, which has a
+    // single attribute per side; ports past the end map to the first
+    static int PortAttribute(const std::vector<int>& attributes, int port);
 };
 
@@ -0,0 +1,419 @@
+#include "OperatorRegistry.h"
+#include "AIModel.h"
+#include "ExecutorService.h"
+#include "Kernels.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+
+namespace {
+
+using Node = ExecutionPlan::Node;
+
+int64_t ParamInt(const AINode& node, std::string_view key, int64_t fallback) {
+    for (const auto& param : node.parameters) {
+        if (param.first != key) continue;
+        int64_t value = 0;
+        auto result = std::from_chars(param.second.data(), param.second.data() + param.second.size(), value);
+        return result.ec == std::errc() && value >= 0 ? value : fallback;
+    }
+    return fallback;
+}
+
+std::string_view ParamText(const AINode& node, std::string_view key) {
+    for (const auto& param : node.parameters) {
+        if (param.first == key) return param.second;
+    }
+    return {};
+}
+
+// Conv2D: out_channels, kernel, stride, padding, groups
+
+double EstimateConv(const AIModel*, const AINode& node, const TensorShape& input, NodeCost& cost) {
+    const int64_t kernel = std::max<int64_t>(ParamInt(node, "kernel", 3), 1);
+    const int64_t stride = std::max<int64_t>(ParamInt(node, "stride", 1), 1);
+    const int64_t padding = ParamInt(node, "padding", kernel / 2);
+    const int64_t groups = std::clamp<int64_t>(ParamInt(node, "groups", 1), 1, input.c);
+    const int64_t outChannels = std::max<int64_t>(ParamInt(node, "out_channels", 64), 1);
+    cost.output = {input.n, outChannels,
+                   std::max<int64_t>((input.h + 2 * padding - kernel) / stride + 1, 1),
+                   std::max<int64_t>((input.w + 2 * padding - kernel) / stride + 1, 1)};
+    const double macsPerOutput = static_cast<double>(input.c / groups) * kernel * kernel;
+    cost.flops = 2.0 * static_cast<double>(cost.output.Elements()) * macsPerOutput;
+    return static_cast<double>(outChannels) * macsPerOutput + outChannels;
+}
+
+bool PrepareConv(const AIModel&, const AINode& source, Node& node, size_t& weightCount) {
+    const TensorShape& in = node.cost.input;
+    const TensorShape& out = node.cost.output;
+    node.conv.kernel = std::max<int64_t>(ParamInt(source, "kernel", 3), 1);
+    node.conv.stride = std::max<int64_t>(ParamInt(source, "stride", 1), 1);
+    node.conv.padding = ParamInt(source, "padding", node.conv.kernel / 2);
+    node.conv.groups = std::clamp<int64_t>(ParamInt(source, "groups", 1), 1, in.c);
+    if (in.c % node.conv.groups != 0 || out.c % node.conv.groups != 0) {
+        std::cerr << "ExecutionPlan::Compile: " << node.name << ": groups must divide both channel counts" << std::endl;
+        return false;
+    }
+    weightCount = static_cast<size_t>(out.c * (in.c / node.conv.groups) * node.conv.kernel * node.conv.kernel);
+    return true;
+}
+
+void RunConv(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    kernels::Conv2D(*inputs[0], node.weights.data(), node.bias.data(), node.conv, output);
+}
+
+// Groups of at most this many input channels run GroupedConv2D; beyond it
+// the per-group products are large enough for the generic kernels
+constexpr int64_t kGroupedMaxChannels = 8;
+
+void RunConvGrouped(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    kernels::GroupedConv2D(*inputs[0], node.weights.data(), node.bias.data(), node.conv, output);
+}
+
+bool IsDepthwise(const Node& node) {
+    return node.conv.groups > 1 && node.conv.groups == node.cost.input.c;
+}
+
+bool IsSmallGrouped(const Node& node) {
+    return node.conv.groups > 1 && node.cost.input.c / node.conv.groups <= kGroupedMaxChannels;
+}
+
+// A Conv2DFixed instantiation, used for nodes of exactly its shape
+template <int64_t K, int64_t Stride, int64_t Padding>
+OperatorDef::Kernel FixedConv(const char* name) {
+    return {name,
+            [](const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+                kernels::Conv2DFixed<K, Stride, Padding>(*inputs[0], node.weights.data(), node.bias.data(), node.conv, output);
+            },
+            [](const Node& node) { return node.conv.kernel == K && node.conv.stride == Stride && node.conv.padding == Padding; }};
+}
+
+void RunConvInt8(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    kernels::Conv2DInt8(*inputs[0], node.weightsInt8.data(), node.weightScales.data(), node.bias.data(), node.inputScale,
+                        node.conv, output);
+}
+
+// 16-bit weights widened into a per-thread buffer for the FP32 kernel;
+// convolutions reuse each weight many times, so this costs little
+void RunConvHalf(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    thread_local std::vector<float> weights;
+    weights.resize(node.weightsHalf.size());
+    kernels::Widen(node.weightsHalf.data(), node.precision, weights.size(), weights.data());
+    kernels::Conv2DIm2col(*inputs[0], weights.data(), node.bias.data(), node.conv, output);
+}
+
+void RunConvIm2col(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    kernels::Conv2DIm2col(*inputs[0], node.weights.data(), node.bias.data(), node.conv, output);
+}
+
+// Winograd F(MxM, 3x3): weights are transformed once per plan, then the
+// kernel is checked against Conv2D on the synthetic input. Its error grows
+// with M and with the input channel count, so nodes past the tolerance
+// keep a direct kernel.
+constexpr double kWinogradTolerance = 1e-3;   // Max |delta| over max |Conv2D output|
+
+template <int M>
+bool PrepareWinograd(Node& node) {
+    const TensorShape& in = node.cost.input;
+    const TensorShape& out = node.cost.output;
+    kernels::WinogradWeights<M>(node.weights.data(), out.c, in.c / node.conv.groups, node.packedWeights);
+
+    const Tensor input = ExecutionPlan::SyntheticInput({1, in.c, in.h, in.w});
+    Tensor expected({1, out.c, out.h, out.w});
+    Tensor actual({1, out.c, out.h, out.w});
+    kernels::Conv2D(input, node.weights.data(), node.bias.data(), node.conv, expected);
+    kernels::Conv2DWinograd<M>(input, node.packedWeights.data(), node.bias.data(), node.conv, actual);
+    double maxAbs = 0.0, maxDelta = 0.0;
+    for (size_t i = 0; i < expected.Size(); ++i) {
+        maxAbs = std::max(maxAbs, static_cast<double>(std::fabs(expected[i])));
+        maxDelta = std::max(maxDelta, static_cast<double>(std::fabs(actual[i] - expected[i])));
+    }
+    if (maxDelta > kWinogradTolerance * maxAbs) {
+        std::cerr << "ExecutionPlan::Compile: " << node.name << ": Winograd F(" << M << "x" << M << ", 3x3) error "
+                  << maxDelta / maxAbs << " exceeds " << kWinogradTolerance << ", using a direct kernel" << std::endl;
+        node.packedWeights = std::vector<float>();
+        return false;
+    }
+    return true;
+}
+
+template <int M>
+OperatorDef::Kernel WinogradConv(const char* name) {
+    return {name,
+            [](const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+                kernels::Conv2DWinograd<M>(*inputs[0], node.packedWeights.data(), node.bias.data(), node.conv, output);
+            },
+            [](const Node& node) { return node.conv.kernel == 3 && node.conv.stride == 1; }, Precision::FP32,
+            PrepareWinograd<M>};
+}
+
+// MaxPool / AvgPool: kernel, stride
+
+double EstimatePool(const AIModel*, const AINode& node, const TensorShape& input, NodeCost& cost) {
+    const int64_t kernel = std::max<int64_t>(ParamInt(node, "kernel", 2), 1);
+    const int64_t stride = std::max<int64_t>(ParamInt(node, "stride", kernel), 1);
+    cost.output = {input.n, input.c,
+                   std::max<int64_t>((input.h - kernel) / stride + 1, 1),
+                   std::max<int64_t>((input.w - kernel) / stride + 1, 1)};
+    cost.flops = static_cast<double>(cost.output.Elements()) * kernel * kernel;
+    return 0.0;
+}
+
+bool PreparePool(const AIModel&, const AINode& source, Node& node, size_t&) {
+    node.conv.kernel = std::max<int64_t>(ParamInt(source, "kernel", 2), 1);
+    node.conv.stride = std::max<int64_t>(ParamInt(source, "stride", node.conv.kernel), 1);
+    return true;
+}
+
+template <void (*Pool)(const Tensor&, int64_t, int64_t, Tensor&)>
+void RunPool(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    Pool(*inputs[0], node.conv.kernel, node.conv.stride, output);
+}
+
+// Dense: units
+
+double EstimateDense(const AIModel*, const AINode& node, const TensorShape& input, NodeCost& cost) {
+    const int64_t features = input.c * input.h * input.w;
+    const int64_t units = std::max<int64_t>(ParamInt(node, "units", 1000), 1);
+    cost.output = {input.n, units, 1, 1};
+    cost.flops = 2.0 * static_cast<double>(input.n) * features * units;
+    return static_cast<double>(features) * units + units;
+}
+
+bool PrepareDense(const AIModel&, const AINode&, Node& node, size_t& weightCount) {
+    const TensorShape& in = node.cost.input;
+    weightCount = static_cast<size_t>(in.c * in.h * in.w * node.cost.output.c);
+    return true;
+}
+
+void RunDense(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    kernels::Dense(*inputs[0], node.weights.data(), node.bias.data(), output);
+}
+
+void RunDenseInt8(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    kernels::DenseInt8(*inputs[0], node.weightsInt8.data(), node.weightScales.data(), node.bias.data(), node.inputScale, output);
+}
+
+void RunDenseHalf(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    kernels::DenseHalf(*inputs[0], node.weightsHalf.data(), node.precision, node.bias.data(), output);
+}
+
+void RunDenseRows4(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    kernels::DenseRows4(*inputs[0], node.weights.data(), node.bias.data(), output);
+}
+
+// Attention: heads, causal (0 or 1), cache_length (for the estimate). The
+// first input holds queries, keys and values along C; a second input, if
+// any, is the KV cache and is ignored unless shaped [n, 2, past, width].
+
+// Work below which attention runs on the node's worker alone
+constexpr double kParallelAttentionFlops = 1 << 24;
+
+double EstimateAttention(const AIModel*, const AINode& node, const TensorShape& input, NodeCost& cost) {
+    const int64_t past = ParamInt(node, "cache_length", 0);
+    const bool causal = ParamInt(node, "causal", 1) != 0;
+    cost.output = {input.n, 1, input.h, input.w};
+    // Scores and weighted values; causally each query sees half the new keys
+    const double keys = static_cast<double>(past) + (causal ? (input.h + 1) / 2.0 : static_cast<double>(input.h));
+    cost.flops = 4.0 * static_cast<double>(input.n * input.h * input.w) * keys;
+    const double cacheElements = static_cast<double>(input.n) * 2.0 * past * input.w;
+    cost.bytes = sizeof(float) * cacheElements;
+    return 0.0;
+}
+
+bool PrepareAttention(const AIModel&, const AINode& source, Node& node, size_t&) {
+    node.attention.heads = std::max<int64_t>(ParamInt(source, "heads", 8), 1);
+    node.attention.causal = ParamInt(source, "causal", 1) != 0;
+    const TensorShape& in = node.cost.input;
+    if (in.c != 3 || in.w % node.attention.heads != 0) {
+        std::cerr << "ExecutionPlan::Compile: " << node.name << ": Attention reads [n, 3, positions, width] with width a multiple of "
+                  << node.attention.heads << " heads, not " << in.n << "x" << in.c << "x" << in.h << "x" << in.w << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void RunAttention(const Node& node, const Tensor* const* inputs, int inputCount, Tensor& output) {
+    const Tensor& qkv = *inputs[0];
+    const Tensor* cache = inputCount > 1 ? inputs[1] : nullptr;
+    if (cache && (cache->shape.n != qkv.shape.n || cache->shape.c != 2 || cache->shape.w != qkv.shape.w)) cache = nullptr;
+    const int64_t tasks = kernels::AttentionTasks(qkv.shape, node.attention);
+    const ExecutorService::TaskContext context = ExecutorService::Current();
+    if (!context.executor || tasks < 2 || node.cost.flops < kParallelAttentionFlops) {
+        kernels::Attention(qkv, cache, node.attention, output, 0, tasks);
+        return;
+    }
+    // Heads and query tiles are independent; tasks of the running model's
+    // client help, under its weight and concurrency limit
+    ExecutorService& pool = *context.executor;
+    pool.ParallelFor(context.client, tasks, pool.NumWorkers() - 1,
+                     [&](int64_t task) { kernels::Attention(qkv, cache, node.attention, output, task, task + 1); });
+}
+
+// Elementwise (every unknown type): sum of the inputs, then ReLU
+
+double EstimateElementwise(const AIModel*, const AINode&, const TensorShape& input, NodeCost& cost) {
+    cost.output = input;
+    cost.flops = static_cast<double>(input.Elements());
+    return 0.0;
+}
+
+bool PrepareElementwise(const AIModel&, const AINode&, Node&, size_t&) {
+    return true;
+}
+
+void RunElementwise(const Node&, const Tensor* const* inputs, int inputCount, Tensor& output) {
+    kernels::AddRelu(inputs, inputCount, output);
+}
+
+// Call / Loop: subgraph, iterations (Loop)
+
+int64_t Passes(const AINode& node) {
+    return node.type == "Loop" ? std::max<int64_t>(ParamInt(node, "iterations", 1), 1) : 1;
+}
+
+// One pass of the compiled body per iteration, scaled to the batch the node
+// runs at; without the body the node estimates as elementwise
+double EstimateSubgraph(const AIModel* model, const AINode& node, const TensorShape& input, NodeCost& cost) {
+    auto body = model ? model->GetSubgraph(ParamText(node, "subgraph")) : nullptr;
+    if (!body) return EstimateElementwise(model, node, input, cost);
+    const TensorShape& bodyInput = (*body)[body->EntryNodes()[0]].cost.input;
+    const double scale = static_cast<double>(Passes(node)) * input.n / std::max<int64_t>(bodyInput.n, 1);
+    for (size_t i = 0; i < body->Size(); ++i) {
+        const NodeCost& step = (*body)[i].cost;
+        cost.flops += step.flops * scale;
+        cost.bytes += step.bytes * scale;
+        if ((*body)[i].successorCount == 0) cost.output = {input.n, step.output.c, step.output.h, step.output.w};
+    }
+    return 0.0;
+}
+
+bool PrepareSubgraph(const AIModel& model, const AINode& source, Node& node, size_t&) {
+    const TensorShape& in = node.cost.input;
+    const TensorShape& out = node.cost.output;
+    node.body = model.GetSubgraph(ParamText(source, "subgraph"));
+    node.iterations = Passes(source);
+    if (!node.body) {
+        std::cerr << "ExecutionPlan::Compile: " << node.name << " calls undefined subgraph '"
+                  << ParamText(source, "subgraph") << "'" << std::endl;
+        return false;
+    }
+    const TensorShape& bodyIn = (*node.body)[node.body->EntryNodes()[0]].cost.input;
+    if (bodyIn.c != in.c || bodyIn.h != in.h || bodyIn.w != in.w) {
+        std::cerr << "ExecutionPlan::Compile: " << node.name << ": input does not fit the subgraph" << std::endl;
+        return false;
+    }
+    if (source.type == "Loop" && (out.c != in.c || out.h != in.h || out.w != in.w)) {
+        std::cerr << "ExecutionPlan::Compile: " << node.name << ": loop body must keep the shape of its state" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Buffers of one body plan on one thread, kept across node executions and
+// runs so re-entering a subgraph allocates nothing
+struct SubgraphScratch {
+    std::weak_ptr<const ExecutionPlan> body;
+    ExecutionPlan::InlineState state;
+    Tensor carried[2];
+};
+
+SubgraphScratch& ScratchFor(const std::shared_ptr<const ExecutionPlan>& body) {
+    thread_local std::unordered_map<const ExecutionPlan*, SubgraphScratch> scratch;
+    auto it = scratch.find(body.get());
+    if (it != scratch.end() && !it->second.body.expired()) return it->second;
+    // A new plan: first drop the buffers of plans that are gone (a running
+    // body is alive, so nested subgraphs keep theirs)
+    for (auto entry = scratch.begin(); entry != scratch.end();) {
+        entry = entry->second.body.expired() ? scratch.erase(entry) : std::next(entry);
+    }
+    SubgraphScratch& entry = scratch[body.get()];
+    entry.body = body;
+    return entry;
+}
+
+void RunSubgraph(const Node& node, const Tensor* const* inputs, int, Tensor& output) {
+    // The carried state alternates between two buffers; the last pass writes
+    // the output
+    SubgraphScratch& scratch = ScratchFor(node.body);
+    const Tensor* current = inputs[0];
+    for (int64_t pass = 0; pass < node.iterations; ++pass) {
+        Tensor* target = &output;
+        if (pass + 1 < node.iterations) {
+            target = &scratch.carried[pass % 2];
+            if (target->shape != output.shape || target->Empty()) *target = Tensor(output.shape);
+        }
+        node.body->RunInline(*current, scratch.state, *target);
+        current = target;
+    }
+}
+
+using Registry = std::map<std::string, OperatorDef, std::less<>>;
+
+Registry& Definitions() {
+    static Registry registry = []() {
+        Registry builtins;
+        auto add = [&builtins](OperatorDef def) { builtins[def.type] = std::move(def); };
+        add({"Conv2D", EstimateConv, PrepareConv,
+             {{"conv2d_depthwise", RunConvGrouped, IsDepthwise}, {"conv2d_grouped", RunConvGrouped, IsSmallGrouped},
+              FixedConv<3, 1, 1>("conv2d_3x3s1"), FixedConv<1, 1, 0>("conv2d_1x1"),
+              {"conv2d_direct", RunConv, nullptr}, {"conv2d_im2col", RunConvIm2col, nullptr},
+              WinogradConv<2>("conv2d_winograd2"), WinogradConv<4>("conv2d_winograd4"),
+              {"conv2d_int8", RunConvInt8, nullptr, Precision::INT8},
+              {"conv2d_fp16", RunConvHalf, nullptr, Precision::FP16}, {"conv2d_bf16", RunConvHalf, nullptr, Precision::BF16}}});
+        add({"MaxPool", EstimatePool, PreparePool, {{"maxpool", RunPool<kernels::MaxPool>, nullptr}}});
+        add({"AvgPool", EstimatePool, PreparePool, {{"avgpool", RunPool<kernels::AvgPool>, nullptr}}});
+        add({"Dense", EstimateDense, PrepareDense,
+             {{"dense_dot", RunDense, nullptr}, {"dense_rows4", RunDenseRows4, nullptr},
+              {"dense_int8", RunDenseInt8, nullptr, Precision::INT8},
+              {"dense_fp16", RunDenseHalf, nullptr, Precision::FP16}, {"dense_bf16", RunDenseHalf, nullptr, Precision::BF16}}});
+        add({"Attention", EstimateAttention, PrepareAttention, {{"attention_flash", RunAttention, nullptr}}});
+        add({"Elementwise", EstimateElementwise, PrepareElementwise, {{"add_relu", RunElementwise, nullptr}}, true});
+        add({"Call", EstimateSubgraph, PrepareSubgraph, {{"subgraph", RunSubgraph, nullptr}}});
+        add({"Loop", EstimateSubgraph, PrepareSubgraph, {{"subgraph", RunSubgraph, nullptr}}});
+        return builtins;
+    }();
+    return registry;
+}
+
+} // namespace
+
+void OperatorRegistry::Register(OperatorDef def) {
+    Registry& registry = Definitions();
+    std::string type = def.type;
+    registry[type] = std::move(def);
+}
+
+const OperatorDef& OperatorRegistry::Find(std::string_view type) {
+    const Registry& registry = Definitions();
+    auto it = registry.find(type);
+    return it != registry.end() ? it->second : registry.find("Elementwise")->second;
+}
+
+const OperatorDef::Kernel* OperatorRegistry::SelectKernel(const OperatorDef& def, const ExecutionPlan::Node& node) {
+    for (const auto& kernel : def.kernels) {
+        if (Applies(kernel, node)) return &kernel;
+    }
+    return nullptr;
+}
+
+bool OperatorRegistry::Applies(const OperatorDef::Kernel& kernel, const ExecutionPlan::Node& node) {
+    return kernel.precision == node.precision && (!kernel.applies || kernel.applies(node));
+}
+
+const OperatorDef::Kernel* OperatorRegistry::FindKernel(const OperatorDef& def, std::string_view name) {
+    for (const auto& kernel : def.kernels) {
+        if (name == kernel.name) return &kernel;
+    }
+    return nullptr;
+}
+
+bool OperatorRegistry::Supports(const OperatorDef& def, Precision precision) {
+    for (const auto& kernel : def.kernels) {
+        if (kernel.precision == precision) return true;
+    }
+    return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CostModel.h"
+#include "ExecutionPlan.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct AINode;
+class AIModel;
+
+// Everything the engine knows about one node type: shape inference and
+// cost for the cost model, parameter handling for plan compilation, and the
+// kernels that can run it.
+//
+// Plan compilation resolves every node to its definition and to one kernel
+// function pointer, so runs dispatch without looking at type names. A new
+// op only registers here; the cost model, planner and executor are generic.
+struct OperatorDef {
+    // Fills cost.output and cost.flops from the input shape and the node's
+    // parameters (cost.bytes may hold traffic beyond inputs, weights and
+    // output) and returns the weight count. model is null outside a model.
+    using EstimateFn = double (*)(const AIModel* model, const AINode& node, const TensorShape& input, NodeCost& cost);
+    // Reads the node's parameters into the plan node (whose cost is already
+    // set) and sets how many weights to materialize; false, after reporting
+    // why, if the node cannot run
+    using PrepareFn = bool (*)(const AIModel& model, const AINode& source, ExecutionPlan::Node& node, size_t& weightCount);
+
+    struct Kernel {
+        const char* name;
+        ExecutionPlan::KernelFn run;
+        bool (*applies)(const ExecutionPlan::Node& node);   // nullptr: any node
+        Precision precision = Precision::FP32;              // Only runs nodes of this precision
+        // Builds the kernel's own data, such as node.packedWeights, once the
+        // kernel is chosen; false, after reporting why, if the node should
+        // run another kernel after all. nullptr: nothing to build.
+        bool (*prepare)(ExecutionPlan::Node& node) = nullptr;
+    };
+
+    std::string type;
+    EstimateFn estimate = nullptr;
+    PrepareFn prepare = nullptr;
+    // Most specialized first; the first that applies is used unless a tuner
+    // or the node's "impl" parameter (a kernel name) picks another
+    std::vector<Kernel> kernels;
+    bool sumsInputs = false;        // Reads every input, all of one size, instead of the first
+};
+
+class OperatorRegistry {
+public:
+    // Adds or replaces def.type; register before compiling plans that use it
+    static void Register(OperatorDef def);
+    // Definition of a node type; unknown types are elementwise
+    static const OperatorDef& Find(std::string_view type);
+    // First kernel of def that applies to the prepared node, at its precision
+    static const OperatorDef::Kernel* SelectKernel(const OperatorDef& def, const ExecutionPlan::Node& node);
+    static bool Applies(const OperatorDef::Kernel& kernel, const ExecutionPlan::Node& node);
+    // Kernel of def with this name, applicable or not; nullptr if none
+    static const OperatorDef::Kernel* FindKernel(const OperatorDef& def, std::string_view name);
+    // Some kernel of def runs at precision; nodes asking for another run in FP32
+    static bool Supports(const OperatorDef& def, Precision precision);
+};
@@ -0,0 +1,246 @@
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#define AISHOW_PROFILER_HAS_TSC 1
+#endif
+
+namespace {
+
+// One ring-buffer entry. Collect reads slots while their owner may be
+// rewriting them, so every field is atomic and the slot is a seqlock:
+// sequence is 0 while the owner writes and index + 1 once event 'index' is
+// complete. Relaxed atomics compile to plain moves, so the owner pays
+// nothing extra on x86.
+struct EventSlot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> begin{0};
+    std::atomic<uint64_t> end{0};
+    std::atomic<uint32_t> depth{0};
+};
+
+struct ThreadBuffer {
+    int lane = 0;
+    std::string threadName;                       // Guarded by g_registryMutex
+    std::atomic<uint64_t> written{0};             // Total events ever written
+    std::unique_ptr<EventSlot[]> events{new EventSlot[Profiler::kEventsPerThread]};
+    uint32_t depth = 0;                           // Owner thread only
+};
+
+// Event 'index' of a buffer, or false if the owner has overwritten its slot
+// (or is doing so)
+bool ReadEvent(const ThreadBuffer& buffer, uint64_t index, ProfileEvent& event) {
+    const EventSlot& slot = buffer.events[index % Profiler::kEventsPerThread];
+    const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before != index + 1) return false;
+    event = {slot.name.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed),
+             slot.end.load(std::memory_order_relaxed), slot.depth.load(std::memory_order_relaxed)};
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == before;
+}
+
+std::mutex g_registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+std::vector<ThreadBuffer*> g_freeBuffers;
+
+// Buffers are recycled when their thread exits so that short-lived worker
+// threads (one set per execution run) do not grow the registry without bound
+struct ThreadSlot {
+    ThreadBuffer* buffer = nullptr;
+    ~ThreadSlot() {
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_freeBuffers.push_back(buffer);
+    }
+};
+thread_local ThreadSlot t_slot;
+
+ThreadBuffer& LocalBuffer() {
+    if (!t_slot.buffer) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (!g_freeBuffers.empty()) {
+            t_slot.buffer = g_freeBuffers.back();
+            g_freeBuffers.pop_back();
+            t_slot.buffer->depth = 0;
+        } else {
+            // Profiler storage is not charged to whatever subsystem the thread is in
+            MemoryScope memScope(MemTag::Other);
+            g_buffers.push_back(std::make_unique<ThreadBuffer>());
+            t_slot.buffer = g_buffers.back().get();
+            t_slot.buffer->lane = static_cast<int>(g_buffers.size()) - 1;
+        }
+        t_slot.buffer->threadName = "thread " + std::to_string(t_slot.buffer->lane);
+    }
+    return *t_slot.buffer;
+}
+
+struct ClockBase {
+    bool useTsc = false;
+    uint64_t baseTicks = 0;
+    std::chrono::steady_clock::time_point baseTime;
+};
+
+bool HasInvariantTsc() {
+#if defined(AISHOW_PROFILER_HAS_TSC) && !defined(_MSC_VER)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+uint64_t ReadTsc() {
+#ifdef AISHOW_PROFILER_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+ClockBase InitClock() {
+    ClockBase clock;
+    clock.useTsc = HasInvariantTsc();
+    clock.baseTime = std::chrono::steady_clock::now();
+    clock.baseTicks = clock.useTsc ? ReadTsc() : 0;
+    return clock;
+}
+
+const ClockBase g_clock = InitClock();
+
+// TSC frequency is derived from the time elapsed since startup at read time,
+// which avoids a calibration sleep and gets more precise the longer we run
+double NsPerTick() {
+    if (!g_clock.useTsc) return 1.0;
+    const uint64_t ticks = ReadTsc() - g_clock.baseTicks;
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_clock.baseTime).count();
+    return ticks > 0 ? static_cast<double>(ns) / static_cast<double>(ticks) : 1.0;
+}
+
+void WriteJsonString(std::ofstream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+bool Profiler::Enabled() {
+#ifdef AISHOW_ENABLE_PROFILER
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t Profiler::Now() {
+    if (g_clock.useTsc) return ReadTsc();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_clock.baseTime).count());
+}
+
+int64_t Profiler::TicksToNs(uint64_t ticks) {
+    if (!g_clock.useTsc) return static_cast<int64_t>(ticks);
+    return static_cast<int64_t>(static_cast<double>(ticks - g_clock.baseTicks) * NsPerTick());
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+    ThreadBuffer& buffer = LocalBuffer();
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    buffer.threadName = name;
+}
+
+uint32_t Profiler::Enter() {
+    return LocalBuffer().depth++;
+}
+
+void Profiler::Leave(const char* name, uint64_t begin, uint32_t depth) {
+    const uint64_t end = Now();
+    ThreadBuffer& buffer = *t_slot.buffer;
+    buffer.depth = depth;
+    const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    EventSlot& slot = buffer.events[index % kEventsPerThread];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.begin.store(begin, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.depth.store(depth, std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+std::vector<ProfileLane> Profiler::Collect(int64_t sinceNs) {
+    const double nsPerTick = NsPerTick();
+    auto toNs = [&](uint64_t ticks) -> int64_t {
+        if (!g_clock.useTsc) return static_cast<int64_t>(ticks);
+        return static_cast<int64_t>(static_cast<double>(ticks - g_clock.baseTicks) * nsPerTick);
+    };
+
+    std::vector<ProfileLane> lanes;
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    for (const auto& buffer : g_buffers) {
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        if (written == 0) continue;
+
+        ProfileLane lane;
+        lane.lane = buffer->lane;
+        lane.threadName = buffer->threadName;
+        // Events are stored in end-time order: walk back from the newest one
+        // until the window starts so the panel only copies what it shows. A
+        // slot the owner has reused since means every older one is gone too.
+        const uint64_t first = written > kEventsPerThread ? written - kEventsPerThread : 0;
+        for (uint64_t index = written; index > first; --index) {
+            ProfileEvent event;
+            if (!ReadEvent(*buffer, index - 1, event)) break;
+            const int64_t endNs = toNs(event.end);
+            if (endNs < sinceNs) break;
+            lane.zones.push_back({event.name, toNs(event.begin), endNs, event.depth});
+        }
+        std::reverse(lane.zones.begin(), lane.zones.end());
+
+        if (!lane.zones.empty()) lanes.push_back(std::move(lane));
+    }
+    return lanes;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out.is_open()) return false;
+
+    const auto lanes = Collect(0);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& lane : lanes) {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << lane.lane
+            << ",\"args\":{\"name\":";
+        WriteJsonString(out, lane.threadName);
+        out << "}}";
+        first = false;
+        for (const auto& zone : lane.zones) {
+            out << ",\n{\"name\":";
+            WriteJsonString(out, zone.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << lane.lane
+                << ",\"ts\":" << zone.beginNs / 1000.0
+                << ",\"dur\":" << (zone.endNs - zone.beginNs) / 1000.0 << "}";
+        }
+    }
+    out << "\n]}\n";
+    return out.good();
+}
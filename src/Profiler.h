@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scoped-zone profiler.
+//
+// PROFILE_ZONE("name") records the enclosing scope's begin/end timestamps into
+// a ring buffer owned by the calling thread, so recording takes no locks. Zone
+// names must be string literals (or otherwise outlive the profiler). Building
+// without AISHOW_ENABLE_PROFILER removes every zone at compile time.
+//
+// Timestamps come from rdtsc on x86-64 CPUs with an invariant TSC and from
+// std::chrono::steady_clock elsewhere; they are converted to nanoseconds only
+// when events are read.
+
+#ifdef AISHOW_ENABLE_PROFILER
+#define AISHOW_PROFILE_CONCAT_INNER(a, b) a##b
+#define AISHOW_PROFILE_CONCAT(a, b) AISHOW_PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone AISHOW_PROFILE_CONCAT(profileZone_, __COUNTER__)(name)
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t begin;  // Raw ticks
+    uint64_t end;
+    uint32_t depth;  // Nesting level within the thread
+};
+
+// Events read back from one thread's buffer, converted to nanoseconds since
+// the profiler started
+struct ProfileLane {
+    int lane;
+    std::string threadName;
+    struct Zone {
+        const char* name;
+        int64_t beginNs;
+        int64_t endNs;
+        uint32_t depth;
+    };
+    std::vector<Zone> zones;   // Ordered by end time
+};
+
+class Profiler {
+public:
+    static constexpr size_t kEventsPerThread = 1 << 16;
+
+    static bool Enabled();
+    static uint64_t Now();
+    static int64_t TicksToNs(uint64_t ticks);
+    static int64_t NowNs() { return TicksToNs(Now()); }
+
+    static void SetThreadName(const std::string& name);
+
+    // Copy the zones that ended within [sinceNs, now] from every thread buffer
+    static std::vector<ProfileLane> Collect(int64_t sinceNs = 0);
+
+    // Write every buffered zone as Chrome trace-event JSON (chrome://tracing, Perfetto)
+    static bool ExportChromeTrace(const std::string& filename);
+
+    // Called by ProfileZone
+    static uint32_t Enter();
+    static void Leave(const char* name, uint64_t begin, uint32_t depth);
+};
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name)
+        : name_(name), depth_(Profiler::Enter()), begin_(Profiler::Now()) {}
+    ~ProfileZone() { Profiler::Leave(name_, begin_, depth_); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name_;
+    uint32_t depth_;
+    uint64_t begin_;
+};
@@ -0,0 +1,196 @@
+#include "Quantizer.h"
+#include "OperatorRegistry.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// A node's own fp16/bf16 precision is not quantization and stays
+bool IsQuantizationParam(const std::pair<std::string_view, std::string_view>& param) {
+    Precision precision;
+    return param.first == "input_scale" ||
+           (param.first == "precision" && ParsePrecision(param.second, precision) && precision == Precision::INT8);
+}
+
+// Every node output, per calibration batch
+using Outputs = std::vector<std::vector<Tensor>>;
+
+Outputs RunEach(const ExecutionPlan& plan, const std::vector<RunInputs>& batches) {
+    Outputs outputs(batches.size());
+    for (size_t b = 0; b < batches.size(); ++b) plan.RunAll(batches[b], outputs[b]);
+    return outputs;
+}
+
+// Best of a few passes over every batch, on this thread
+double TimeEach(const ExecutionPlan& plan, const std::vector<RunInputs>& batches) {
+    std::vector<Tensor> tensors;
+    double best = 0.0;
+    for (int rep = 0; rep < 3; ++rep) {
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& batch : batches) plan.RunAll(batch, tensors);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = rep == 0 ? seconds : std::min(best, seconds);
+    }
+    return best;
+}
+
+struct ErrorSums {
+    double maxAbs = 0.0;
+    double squaredError = 0.0;
+    double squaredReference = 0.0;
+
+    void Add(const Tensor& reference, const Tensor& actual) {
+        if (reference.Size() != actual.Size()) return;
+        for (size_t i = 0; i < reference.Size(); ++i) {
+            const double delta = static_cast<double>(actual[i]) - reference[i];
+            maxAbs = std::max(maxAbs, std::fabs(delta));
+            squaredError += delta * delta;
+            squaredReference += static_cast<double>(reference[i]) * reference[i];
+        }
+    }
+    double Relative() const { return squaredReference > 0.0 ? std::sqrt(squaredError / squaredReference) : 0.0; }
+};
+
+} // namespace
+
+bool Quantizer::Quantize(AIModel& model, const std::vector<RunInputs>& calibration, QuantizationReport* report) {
+    PROFILE_ZONE("Quantizer::Quantize");
+    Dequantize(model);
+    std::shared_ptr<const ExecutionPlan> reference = model.GetPlan();
+    if (!reference) return false;
+    const ExecutionPlan& fp32 = *reference;
+    const std::vector<RunInputs> batches = calibration.empty() ? std::vector<RunInputs>(1) : calibration;
+
+    // Largest magnitude entering each quantizable node. Inputs of branches
+    // not taken are empty and add nothing.
+    std::vector<bool> quantizable(fp32.Size(), false);
+    std::vector<float> maxAbs(fp32.Size(), 0.0f);
+    for (size_t i = 0; i < fp32.Size(); ++i) {
+        quantizable[i] = OperatorRegistry::Supports(*fp32[i].op, Precision::INT8);
+    }
+    const Outputs fp32Outputs = RunEach(fp32, batches);
+    for (size_t b = 0; b < batches.size(); ++b) {
+        for (size_t i = 0; i < fp32.Size(); ++i) {
+            if (!quantizable[i]) continue;
+            const ExecutionPlan::Node& node = fp32[i];
+            std::vector<const Tensor*> inputs;
+            Tensor synthetic;
+            if (node.predecessorCount == 0) {
+                auto bound = batches[b].find(node.id);
+                if (bound == batches[b].end()) {
+                    synthetic = ExecutionPlan::SyntheticInput(node.cost.input);
+                    inputs.push_back(&synthetic);
+                } else {
+                    inputs.push_back(&bound->second);
+                }
+            }
+            const uint32_t* preds = fp32.Predecessors(node);
+            if (node.depthwise) {
+                // A fused pointwise node reads the depthwise output it computes itself
+                inputs.push_back(&fp32Outputs[b][static_cast<size_t>(fp32.IndexOf(node.depthwise->id))]);
+            } else {
+                for (uint32_t p = 0; p < node.predecessorCount; ++p) inputs.push_back(&fp32Outputs[b][preds[p]]);
+            }
+            for (const Tensor* input : inputs) {
+                for (float value : *input) maxAbs[i] = std::max(maxAbs[i], std::fabs(value));
+            }
+        }
+    }
+
+    // Rewrite the nodes; the scales strings must outlive UpdateNode, which
+    // interns them
+    model.BeginBatch();
+    for (size_t i = 0; i < fp32.Size(); ++i) {
+        if (!quantizable[i]) continue;
+        for (const AINode& current : model.GetNodes()) {
+            if (current.id != fp32[i].id) continue;
+            // A precision left after Dequantize is the node's own choice and wins
+            const bool ownPrecision = std::any_of(current.parameters.begin(), current.parameters.end(),
+                                                  [](const auto& param) { return param.first == "precision"; });
+            if (ownPrecision) break;
+            AINode updated = current;
+            std::ostringstream scale;
+            scale << std::setprecision(9) << maxAbs[i] / 127.0f;
+            const std::string scaleText = scale.str();
+            updated.parameters.emplace_back("precision", PrecisionName(Precision::INT8));
+            if (maxAbs[i] > 0.0f) updated.parameters.emplace_back("input_scale", scaleText);
+            model.UpdateNode(updated);
+            break;
+        }
+    }
+    model.EndBatch();
+
+    std::shared_ptr<const ExecutionPlan> quantized = model.GetPlan();
+    if (!quantized) return false;
+    if (!report) return true;
+
+    // Plan indices follow the same order in both plans
+    *report = QuantizationReport();
+    const Outputs int8Outputs = RunEach(*quantized, batches);
+    ErrorSums sinks;
+    size_t items = 0, agreeing = 0;
+    for (size_t i = 0; i < quantized->Size(); ++i) {
+        const ExecutionPlan::Node& node = (*quantized)[i];
+        ErrorSums sums;
+        for (size_t b = 0; b < batches.size(); ++b) sums.Add(fp32Outputs[b][i], int8Outputs[b][i]);
+        if (node.precision == Precision::INT8) {
+            report->nodes.push_back({node.id, node.name, node.type, node.inputScale, sums.maxAbs, sums.Relative()});
+        }
+        if (node.successorCount > 0) continue;
+        for (size_t b = 0; b < batches.size(); ++b) {
+            const Tensor& expected = fp32Outputs[b][i];
+            const Tensor& actual = int8Outputs[b][i];
+            sinks.Add(expected, actual);
+            if (expected.Empty() || expected.Size() != actual.Size()) continue;
+            const size_t perItem = expected.Size() / static_cast<size_t>(expected.shape.n);
+            for (size_t item = 0; item < expected.Size(); item += perItem, ++items) {
+                const auto want = std::max_element(expected.begin() + item, expected.begin() + item + perItem) - expected.begin();
+                const auto got = std::max_element(actual.begin() + item, actual.begin() + item + perItem) - actual.begin();
+                agreeing += want == got ? 1 : 0;
+            }
+        }
+    }
+    report->outputMaxAbsError = sinks.maxAbs;
+    report->outputRelativeError = sinks.Relative();
+    report->top1Agreement = items ? static_cast<double>(agreeing) / items : 1.0;
+    report->fp32Seconds = TimeEach(fp32, batches);
+    report->quantizedSeconds = TimeEach(*quantized, batches);
+    return true;
+}
+
+void Quantizer::Dequantize(AIModel& model) {
+    std::vector<AINode> updates;
+    for (const AINode& node : model.GetNodes()) {
+        if (std::none_of(node.parameters.begin(), node.parameters.end(),
+                         [](const auto& param) { return IsQuantizationParam(param); })) {
+            continue;
+        }
+        AINode updated = node;
+        updated.parameters.erase(std::remove_if(updated.parameters.begin(), updated.parameters.end(),
+                                                [](const auto& param) { return IsQuantizationParam(param); }),
+                                 updated.parameters.end());
+        updates.push_back(std::move(updated));
+    }
+    model.BeginBatch();
+    for (const AINode& node : updates) model.UpdateNode(node);
+    model.EndBatch();
+}
+
+std::string QuantizationReport::ToText() const {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(3);
+    text << "INT8 quantization: " << nodes.size() << " nodes, " << fp32Seconds * 1e3 << " ms -> "
+         << quantizedSeconds * 1e3 << " ms (" << std::setprecision(2) << Speedup() << "x)\n";
+    text << std::setprecision(4) << "  outputs: max |delta| " << outputMaxAbsError << ", relative "
+         << outputRelativeError * 100.0 << "%, top-1 agreement " << top1Agreement * 100.0 << "%\n";
+    for (const NodeDelta& node : nodes) {
+        text << "  " << node.name << " (" << node.type << "): input_scale " << std::setprecision(6) << node.inputScale
+             << std::setprecision(4) << ", max |delta| " << node.maxAbsError << ", relative "
+             << node.relativeError * 100.0 << "%\n";
+    }
+    return text.str();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "AIModel.h"
+#include <string>
+#include <vector>
+
+// Accuracy and speed of a quantized graph against the same graph in FP32,
+// over the calibration inputs
+struct QuantizationReport {
+    struct NodeDelta {
+        int nodeId;
+        std::string name;
+        std::string type;
+        float inputScale;            // Calibrated real value per int8 step; 0 if never reached
+        double maxAbsError;          // Largest |quantized - FP32| in the node's output
+        double relativeError;        // RMS error over RMS of the FP32 output
+    };
+    std::vector<NodeDelta> nodes;    // Quantized nodes, in plan order
+    double outputMaxAbsError = 0.0;  // Over every sink output
+    double outputRelativeError = 0.0;
+    double top1Agreement = 1.0;      // Share of sink batch items whose largest value stays in place
+    double fp32Seconds = 0.0;        // One pass over the inputs on one thread, best of several
+    double quantizedSeconds = 0.0;
+
+    double Speedup() const { return quantizedSeconds > 0.0 ? fp32Seconds / quantizedSeconds : 0.0; }
+    std::string ToText() const;
+};
+
+// Post-training INT8 quantization.
+//
+// Runs the FP32 graph over calibration inputs, records the largest magnitude
+// entering each node whose op has INT8 kernels (Conv2D and Dense), and sets
+// precision=int8 and input_scale=max/127 on those nodes, except nodes that
+// set their own precision (e.g. fp16), which keep it. Weights are
+// quantized per output channel when the plan compiles. The edits are node
+// parameters, so they are saved with the model and the editor shows each
+// node's precision.
+class Quantizer {
+public:
+    // calibration: one RunInputs per calibration batch; empty runs the
+    // synthetic input once. Earlier quantization is undone first. Returns
+    // false if the graph cannot run. report, if given, compares both
+    // precisions over the calibration inputs.
+    static bool Quantize(AIModel& model, const std::vector<RunInputs>& calibration, QuantizationReport* report = nullptr);
+    // Removes input_scale and int8 precision, so quantized nodes run in FP32
+    // again; fp16/bf16 precision set on a node stays
+    static void Dequantize(AIModel& model);
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Tensor.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Caller-owned buffers for one run, bound to graph ports.
+//
+// Inputs feed entry nodes; outputs receive the result of any node (usually
+// a sink). A port is named by id or as "node" / "node:port" using the model's
+// node and port names; a bare node name means its first port. Buffers hold
+// float32 NCHW data and must stay valid until the run is done. Buffers
+// aligned for float are used in place: inputs are read without a copy and
+// kernels write outputs straight into the caller's memory.
+//
+// Outputs are pulled: once any output is bound or requested, the run only
+// executes the nodes those outputs depend on.
+class RunBindings {
+public:
+    struct Binding {
+        int portId = -1;              // Used when name is empty
+        std::string name;
+        TensorShape shape;            // Inputs: the full NCHW shape of data
+        const float* input = nullptr;
+        float* output = nullptr;
+        size_t capacity = 0;          // Outputs: floats available at output; none if only requested
+    };
+
+    RunBindings& BindInput(int portId, const TensorShape& shape, const float* data) {
+        inputs_.push_back({portId, std::string(), shape, data, nullptr, 0});
+        return *this;
+    }
+    RunBindings& BindInput(const std::string& name, const TensorShape& shape, const float* data) {
+        inputs_.push_back({-1, name, shape, data, nullptr, 0});
+        return *this;
+    }
+    RunBindings& BindOutput(int portId, float* data, size_t capacity) {
+        outputs_.push_back({portId, std::string(), TensorShape(), nullptr, data, capacity});
+        return *this;
+    }
+    RunBindings& BindOutput(const std::string& name, float* data, size_t capacity) {
+        outputs_.push_back({-1, name, TensorShape(), nullptr, data, capacity});
+        return *this;
+    }
+    // Needed outputs kept in engine memory, read through RunContext::Output
+    RunBindings& RequestOutput(int portId) { return BindOutput(portId, nullptr, 0); }
+    RunBindings& RequestOutput(const std::string& name) { return BindOutput(name, nullptr, 0); }
+
+    const std::vector<Binding>& Inputs() const { return inputs_; }
+    const std::vector<Binding>& Outputs() const { return outputs_; }
+
+private:
+    std::vector<Binding> inputs_;
+    std::vector<Binding> outputs_;
+};
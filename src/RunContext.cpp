@@ -0,0 +1,95 @@
+#include "RunContext.h"
+#include "ExecutorService.h"
+
+RunContext::RunContext(uint64_t id, std::shared_ptr<const ExecutionPlan> plan)
+    : id_(id),
+      plan_(std::move(plan)),
+      indegree_(new std::atomic<int>[plan_->Size()]),
+      pendingConsumers_(new std::atomic<int>[plan_->Size()]),
+      liveInputs_(new std::atomic<int>[plan_->Size()]),
+      edgeLive_(plan_->EdgeCount(), 0),
+      tensors_(plan_->Size()),
+      packed_(plan_->Size()),
+      readyBy_(plan_->Size(), -1),
+      totalNodes_(static_cast<int>(plan_->Size())),
+      startTime_(std::chrono::steady_clock::now()),
+      completionFuture_(completion_.get_future().share()) {
+    for (size_t i = 0; i < plan_->Size(); ++i) {
+        const ExecutionPlan::Node& node = (*plan_)[i];
+        indegree_[i].store(static_cast<int>(node.predecessorCount), std::memory_order_relaxed);
+        pendingConsumers_[i].store(static_cast<int>(node.successorCount), std::memory_order_relaxed);
+        liveInputs_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void RunContext::Restrict(std::vector<bool> active, const std::vector<uint32_t>& kept) {
+    active_ = std::move(active);
+    if (!kept.empty()) kept_.assign(plan_->Size(), false);
+    for (uint32_t index : kept) kept_[index] = true;
+    totalNodes_ = 0;
+    for (size_t i = 0; i < plan_->Size(); ++i) {
+        if (!active_[i]) continue;
+        ++totalNodes_;
+        // A cone is closed under predecessors, so indegrees stay as they are;
+        // only readers outside it no longer hold on to this output
+        const ExecutionPlan::Node& node = (*plan_)[i];
+        const uint32_t* succs = plan_->Successors(node);
+        int consumers = 0;
+        for (uint32_t s = 0; s < node.successorCount; ++s) consumers += active_[succs[s]] ? 1 : 0;
+        pendingConsumers_[i].store(consumers, std::memory_order_relaxed);
+    }
+}
+
+void RunContext::Wait() const {
+    std::unique_lock<std::mutex> lock(doneMutex_);
+    doneCondition_.wait(lock, [this]() { return Done(); });
+}
+
+bool RunContext::WaitFor(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(doneMutex_);
+    return doneCondition_.wait_for(lock, timeout, [this]() { return Done(); });
+}
+
+double RunContext::ElapsedSeconds() const {
+    const auto end = Done() ? endTime_ : std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - startTime_).count();
+}
+
+const Tensor* RunContext::Output(int nodeId) const {
+    if (!Done()) return nullptr;
+    const int index = plan_->IndexOf(nodeId);
+    if (index < 0 || tensors_[static_cast<size_t>(index)].Empty()) return nullptr;
+    return &tensors_[static_cast<size_t>(index)];
+}
+
+void RunContext::OnDone(std::function<void()> callback) {
+    {
+        std::lock_guard<std::mutex> lock(doneMutex_);
+        if (!Done()) {
+            doneCallbacks_.push_back(std::move(callback));
+            return;
+        }
+    }
+    callback();
+}
+
+RunHandle::RunHandle(std::shared_ptr<RunContext> run)
+    : run_(std::move(run)) {
+}
+
+const RunContext& RunHandle::Get() const {
+    run_->completionFuture_.wait();
+    return *run_;
+}
+
+void RunHandle::Then(std::function<void(const RunContext&)> callback) const {
+    std::shared_ptr<RunContext> run = run_;
+    run_->OnDone([run, callback]() { callback(*run); });
+}
+
+void RunHandle::Then(std::function<void(const RunContext&)> callback, ExecutorService& executor, int clientId) const {
+    std::shared_ptr<RunContext> run = run_;
+    run_->OnDone([run, callback, &executor, clientId]() {
+        executor.Submit(clientId, 0.0, 0.0, [run, callback](int) { callback(*run); });
+    });
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "ExecutionPlan.h"
+#include "MemoryTracker.h"
+#include "Tensor.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ExecutionLog;
+class ExecutorService;
+
+// Caller memory a node writes its output into (capacity in floats)
+struct OutputBuffer {
+    float* data = nullptr;
+    size_t capacity = 0;
+};
+
+// State of one execution of an ExecutionPlan: dependency counters, the
+// tensors produced so far, progress and a cancellation token. Runs share
+// nothing mutable with each other, so any number can execute the same plan
+// at once. Node tasks hold the context alive until the run has finished.
+class RunContext {
+public:
+    RunContext(uint64_t id, std::shared_ptr<const ExecutionPlan> plan);
+
+    RunContext(const RunContext&) = delete;
+    RunContext& operator=(const RunContext&) = delete;
+
+    uint64_t Id() const { return id_; }
+    int64_t BatchSize() const { return batch_; }
+    const ExecutionPlan& Plan() const { return *plan_; }
+
+    // Nodes not yet started are skipped; running nodes finish
+    void Cancel() { cancelled_.store(true, std::memory_order_release); }
+    bool Cancelled() const { return cancelled_.load(std::memory_order_acquire); }
+
+    bool Done() const { return done_.load(std::memory_order_acquire); }
+    bool Succeeded() const { return Done() && CompletedNodes() + PrunedNodes() == TotalNodes(); }
+    void Wait() const;
+    bool WaitFor(std::chrono::milliseconds timeout) const;
+
+    int CompletedNodes() const { return completedNodes_.load(std::memory_order_acquire); }
+    int PrunedNodes() const { return prunedNodes_.load(std::memory_order_acquire); }   // Skipped: no conditional input taken
+    int TotalNodes() const { return totalNodes_; }   // Nodes this run executes
+    float Progress() const { return TotalNodes() ? static_cast<float>(CompletedNodes() + PrunedNodes()) / TotalNodes() : 1.0f; }
+
+    std::chrono::steady_clock::time_point StartTime() const { return startTime_; }
+    double ElapsedSeconds() const;   // Up to now, or to the end once done
+
+    // Output of a sink or requested node once the run is done; other
+    // intermediate tensors are released as soon as their last consumer has
+    // run. Nodes outside a lazy run's cone and pruned branches have no output.
+    const Tensor* Output(int nodeId) const;
+    bool Executes(uint32_t index) const { return active_.empty() || active_[index]; }
+    bool Kept(uint32_t index) const { return !kept_.empty() && kept_[index]; }
+
+    // Calls callback once the run is done: on the thread that finishes it,
+    // or right away if it already has. Callbacks must not block.
+    void OnDone(std::function<void()> callback);
+
+private:
+    friend class AIModel;
+    friend class RunHandle;
+
+    // Limit the run to a cone of the plan (see ExecutionPlan::AncestorCone);
+    // only before any node has been submitted. The kept nodes' outputs stay
+    // in FP32 for the caller even when other nodes of the cone read them.
+    void Restrict(std::vector<bool> active, const std::vector<uint32_t>& kept = {});
+    // Drops a node's output once nothing reads it any more
+    void Release(uint32_t index) {
+        if (Kept(index)) return;
+        tensors_[index] = Tensor();
+        packed_[index] = std::vector<uint16_t>();
+    }
+
+    const uint64_t id_;
+    const std::shared_ptr<const ExecutionPlan> plan_;
+    std::unique_ptr<std::atomic<int>[]> indegree_;          // Unfinished inputs per node
+    std::unique_ptr<std::atomic<int>[]> pendingConsumers_;  // Unfinished readers per node output
+    std::unique_ptr<std::atomic<int>[]> liveInputs_;        // Inputs per node whose edge was taken
+    std::vector<uint8_t> edgeLive_;                         // Per predecessor slot: the edge carried data
+    std::vector<Tensor> tensors_;                           // Output per node
+    std::vector<std::vector<uint16_t>> packed_;             // Outputs held at the plan's 16-bit activation precision instead
+    std::vector<int> readyBy_;                              // Node id that released each node, -1 for entries
+    std::vector<Tensor> inputs_;                            // Caller inputs per entry node; empty if none were given
+    std::vector<OutputBuffer> outputs_;                     // Caller output buffers per node; empty if none were bound
+    std::vector<bool> active_;                              // Lazy runs: nodes in the requested cone; empty = all
+    std::vector<bool> kept_;                                // Lazy runs: requested nodes; empty = none
+    int totalNodes_;
+    int64_t batch_ = 1;                                     // N of every tensor in this run
+
+    std::atomic<bool> cancelled_{false};
+    std::atomic<int> inFlight_{0};          // Submitted node tasks that have not returned
+    std::atomic<int> completedNodes_{0};
+    std::atomic<int> prunedNodes_{0};
+    std::atomic<int64_t> busyNs_{0};
+    std::atomic<bool> done_{false};
+    std::chrono::steady_clock::time_point startTime_;
+    std::chrono::steady_clock::time_point endTime_;
+
+    // Interactive runs also fill the model's execution log and progress callbacks
+    ExecutionLog* log_ = nullptr;
+    bool reportProgress_ = false;
+    MemorySnapshot memoryStart_{};
+
+    mutable std::mutex doneMutex_;
+    mutable std::condition_variable doneCondition_;
+    std::vector<std::function<void()>> doneCallbacks_;
+    std::promise<void> completion_;
+    std::shared_future<void> completionFuture_;
+};
+
+// Caller's reference to a submitted run. Copies share the run; the run and
+// its sink outputs stay alive while any handle (or callback) holds them.
+// Awaiting goes through a std::shared_future, so runs compose with other
+// futures; Then() chains work onto completion without blocking a thread.
+class RunHandle {
+public:
+    RunHandle() = default;
+    explicit RunHandle(std::shared_ptr<RunContext> run);
+
+    // False if the run could not start (graph cannot run, inputs do not fit)
+    bool Valid() const { return run_ != nullptr; }
+    explicit operator bool() const { return Valid(); }
+
+    uint64_t Id() const { return run_->Id(); }
+    void Cancel() const { run_->Cancel(); }
+    bool Done() const { return run_->Done(); }
+
+    // Ready once the run is done, whether it succeeded or was cancelled
+    const std::shared_future<void>& Future() const { return run_->completionFuture_; }
+    // Waits for the run and returns it; read outputs with Output()
+    const RunContext& Get() const;
+    const RunContext& Context() const { return *run_; }
+
+    // Completion callbacks. The first runs inline on the worker that finishes
+    // the run; the second is queued as a task of clientId on executor.
+    void Then(std::function<void(const RunContext&)> callback) const;
+    void Then(std::function<void(const RunContext&)> callback, ExecutorService& executor, int clientId) const;
+
+private:
+    std::shared_ptr<RunContext> run_;
+};
@@ -1,8 +1,28 @@
 #include "SyncManager.h"
+#include "Profiler.h"
+#include "Metrics.h"
 #include <iostream>
 #include <chrono>
 #include <map>
 
+namespace {
+// Records a sync's wall time into aishow_sync_duration_seconds{direction=...}
+class SyncTimer {
+public:
+    explicit SyncTimer(const char* direction)
+        : histogram_(MetricsRegistry::Global().GetHistogram(
+              "aishow_sync_duration_seconds", "Time spent synchronizing model and editor", {{"direction", direction}})),
+          start_(std::chrono::steady_clock::now()) {}
+    ~SyncTimer() {
+        histogram_.Observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+}
+
 SyncManager::SyncManager(NodeEditor* editor, AIModel* model)
     : editor_(editor), model_(model), running_(false), editorChanged_(false), modelChanged_(false), executionProgressCallback_(nullptr) {
 }
@@ -39,7 +59,10 @@ void SyncManager::StopSync() {
 }
 
 void SyncManager::SyncEditorToModel() {
+    PROFILE_ZONE("SyncManager::SyncEditorToModel");
+    SyncTimer syncTimer("editor_to_model");
     std::lock_guard<std::mutex> lock(mutex_);
+    MemoryScope memScope(MemTag::Sync);
 
     // Temporarily disable model callback to avoid recursive sync
     model_->SetModelChangeCallback(nullptr);
@@ -62,9 +85,10 @@ void SyncManager::SyncEditorToModel() {
         modelNode.name = editorNode.name;
         modelNode.type = "Generic"; // Default type, could be enhanced
         modelNode.boundUINodeId = editorNode.id; // Bind to UI node
-        // Add default parameters
-        modelNode.parameters = {{"position_x", std::to_string(editorNode.positionX)},
-                               {"position_y", std::to_string(editorNode.positionY)}};
+        // Add default parameters (the model interns the strings in AddNode)
+        const std::string posX = std::to_string(editorNode.positionX);
+        const std::string posY = std::to_string(editorNode.positionY);
+        modelNode.parameters = {{"position_x", posX}, {"position_y", posY}};
 
         model_->AddNode(modelNode);
     }
@@ -86,7 +110,10 @@ void SyncManager::SyncEditorToModel() {
 }
 
 void SyncManager::SyncModelToEditor() {
+    PROFILE_ZONE("SyncManager::SyncModelToEditor");
+    SyncTimer syncTimer("model_to_editor");
     std::lock_guard<std::mutex> lock(mutex_);
+    MemoryScope memScope(MemTag::Sync);
 
     // Temporarily disable editor callback to avoid recursive sync
     editor_->SetNodeChangeCallback(nullptr);
@@ -110,14 +137,14 @@ void SyncManager::SyncModelToEditor() {
 
         for (const auto& param : modelNode.parameters) {
             if (param.first == "position_x") {
-                posX = std::stof(param.second);
+                posX = std::stof(std::string(param.second));
             } else if (param.first == "position_y") {
-                posY = std::stof(param.second);
+                posY = std::stof(std::string(param.second));
             }
         }
 
         // boundAINodeId stores the AI model's node ID for later connection mapping
-        editor_->AddNode(modelNode.name, posX, posY, modelNode.id);
+        editor_->AddNode(std::string(modelNode.name), posX, posY, modelNode.id);
     }
 
     // Get the current UI nodes after deferred add operations
@@ -169,6 +196,63 @@ void SyncManager::SyncModelToEditor() {
     modelChanged_ = false;
 }
 
+void SyncManager::ApplyModelDelta(const ModelDelta& delta) {
+    PROFILE_ZONE("SyncManager::ApplyModelDelta");
+    SyncTimer syncTimer("delta");
+    std::lock_guard<std::mutex> lock(mutex_);
+    MemoryScope memScope(MemTag::Sync);
+
+    // Temporarily disable callbacks; both sides are updated explicitly below
+    editor_->SetNodeChangeCallback(nullptr);
+    model_->SetModelChangeCallback(nullptr);
+
+    model_->ApplyDelta(delta);
+
+    for (const auto& conn : delta.removedConnections) {
+        int fromUi = editor_->FindNodeByAINodeId(std::get<0>(conn));
+        int toUi = editor_->FindNodeByAINodeId(std::get<1>(conn));
+        if (fromUi != -1 && toUi != -1) {
+            editor_->RemoveLink(fromUi, std::get<2>(conn), toUi, std::get<3>(conn));
+        }
+    }
+
+    for (int nodeId : delta.removedNodeIds) {
+        int uiId = editor_->FindNodeByAINodeId(nodeId);
+        if (uiId != -1) editor_->RemoveNode(uiId);
+    }
+
+    for (const auto& node : delta.updatedNodes) {
+        int uiId = editor_->FindNodeByAINodeId(node.id);
+        if (uiId != -1) editor_->RenameNode(uiId, std::string(node.name));
+    }
+
+    for (const auto& node : delta.addedNodes) {
+        float posX = 100.0f + (node.id - 1) * 150.0f; // Default spacing
+        float posY = 100.0f;
+        editor_->AddNode(std::string(node.name), posX, posY, node.id);
+    }
+
+    // Connections are resolved by AI node id once the new UI nodes exist
+    for (const auto& conn : delta.addedConnections) {
+        editor_->QueueConnectionForSync(std::get<0>(conn), std::get<1>(conn),
+                                        std::get<2>(conn), std::get<3>(conn));
+    }
+
+    std::cout << "Applied model delta: +" << delta.addedNodes.size() << " ~" << delta.updatedNodes.size()
+              << " -" << delta.removedNodeIds.size() << " nodes, +" << delta.addedConnections.size()
+              << " -" << delta.removedConnections.size() << " connections" << std::endl;
+
+    // Re-enable callbacks
+    model_->SetModelChangeCallback([this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        modelChanged_ = true;
+    });
+    editor_->SetNodeChangeCallback([this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        editorChanged_ = true;
+    });
+}
+
 void SyncManager::SyncLoop() {
     while (running_) {
         bool shouldSyncEditor = false;
@@ -214,12 +298,19 @@ void SyncManager::HandleModelChanges() {
     }
 }
 
-void SyncManager::StartExecution(int numThreads) {
+RunHandle SyncManager::StartExecution(int numThreads) {
     model_->SetExecutionConfig(numThreads);
     model_->SetProgressCallback([this](const ExecutionProgress& progress) {
         HandleExecutionProgress(progress);
     });
-    model_->StartExecution(numThreads);
+    return model_->StartExecution(numThreads);
+}
+
+bool SyncManager::StartReplay(const ExecutionTrace& trace, double speed) {
+    model_->SetProgressCallback([this](const ExecutionProgress& progress) {
+        HandleExecutionProgress(progress);
+    });
+    return model_->StartReplay(trace, speed);
 }
 
 void SyncManager::StopExecution() {
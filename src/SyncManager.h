@@ -16,11 +16,16 @@ public:
     void StopSync();
     void SyncEditorToModel();
     void SyncModelToEditor();
+    // Apply a model delta to both the model and the editor without a full
+    // re-sync, so untouched UI nodes keep their positions
+    void ApplyModelDelta(const ModelDelta& delta);
 
     // Execution control
-    void StartExecution(int numThreads = 1);
+    RunHandle StartExecution(int numThreads = 1);
     void StopExecution();
     bool IsExecuting() const;
+    // Replay a recorded run through the same progress path as a live one
+    bool StartReplay(const ExecutionTrace& trace, double speed);
 
     void SetExecutionProgressCallback(std::function<void(const ExecutionProgress&)> callback) {
         executionProgressCallback_ = callback;
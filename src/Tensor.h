@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// NCHW activation shape; lower-rank values use the trailing dimensions
+struct TensorShape {
+    int64_t n = 1;
+    int64_t c = 1;
+    int64_t h = 1;
+    int64_t w = 1;
+
+    int64_t Elements() const { return n * c * h * w; }
+    bool operator==(const TensorShape& other) const {
+        return n == other.n && c == other.c && h == other.h && w == other.w;
+    }
+    bool operator!=(const TensorShape& other) const { return !(*this == other); }
+};
+
+// Arithmetic and weight storage of a node. Activations between nodes are
+// always FP32 tensors; a node of lower precision converts on entry.
+enum class Precision : uint8_t {
+    FP32,
+    INT8,
+    FP16,   // IEEE half
+    BF16,   // bfloat16: FP32's exponent, 8-bit mantissa
+};
+
+inline const char* PrecisionName(Precision precision) {
+    switch (precision) {
+    case Precision::FP32: return "fp32";
+    case Precision::INT8: return "int8";
+    case Precision::FP16: return "fp16";
+    case Precision::BF16: return "bf16";
+    default:              return "?";
+    }
+}
+
+inline bool ParsePrecision(std::string_view text, Precision& precision) {
+    if (text == "fp32") precision = Precision::FP32;
+    else if (text == "int8") precision = Precision::INT8;
+    else if (text == "fp16") precision = Precision::FP16;
+    else if (text == "bf16") precision = Precision::BF16;
+    else return false;
+    return true;
+}
+
+inline bool IsHalf(Precision precision) {
+    return precision == Precision::FP16 || precision == Precision::BF16;
+}
+
+// Bytes per stored element
+inline double PrecisionBytes(Precision precision) {
+    return precision == Precision::INT8 ? 1.0 : IsHalf(precision) ? 2.0 : 4.0;
+}
+
+// Storage precision of a whole model. Weights apply to every node whose op
+// has kernels at that precision, unless the node's own "precision"
+// parameter (e.g. from INT8 quantization) says otherwise. Activations are
+// the outputs held between nodes during a run (FP32, FP16 or BF16); kernels
+// still read and write FP32.
+struct PrecisionPolicy {
+    Precision weights = Precision::FP32;
+    Precision activations = Precision::FP32;
+};
+
+// Dense FP32 tensor in NCHW order. A tensor either owns its storage or is a
+// view of caller memory (View()), which must outlive every use of the view.
+// Copying a view copies the reference, not the data.
+struct Tensor {
+    TensorShape shape;
+
+    Tensor() = default;
+    explicit Tensor(const TensorShape& s)
+        : shape(s), storage_(static_cast<size_t>(s.Elements())), data_(storage_.data()) {}
+
+    // The engine never writes through a view of const memory
+    static Tensor View(const TensorShape& s, float* data) {
+        Tensor view;
+        view.shape = s;
+        view.data_ = data;
+        return view;
+    }
+    static Tensor View(const TensorShape& s, const float* data) { return View(s, const_cast<float*>(data)); }
+
+    Tensor(const Tensor& other)
+        : shape(other.shape), storage_(other.storage_), data_(other.IsView() ? other.data_ : storage_.data()) {}
+    Tensor(Tensor&& other) noexcept
+        : shape(other.shape), storage_(std::move(other.storage_)), data_(other.data_) {
+        other.Reset();
+    }
+    Tensor& operator=(const Tensor& other) {
+        if (this != &other) *this = Tensor(other);
+        return *this;
+    }
+    Tensor& operator=(Tensor&& other) noexcept {
+        if (this != &other) {
+            shape = other.shape;
+            storage_ = std::move(other.storage_);
+            data_ = other.data_;
+            other.Reset();
+        }
+        return *this;
+    }
+
+    float* Data() { return data_; }
+    const float* Data() const { return data_; }
+    size_t Size() const { return data_ ? static_cast<size_t>(shape.Elements()) : 0; }
+    bool Empty() const { return Size() == 0; }
+    bool IsView() const { return data_ != nullptr && storage_.empty(); }
+
+    float& operator[](size_t i) { return data_[i]; }
+    float operator[](size_t i) const { return data_[i]; }
+    const float* begin() const { return data_; }
+    const float* end() const { return data_ + Size(); }
+
+private:
+    void Reset() {
+        shape = TensorShape();
+        storage_.clear();
+        data_ = nullptr;
+    }
+
+    std::vector<float> storage_;
+    float* data_ = nullptr;
+};
@@ -1,13 +1,29 @@
 #include "AIModel.h"
+#include "BatchingServer.h"
+#include "Half.h"
+#include "KernelTuner.h"
+#include "Kernels.h"
+#include "Metrics.h"
+#include "OperatorRegistry.h"
+#include "Profiler.h"
+#include "Quantizer.h"
+#include <algorithm>
 #include <iostream>
 #include <mutex>
-#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <memory>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
-int main() {
-    AIModel model;
-
-    // Create a simple chain DAG: 1 -> 2 -> 3
+namespace {
+// Create a simple chain DAG: 1 -> 2 -> 3
+void BuildChain(AIModel& model) {
     AINode n1{1, "Conv2D", "Node1", {}, {}, {}, -1};
     AINode n2{2, "MaxPool", "Node2", {}, {}, {}, -1};
     AINode n3{3, "Generic", "Node3", {}, {}, {}, -1};
@@ -18,54 +34,1012 @@ int main() {
 
     model.AddConnection(1, 2, 0, 0);
     model.AddConnection(2, 3, 0, 0);
+}
+
+bool WaitForRun(AIModel& model, std::chrono::seconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (model.IsExecuting() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return !model.IsExecuting();
+}
+
+// Replay a trace and wait for it to finish; returns false on timeout
+bool ReplayAndWait(AIModel& model, const ExecutionTrace& trace, double speed) {
+    if (!model.StartReplay(trace, speed)) return false;
+    const bool finished = WaitForRun(model, std::chrono::seconds(20));
+    model.StopExecution();
+    return finished;
+}
+}
+
+// Usage: ai_execution_test                        run the test
+//        ai_execution_test --replay FILE [SPEED]  replay a recorded trace (SPEED 0 = virtual time)
+int main(int argc, char** argv) {
+    AIModel model;
+
+    BuildChain(model);
+
+    if (argc >= 3 && std::string(argv[1]) == "--replay") {
+        ExecutionTrace trace;
+        if (!ExecutionTrace::Load(argv[2], trace)) return 1;
+        const double speed = argc >= 4 ? std::stod(argv[3]) : 0.0;
+        model.SetProgressCallback([](const ExecutionProgress& p) {
+            std::cout << "Replay: node=" << p.nodeId << " status=" << p.status << std::endl;
+        });
+        if (!ReplayAndWait(model, trace, speed)) return 1;
+        const ExecutionLog& log = model.GetExecutionLog();
+        for (size_t i = 0; i < log.Size(); ++i) {
+            std::cout << "span node=" << log[i].nodeId << " worker=" << log[i].worker
+                      << " start=" << log[i].startNs / 1e6 << "ms end=" << log[i].endNs / 1e6 << "ms" << std::endl;
+        }
+        return 0;
+    }
+
+    // Cost model: the default input is 1x3x224x224 and a default Conv2D is
+    // 64 3x3 filters with same padding
+    const NodeCostMap& costs = model.GetNodeCosts();
+    const MachinePeak& peak = CostModel::Peak();
+    std::cout << "Peak: " << peak.flopsPerSecond / 1e9 << " GFLOP/s, " << peak.bytesPerSecond / 1e9 << " GB/s" << std::endl;
+    for (int nodeId = 1; nodeId <= 3; ++nodeId) {
+        const NodeCost& c = costs.at(nodeId);
+        std::cout << "Cost: node=" << nodeId << " flops=" << c.flops << " bytes=" << c.bytes
+                  << " predicted=" << c.predictedSeconds * 1e3 << "ms " << (c.computeBound ? "compute" : "memory") << std::endl;
+    }
+    const bool costsOk = costs.size() == 3 && costs.at(1).flops == 2.0 * 64 * 224 * 224 * 3 * 3 * 3 &&
+                         costs.at(2).output.h == 112 && costs.at(3).input.c == 64;
 
-    std::mutex m;
-    std::condition_variable cv;
-    int completed = 0;
+    std::atomic<int> completed{0};
+    std::atomic<int> misnamed{0};
     const int total = 3;
-    bool ok = true;
+    bool ok = costsOk;
 
+    // Progress names come from the plan or the replay, not the live graph
+    std::unordered_map<int, std::string> names;
+    for (const AINode& node : model.GetNodes()) names.emplace(node.id, std::string(node.name));
     model.SetProgressCallback([&](const ExecutionProgress& p) {
         std::cout << "Progress: node=" << p.nodeId << " status=" << p.status << " progress=" << p.progress << " msg=" << p.message << std::endl;
-        if (p.status == "completed") {
-            {
-                std::lock_guard<std::mutex> lk(m);
-                completed++;
-            }
-            cv.notify_one();
-        }
+        if (p.status == "completed") completed++;
+        if (names.count(p.nodeId) == 0 || names.at(p.nodeId) != p.nodeName) misnamed++;
     });
 
-    // First run
-    std::cout << "Test: starting first run" << std::endl;
-    model.StartExecution(2);
+    // Two interactive runs, awaited through their handles
+    for (const char* label : {"first", "second"}) {
+        completed = 0;
+        std::cout << "Test: starting " << label << " run" << std::endl;
+        RunHandle run = model.StartExecution(2);
+        if (!run || run.Future().wait_for(std::chrono::seconds(20)) != std::future_status::ready ||
+            !run.Get().Succeeded() || completed != total) {
+            std::cerr << "Timeout waiting for " << label << " run completion" << std::endl;
+            ok = false;
+        }
+        model.StopExecution();
+        std::cout << "Test: " << label << " run finished, completed=" << completed << std::endl;
+        std::cout << label << " run allocations:\n" << MemoryTracker::Report(MemoryTracker::LastRun());
+    }
+
+    // Record the second run, reload it and replay it in virtual time: the
+    // replayed log must match the recording without re-executing any node
+    const std::string traceFile = "ai_execution_test.trace";
+    ExecutionTrace recorded;
+    if (!model.SaveExecutionTrace(traceFile) || !ExecutionTrace::Load(traceFile, recorded) ||
+        recorded.spans.size() != static_cast<size_t>(total)) {
+        std::cerr << "Trace round trip failed" << std::endl;
+        ok = false;
+    } else {
+        completed = 0;
+        const auto replayStart = std::chrono::steady_clock::now();
+        if (!ReplayAndWait(model, recorded, 0.0)) {
+            std::cerr << "Virtual-time replay did not finish" << std::endl;
+            ok = false;
+        }
+        const double replayMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - replayStart).count();
+        const ExecutionLog& log = model.GetExecutionLog();
+        bool matches = log.Finished() && log.Size() == recorded.spans.size() && log.EndNs() == recorded.endNs;
+        for (size_t i = 0; matches && i < log.Size(); ++i) {
+            matches = log[i].nodeId == recorded.spans[i].nodeId && log[i].worker == recorded.spans[i].worker &&
+                      log[i].startNs == recorded.spans[i].startNs && log[i].endNs == recorded.spans[i].endNs;
+        }
+        std::cout << "Test: replayed " << log.Size() << " spans of a " << recorded.endNs / 1e6
+                  << " ms run in " << replayMs << " ms, completed=" << completed << std::endl;
+        if (!matches || completed != total || misnamed != 0) {
+            std::cerr << "Replayed log does not match the recorded trace" << std::endl;
+            ok = false;
+        }
+    }
 
+    // Two models sharing a two-worker executor, one node at a time each: they
+    // run side by side instead of queueing behind each other, so their first
+    // and last node timestamps interleave
     {
-        std::unique_lock<std::mutex> lk(m);
-        if (!cv.wait_for(lk, std::chrono::seconds(20), [&]{ return completed == total; })) {
-            std::cerr << "Timeout waiting for first run completion" << std::endl;
+        ExecutorService executor(2);
+        AIModel first, second;
+        BuildChain(first);
+        BuildChain(second);
+        first.SetExecutor(executor);
+        second.SetExecutor(executor);
+        second.SetSchedulingWeight(2.0);
+
+        using Clock = std::chrono::steady_clock;
+        std::mutex timesMutex;
+        Clock::time_point started[2], finished[2];
+        auto track = [&](int model) {
+            return [&, model](const ExecutionProgress& p) {
+                std::lock_guard<std::mutex> lk(timesMutex);
+                if (p.status == "running" && started[model] == Clock::time_point()) started[model] = Clock::now();
+                if (p.status == "completed") finished[model] = Clock::now();
+            };
+        };
+        first.SetProgressCallback(track(0));
+        second.SetProgressCallback(track(1));
+
+        RunHandle firstRun = first.StartExecution(1);
+        RunHandle secondRun = second.StartExecution(1);
+        const bool done = firstRun && secondRun &&
+                          firstRun.Future().wait_for(std::chrono::seconds(20)) == std::future_status::ready &&
+                          secondRun.Future().wait_for(std::chrono::seconds(20)) == std::future_status::ready;
+        const bool overlapped = started[0] < finished[1] && started[1] < finished[0];
+        std::cout << "Test: two models on a shared pool " << (overlapped ? "overlapped" : "ran back to back") << std::endl;
+        if (!done || first.GetExecutionLog().Size() != 3 || second.GetExecutionLog().Size() != 3 || !overlapped) {
+            std::cerr << "Shared executor did not run both models concurrently" << std::endl;
             ok = false;
         }
     }
 
-    model.StopExecution();
-    std::cout << "Test: first run finished, completed=" << completed << std::endl;
+    // Submitted runs complete through callbacks on a chosen executor; the
+    // submitting thread never blocks until it collects the count
+    {
+        ExecutorService callbacks(1);
+        const int client = callbacks.RegisterClient({"callbacks", 1.0, 1});
+        std::promise<void> allDone;
+        std::atomic<int> remaining{4}, succeeded{0};
+        for (int i = 0; i < 4; ++i) {
+            RunHandle run = model.SubmitRun();
+            if (!run) continue;
+            run.Then([&](const RunContext& finished) {
+                if (finished.Succeeded() && finished.Output(3)) succeeded++;
+                if (--remaining == 0) allDone.set_value();
+            }, callbacks, client);
+        }
+        const bool finished = allDone.get_future().wait_for(std::chrono::seconds(20)) == std::future_status::ready;
+        callbacks.UnregisterClient(client);
+        std::cout << "Test: " << succeeded << " of 4 submitted runs completed through callbacks" << std::endl;
+        if (!finished || succeeded != 4) ok = false;
+    }
+
+    // Pulling an intermediate output runs only its ancestor cone
+    {
+        RunHandle lazy = model.SubmitRun(RunBindings().RequestOutput("Node2"));
+        const bool lazyOk = lazy && lazy.Get().Succeeded() && lazy.Get().TotalNodes() == 2 &&
+                            lazy.Get().Output(2) && !lazy.Get().Output(3);
+        std::cout << "Test: pulled Node2 by running " << (lazy ? lazy.Get().CompletedNodes() : 0) << " of 3 nodes" << std::endl;
+        if (!lazyOk) ok = false;
+
+        // A requested node that feeds another requested node keeps its FP32
+        // output, also under a 16-bit activation policy
+        bool nestedOk = true;
+        for (Precision activations : {Precision::FP32, Precision::FP16}) {
+            nestedOk = nestedOk && model.SetPrecisionPolicy({Precision::FP32, activations});
+            RunHandle nested = model.SubmitRun(RunBindings().RequestOutput("Node1").RequestOutput("Node2"));
+            nestedOk = nestedOk && nested && nested.Get().Succeeded() && nested.Get().TotalNodes() == 2 &&
+                       nested.Get().Output(1) && nested.Get().Output(2) && !nested.Get().Output(3);
+        }
+        model.SetPrecisionPolicy({});
+        std::cout << "Test: nested requested outputs " << (nestedOk ? "kept" : "FAILED") << std::endl;
+        if (!nestedOk) ok = false;
+    }
+
+    // Collecting while a thread keeps wrapping its ring buffer returns only
+    // whole events; an empty zone, timed against the same loop without it,
+    // costs under 1% of a run's time at the number of zones a run records
+    {
+        std::atomic<bool> stop{false}, started{false};
+        std::thread writer([&]() {
+            while (!stop.load()) {
+                PROFILE_ZONE("profiler_test_outer");
+                PROFILE_ZONE("profiler_test_inner");
+                started = true;
+            }
+        });
+        while (!started.load()) std::this_thread::yield();
+        bool eventsOk = true;
+        for (int pass = 0; pass < 50; ++pass) {
+            for (const ProfileLane& lane : Profiler::Collect(0)) {
+                for (const ProfileLane::Zone& zone : lane.zones) {
+                    const std::string name = zone.name ? zone.name : "";
+                    if (zone.beginNs > zone.endNs || (name == "profiler_test_outer" && zone.depth != 0) ||
+                        (name == "profiler_test_inner" && zone.depth != 1)) {
+                        eventsOk = false;
+                    }
+                }
+            }
+        }
+        stop = true;
+        writer.join();
+
+        using Clock = std::chrono::steady_clock;
+        constexpr int kZones = 200000;
+        volatile int sink = 0;
+        auto best = [](auto body) {
+            double fastest = 0.0;
+            for (int rep = 0; rep < 5; ++rep) {
+                const auto start = Clock::now();
+                body();
+                const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                fastest = rep == 0 ? seconds : std::min(fastest, seconds);
+            }
+            return fastest;
+        };
+        const double baseline = best([&]() {
+            for (int i = 0; i < kZones; ++i) sink = sink + 1;
+        });
+        const double zoned = best([&]() {
+            for (int i = 0; i < kZones; ++i) {
+                PROFILE_ZONE("profiler_test_empty");
+                sink = sink + 1;
+            }
+        });
+        const double perZone = std::max(0.0, zoned - baseline) / kZones;
+
+        const int64_t since = Profiler::NowNs();
+        RunHandle run = model.SubmitRun();
+        const double runSeconds = run ? run.Get().ElapsedSeconds() : 0.0;
+        size_t zones = 0;
+        for (const ProfileLane& lane : Profiler::Collect(since)) zones += lane.zones.size();
+        const double overhead = runSeconds > 0.0 ? zones * perZone / runSeconds : 1.0;
+        std::cout << "Test: empty zone " << perZone * 1e9 << " ns, " << zones << " zones per run, overhead "
+                  << overhead * 100.0 << "%" << (eventsOk ? "" : ", torn events FAILED") << std::endl;
+        if (!eventsOk || overhead >= 0.01) ok = false;
+    }
+
+    // Repeated edits do not grow the graph's string storage: values no node
+    // references any more are reclaimed, and live ones keep their text
+    {
+        AIModel edited;
+        edited.AddNode(AINode{1, "Generic", "moved", {}, {}, {}, -1});
+        edited.AddNode(AINode{2, "Generic", "other", {{"label", "unchanged"}}, {}, {}, -1});
+        edited.AddConnection(1, 2, 0, 0);
+        std::string last;
+        for (int i = 0; i < 20000; ++i) {
+            last = "position " + std::to_string(i) + " of a node dragged around the editor";
+            AINode node = edited.GetNodes()[0];
+            node.parameters.clear();
+            node.parameters.emplace_back("position_x", last);
+            edited.UpdateNode(node);
+        }
+        const GraphArena& arena = edited.GetArena();
+        const AINode& moved = edited.GetNodes()[0];
+        const AINode& other = edited.GetNodes()[1];
+        const bool arenaOk = arena.StringBytes() < 256 * 1024 && arena.BytesReserved() < 1024 * 1024 &&
+                             moved.parameters.size() == 1 && moved.parameters[0].second == last &&
+                             other.parameters[0].second == "unchanged" && edited.GetEdges().size() == 1 &&
+                             edited.GetNodeInputPorts(2)[0]->name == "input";
+        std::cout << "Test: 20000 edits left " << arena.StringBytes() << " bytes of strings ("
+                  << (arenaOk ? "bounded" : "FAILED") << ")" << std::endl;
+        if (!arenaOk) ok = false;
+
+        // Edits while a run is in flight leave the old strings in place for
+        // its workers; the first change after the run compacts them
+        ExecutorService pool(1);
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        const ExecutorService::ClientId blocker = pool.RegisterClient({});
+        pool.Submit(blocker, 0.0, 1.0, [released](int) { released.wait(); });
+        edited.SetExecutor(pool);
+        std::mutex namesMutex;
+        std::vector<std::string> reported;
+        edited.SetProgressCallback([&](const ExecutionProgress& progress) {
+            std::lock_guard<std::mutex> lock(namesMutex);
+            reported.push_back(progress.nodeName);
+        });
+        RunHandle inFlight = edited.StartExecution(1);
+        const size_t before = arena.StringBytes();
+        for (int i = 0; i < 20000; ++i) {
+            AINode node = edited.GetNodes()[0];
+            node.parameters.clear();
+            node.parameters.emplace_back("position_x", "in flight " + std::to_string(i) + " of a node dragged around the editor");
+            edited.UpdateNode(node);
+        }
+        const size_t during = arena.StringBytes();
+        release.set_value();
+        bool flightOk = inFlight && inFlight.Get().Succeeded() && during > before + 256 * 1024;
+        edited.UpdateNode(edited.GetNodes()[0]);
+        flightOk = flightOk && arena.StringBytes() < 256 * 1024;
+        for (const std::string& name : reported) flightOk = flightOk && (name == "moved" || name == "other");
+        flightOk = flightOk && !reported.empty();
+        std::cout << "Test: edits during a run kept " << during << " bytes of strings until it finished ("
+                  << (flightOk ? "ok" : "FAILED") << ")" << std::endl;
+        edited.SetProgressCallback(nullptr);
+        edited.SetExecutor(ExecutorService::Shared());
+        pool.UnregisterClient(blocker);
+        if (!flightOk) ok = false;
+    }
+
+    // A node with more than eight inputs sums every one of them, in runs
+    // and in the single-threaded passes
+    {
+        AIModel wide;
+        const int sources = 11;
+        for (int id = 1; id <= sources; ++id) {
+            wide.AddNode(AINode{id, "Elementwise", "in" + std::to_string(id), {{"input_shape", "1x1x2x3"}}, {}, {}, -1});
+        }
+        wide.AddNode(AINode{sources + 1, "Elementwise", "sum", {}, {}, {}, -1});
+        for (int id = 1; id <= sources; ++id) wide.AddConnection(id, sources + 1, 0, 0);
+        RunHandle run = wide.SubmitRun();
+        auto plan = wide.GetPlan();
+        std::vector<Tensor> outputs;
+        if (plan) plan->RunAll({}, outputs);
+        const Tensor input = ExecutionPlan::SyntheticInput(TensorShape{1, 1, 2, 3});
+        const Tensor* got = run ? run.Get().Output(sources + 1) : nullptr;
+        const int sum = plan ? plan->IndexOf(sources + 1) : -1;
+        bool wideOk = got && sum >= 0 && got->Size() == input.Size() && outputs[sum].Size() == input.Size();
+        for (size_t e = 0; wideOk && e < input.Size(); ++e) {
+            const float expected = sources * input[e];
+            wideOk = std::fabs((*got)[e] - expected) < 1e-5f && std::fabs(outputs[sum][e] - expected) < 1e-5f;
+        }
+        std::cout << "Test: " << sources << "-input node " << (wideOk ? "summed every input" : "FAILED") << std::endl;
+        if (!wideOk) ok = false;
+    }
+
+    // An op registered from outside runs with no other change to the engine
+    {
+        OperatorDef halve;
+        halve.type = "Halve";
+        halve.estimate = [](const AIModel*, const AINode&, const TensorShape& input, NodeCost& cost) {
+            cost.output = input;
+            cost.flops = static_cast<double>(input.Elements());
+            return 0.0;
+        };
+        halve.prepare = [](const AIModel&, const AINode&, ExecutionPlan::Node&, size_t&) { return true; };
+        halve.kernels.push_back({"halve", [](const ExecutionPlan::Node&, const Tensor* const* inputs, int, Tensor& output) {
+            for (size_t i = 0; i < output.Size(); ++i) output[i] = (*inputs[0])[i] * 0.5f;
+        }, nullptr});
+        OperatorRegistry::Register(halve);
+
+        AIModel custom;
+        custom.AddNode(AINode{1, "Halve", "half", {{"input_shape", "1x2x1x1"}}, {}, {}, -1});
+        std::vector<float> values = {3.0f, -1.0f};
+        RunHandle halved = custom.SubmitRun({{1, Tensor::View({1, 2, 1, 1}, values.data())}});
+        const Tensor* output = halved ? halved.Get().Output(1) : nullptr;
+        const bool customOk = output && output->Size() == 2 && (*output)[0] == 1.5f && (*output)[1] == -0.5f;
+        std::cout << "Test: registered op " << (customOk ? "ran" : "FAILED") << std::endl;
+        if (!customOk) ok = false;
+    }
+
+    // Edges that would close a cycle are refused when inserted, also when
+    // the maintained order first has to be rearranged to tell
+    {
+        AIModel graph;
+        const char* names[] = {"a", "b", "c", "d", "e"};
+        for (int id = 1; id <= 5; ++id) graph.AddNode(AINode{id, "Add", names[id - 1], {}, {}, {}, -1});
+        graph.AddConnection(1, 2, 0, 0);
+        graph.AddConnection(2, 3, 0, 0);
+        graph.AddConnection(5, 4, 0, 0);
+        graph.AddConnection(4, 1, 0, 0);
+        std::cout << "Test: expecting two refused cycle edges" << std::endl;
+        graph.AddConnection(3, 5, 0, 0);
+        graph.AddConnection(3, 1, 0, 0);
+        const bool acyclicOk = graph.GetEdges().size() == 4 && graph.Validate().empty() && graph.GetPlan();
+        std::cout << "Test: cycle edges " << (acyclicOk ? "refused" : "FAILED") << std::endl;
+        if (!acyclicOk) ok = false;
+    }
+
+    // Conditional edges route a mixture of experts: the router's predicate
+    // selects one expert, the other is pruned without running, and the
+    // conditions survive a save / reload
+    {
+        AIModel moe;
+        moe.AddNode(AINode{1, "Dense", "router", {{"input_shape", "1x4x1x1"}, {"units", "2"}}, {}, {}, -1});
+        moe.AddNode(AINode{2, "Dense", "expert0", {{"units", "8"}}, {}, {}, -1});
+        moe.AddNode(AINode{3, "Dense", "expert1", {{"units", "8"}}, {}, {}, -1});
+        moe.AddNode(AINode{4, "Add", "combine", {}, {}, {}, -1});
+        moe.AddConnection(1, 2, 0, 0);
+        moe.AddConnection(1, 3, 0, 0);
+        moe.AddConnection(2, 4, 0, 0);
+        moe.AddConnection(3, 4, 0, 0);
+        moe.SetEdgeMetadata(1, 2, "condition", "0");
+        moe.SetEdgeMetadata(1, 3, "condition", "1");
+
+        RunHandle routed = moe.SubmitRun();
+        bool moeOk = routed && routed.Get().Succeeded() && routed.Get().CompletedNodes() == 3 &&
+                     routed.Get().PrunedNodes() == 1 && routed.Get().Output(4);
+        std::cout << "Test: mixture of experts ran " << (routed ? routed.Get().CompletedNodes() : 0) << " nodes, pruned "
+                  << (routed ? routed.Get().PrunedNodes() : 0) << std::endl;
 
-    // Second run
-    completed = 0;
-    std::cout << "Test: starting second run" << std::endl;
-    model.StartExecution(2);
+        const std::string moeFile = "ai_execution_test_moe.txt";
+        moe.SaveToFile(moeFile);
+        ModelSnapshot reloaded;
+        moeOk = moeOk && AIModel::ParseFile(moeFile, reloaded) && reloaded.edgeMetadata.size() == 2 && moe.Diff(reloaded).empty();
+        // A parameter deleted from the file updates the node, and applying
+        // the delta drops it from the model
+        auto withParams = std::find_if(reloaded.nodes.begin(), reloaded.nodes.end(),
+                                       [](const AINode& node) { return !node.parameters.empty(); });
+        if (moeOk && withParams != reloaded.nodes.end()) {
+            withParams->parameters.pop_back();
+            const ModelDelta dropped = moe.Diff(reloaded);
+            moeOk = dropped.updatedNodes.size() == 1 && dropped.updatedNodes[0].id == withParams->id;
+            moe.ApplyDelta(dropped);
+            moeOk = moeOk && moe.Diff(reloaded).empty();
+        } else {
+            moeOk = false;
+        }
+        std::remove(moeFile.c_str());
+        if (!moeOk) ok = false;
+    }
+
+    // A loop re-enters a compiled subgraph with carried state; it matches
+    // feeding the body its own output by hand
+    {
+        AIModel cell;
+        cell.AddNode(AINode{1, "Dense", "mix", {{"input_shape", "1x8x1x1"}, {"units", "8"}}, {}, {}, -1});
+        cell.AddNode(AINode{2, "Add", "act", {}, {}, {}, -1});
+        cell.AddConnection(1, 2, 0, 0);
+
+        AIModel recurrent;
+        recurrent.AddNode(AINode{1, "Dense", "embed", {{"input_shape", "1x4x1x1"}, {"units", "8"}}, {}, {}, -1});
+        recurrent.AddNode(AINode{2, "Loop", "steps", {{"subgraph", "cell"}, {"iterations", "5"}}, {}, {}, -1});
+        recurrent.AddNode(AINode{3, "Call", "head", {{"subgraph", "cell"}}, {}, {}, -1});
+        recurrent.AddConnection(1, 2, 0, 0);
+        recurrent.AddConnection(2, 3, 0, 0);
+        bool loopOk = recurrent.DefineSubgraph("cell", cell);
+
+        RunHandle looped = loopOk ? recurrent.SubmitRun() : RunHandle();
+        RunHandle embedded = loopOk ? recurrent.SubmitRun(RunBindings().RequestOutput("embed")) : RunHandle();
+        loopOk = looped && embedded && looped.Get().Succeeded() && embedded.Get().Succeeded();
+        if (loopOk) {
+            Tensor state = *embedded.Get().Output(1);
+            for (int pass = 0; loopOk && pass < 6; ++pass) {
+                std::shared_ptr<RunContext> step = cell.StartRun({{1, state}});
+                loopOk = step && step->WaitFor(std::chrono::seconds(20)) && step->Output(2);
+                if (loopOk) state = *step->Output(2);
+            }
+            const Tensor* output = looped.Get().Output(3);
+            loopOk = loopOk && output && output->Size() == state.Size() &&
+                     std::equal(state.begin(), state.end(), output->begin());
+        }
+        std::cout << "Test: loop over a subgraph " << (loopOk ? "matched the unrolled body" : "FAILED") << std::endl;
+        if (!loopOk) ok = false;
+
+        // Executing the loop node again on the same thread reuses its buffers
+        auto plan = recurrent.GetPlan();
+        const int steps = plan ? plan->IndexOf(2) : -1;
+        bool reuseOk = loopOk && steps >= 0;
+        if (reuseOk) {
+            const ExecutionPlan::Node& node = (*plan)[static_cast<size_t>(steps)];
+            const Tensor* inputs[] = {embedded.Get().Output(1)};
+            Tensor first(node.cost.output), output(node.cost.output);
+            ExecutionPlan::Evaluate(node, inputs, 1, first);
+            MemoryScope scope(MemTag::Editor);   // Nothing else allocates under it in this test
+            const MemorySnapshot before = MemoryTracker::Snapshot();
+            ExecutionPlan::Evaluate(node, inputs, 1, output);
+            const MemorySnapshot delta = MemoryTracker::Delta(before, MemoryTracker::Snapshot());
+            reuseOk = delta[static_cast<size_t>(MemTag::Editor)].allocations == 0 &&
+                      std::equal(output.begin(), output.end(), first.begin());
+        }
+
+        // A body whose sink a conditional edge prunes yields zeros
+        AIModel gated;
+        gated.AddNode(AINode{1, "Dense", "route", {{"input_shape", "1x4x1x1"}, {"units", "4"}}, {}, {}, -1});
+        gated.AddNode(AINode{2, "Add", "out", {}, {}, {}, -1});
+        gated.AddConnection(1, 2, 0, 0);
+        gated.SetEdgeMetadata(1, 2, "condition", "63");
+        AIModel caller;
+        caller.AddNode(AINode{1, "Call", "call", {{"input_shape", "1x4x1x1"}, {"subgraph", "gated"}}, {}, {}, -1});
+        reuseOk = reuseOk && caller.DefineSubgraph("gated", gated);
+        auto callPlan = reuseOk ? caller.GetPlan() : nullptr;
+        if (callPlan) {
+            Tensor input(TensorShape{1, 4, 1, 1}), output(TensorShape{1, 4, 1, 1});
+            std::fill(input.Data(), input.Data() + input.Size(), 1.0f);
+            std::fill(output.Data(), output.Data() + output.Size(), 7.0f);
+            const Tensor* inputs[] = {&input};
+            ExecutionPlan::Evaluate((*callPlan)[0], inputs, 1, output);
+            reuseOk = std::all_of(output.begin(), output.end(), [](float value) { return value == 0.0f; });
+        } else {
+            reuseOk = false;
+        }
+        std::cout << "Test: subgraph re-entry " << (reuseOk ? "allocated nothing, pruned sink zeroed" : "FAILED") << std::endl;
+        if (!reuseOk) ok = false;
+    }
+
+    // Shape-specialized convolutions are picked for their shapes (grouped
+    // ones when asked for) and match the generic kernel exactly, including at
+    // the borders and with groups
+    {
+        AIModel hot;
+        hot.AddNode(AINode{1, "Conv2D", "c3", {{"input_shape", "1x4x9x7"}, {"out_channels", "6"}, {"groups", "2"},
+                                                {"impl", "conv2d_3x3s1"}}, {}, {}, -1});
+        hot.AddNode(AINode{2, "Conv2D", "c1", {{"out_channels", "8"}, {"kernel", "1"}}, {}, {}, -1});
+        hot.AddNode(AINode{3, "Conv2D", "c5", {{"out_channels", "4"}, {"kernel", "5"}}, {}, {}, -1});
+        hot.AddConnection(1, 2, 0, 0);
+        hot.AddConnection(2, 3, 0, 0);
+        auto plan = hot.GetPlan();
+        bool fixedOk = plan && std::string((*plan)[0].kernelName) == "conv2d_3x3s1" &&
+                       std::string((*plan)[1].kernelName) == "conv2d_1x1" && std::string((*plan)[2].kernelName) == "conv2d_direct";
+        for (size_t i = 0; fixedOk && i < 2; ++i) {
+            const ExecutionPlan::Node& node = (*plan)[i];
+            Tensor input(node.cost.input), generic(node.cost.output), fixed(node.cost.output);
+            for (size_t e = 0; e < input.Size(); ++e) input[e] = static_cast<float>((e * 37) % 19) - 9.0f;
+            const Tensor* inputs[] = {&input};
+            kernels::Conv2D(input, node.weights.data(), node.bias.data(), node.conv, generic);
+            ExecutionPlan::Evaluate(node, inputs, 1, fixed);
+            fixedOk = std::equal(generic.begin(), generic.end(), fixed.begin());
+        }
+        std::cout << "Test: shape-specialized convolutions " << (fixedOk ? "matched" : "FAILED") << std::endl;
+        if (!fixedOk) ok = false;
+    }
+
+    // Post-training INT8: calibration rewrites Conv2D and Dense nodes, and
+    // the quantized graph stays close to FP32
+    {
+        AIModel net;
+        net.AddNode(AINode{1, "Conv2D", "conv", {{"input_shape", "1x3x16x16"}, {"out_channels", "16"}}, {}, {}, -1});
+        net.AddNode(AINode{2, "MaxPool", "pool", {}, {}, {}, -1});
+        net.AddNode(AINode{3, "Dense", "fc", {{"units", "10"}}, {}, {}, -1});
+        net.AddConnection(1, 2, 0, 0);
+        net.AddConnection(2, 3, 0, 0);
+        std::vector<RunInputs> calibration;
+        for (int b = 0; b < 4; ++b) {
+            Tensor sample({2, 3, 16, 16});
+            for (size_t i = 0; i < sample.Size(); ++i) sample[i] = std::sin(0.37f * static_cast<float>(i + 101 * b));
+            calibration.push_back({{1, sample}});
+        }
+        QuantizationReport report;
+        bool int8Ok = Quantizer::Quantize(net, calibration, &report);
+        auto plan = net.GetPlan();
+        int8Ok = int8Ok && plan && report.nodes.size() == 2 && std::string((*plan)[0].kernelName) == "conv2d_int8" &&
+                 std::string((*plan)[2].kernelName) == "dense_int8" && net.GetNodeCosts().at(3).precision == Precision::INT8 &&
+                 report.outputRelativeError < 0.05;
+        std::cout << "Test: " << report.ToText();
+        Quantizer::Dequantize(net);
+        plan = net.GetPlan();
+        int8Ok = int8Ok && plan && (*plan)[0].precision == Precision::FP32;
+
+        // A node's own fp16 precision is neither quantized nor dropped by Dequantize
+        AINode fc = net.GetNodes()[2];
+        fc.parameters.emplace_back("precision", "fp16");
+        net.UpdateNode(fc);
+        int8Ok = int8Ok && Quantizer::Quantize(net, calibration);
+        plan = net.GetPlan();
+        int8Ok = int8Ok && plan && (*plan)[0].precision == Precision::INT8 && (*plan)[2].precision == Precision::FP16;
+        Quantizer::Dequantize(net);
+        plan = net.GetPlan();
+        int8Ok = int8Ok && plan && (*plan)[0].precision == Precision::FP32 && (*plan)[2].precision == Precision::FP16 &&
+                 std::count_if(net.GetNodes()[2].parameters.begin(), net.GetNodes()[2].parameters.end(),
+                               [](const auto& param) { return param.first == "precision"; }) == 1;
+        std::cout << "Test: INT8 round trip " << (int8Ok ? "kept" : "FAILED to keep") << " a node's fp16 precision" << std::endl;
+        if (!int8Ok) ok = false;
+    }
+
+    // 16-bit storage: weights and the activations between nodes take half
+    // the bytes, kernels still sum in FP32, and results stay close to FP32
+    {
+        AIModel net;
+        net.AddNode(AINode{1, "Conv2D", "conv", {{"input_shape", "2x3x16x16"}, {"out_channels", "16"}}, {}, {}, -1});
+        net.AddNode(AINode{2, "MaxPool", "pool", {}, {}, {}, -1});
+        net.AddNode(AINode{3, "Dense", "fc", {{"units", "10"}}, {}, {}, -1});
+        net.AddConnection(1, 2, 0, 0);
+        net.AddConnection(2, 3, 0, 0);
+        RunHandle fp32 = net.SubmitRun();
+        const double fp32Bytes = net.GetNodeCosts().at(3).bytes;
+        bool halfOk = fp32 && fp32.Get().Output(3);
+        const Precision formats[] = {Precision::FP16, Precision::BF16};
+        for (Precision format : formats) {
+            halfOk = halfOk && net.SetPrecisionPolicy({format, format});
+            auto plan = net.GetPlan();
+            RunHandle half = net.SubmitRun();
+            const Tensor* want = fp32.Get().Output(3);
+            const Tensor* got = half ? half.Get().Output(3) : nullptr;
+            double error = 0.0, norm = 0.0;
+            for (size_t i = 0; got && i < got->Size(); ++i) {
+                error += ((*got)[i] - (*want)[i]) * ((*got)[i] - (*want)[i]);
+                norm += (*want)[i] * (*want)[i];
+            }
+            const double relative = norm > 0.0 ? std::sqrt(error / norm) : 1.0;
+            halfOk = halfOk && plan && got && (*plan)[2].precision == format && (*plan)[2].weights.empty() &&
+                     net.GetNodeCosts().at(3).bytes < 0.6 * fp32Bytes && relative < (format == Precision::FP16 ? 0.005 : 0.03);
+            std::cout << "Test: " << PrecisionName(format) << " storage, relative error " << relative << std::endl;
+        }
+        halfOk = halfOk && HalfToFloat(FloatToHalf(65504.0f)) == 65504.0f && HalfToFloat(FloatToHalf(1e6f)) == INFINITY &&
+                 HalfToFloat(FloatToHalf(-5.9604645e-8f)) == -5.9604645e-8f && Bf16ToFloat(FloatToBf16(1.00390625f)) == 1.0f;
+        net.SetPrecisionPolicy({});
+        if (!halfOk) ok = false;
+    }
+
+    // Depthwise and small-group convolutions get the channel-blocked kernel,
+    // and a depthwise node feeding a 1x1 runs inside it; both match the
+    // unfused graph exactly, and the depthwise output is still available
+    {
+        auto build = [](AIModel& net, bool fuse) {
+            net.AddNode(AINode{1, "Conv2D", "stem", {{"input_shape", "2x6x10x9"}, {"out_channels", "8"}}, {}, {}, -1});
+            net.AddNode(AINode{2, "Conv2D", "dw", {{"out_channels", "16"}, {"groups", "8"}, {"stride", "2"}}, {}, {}, -1});
+            net.AddNode(AINode{3, "Conv2D", "pw", {{"out_channels", "12"}, {"kernel", "1"}, {"impl", fuse ? "" : "conv2d_1x1"}},
+                               {}, {}, -1});
+            net.AddNode(AINode{4, "Conv2D", "gc", {{"out_channels", "8"}, {"groups", "4"}, {"kernel", "5"}, {"padding", "1"}},
+                               {}, {}, -1});
+            for (int id = 1; id < 4; ++id) net.AddConnection(id, id + 1, 0, 0);
+        };
+        AIModel fused, separate;
+        build(fused, true);
+        build(separate, false);
+        auto plan = fused.GetPlan();
+        auto reference = separate.GetPlan();
+        bool dwOk = plan && reference && plan->FusedCount() == 1 && (*plan)[1].fused && (*plan)[2].depthwise == &(*plan)[1] &&
+                    std::string((*plan)[2].kernelName) == "conv2d_dw_pw" && std::string((*plan)[3].kernelName) == "conv2d_grouped" &&
+                    reference->FusedCount() == 0 && std::string((*reference)[1].kernelName) == "conv2d_depthwise";
+        RunHandle expected = separate.SubmitRun();
+        RunHandle actual = fused.SubmitRun();
+        RunHandle expectedDw = separate.SubmitRun(RunBindings().RequestOutput("dw"));
+        RunHandle actualDw = fused.SubmitRun(RunBindings().RequestOutput("dw"));
+        const Tensor* want = expected ? expected.Get().Output(4) : nullptr;
+        const Tensor* got = actual ? actual.Get().Output(4) : nullptr;
+        dwOk = dwOk && want && got && want->Size() == got->Size() && std::equal(want->begin(), want->end(), got->begin()) &&
+               actual.Get().Output(2) == nullptr && actual.Get().TotalNodes() == 3;
+        const Tensor* wantDw = expectedDw ? expectedDw.Get().Output(2) : nullptr;
+        const Tensor* gotDw = actualDw ? actualDw.Get().Output(2) : nullptr;
+        dwOk = dwOk && wantDw && gotDw && wantDw->Size() == gotDw->Size() &&
+               std::equal(wantDw->begin(), wantDw->end(), gotDw->begin());
+        for (size_t i = 1; dwOk && i < 4; i += 2) {
+            const ExecutionPlan::Node& node = (*plan)[i];
+            Tensor input(node.cost.input), generic(node.cost.output), blocked(node.cost.output);
+            for (size_t e = 0; e < input.Size(); ++e) input[e] = std::cos(0.23f * static_cast<float>(e));
+            const Tensor* inputs[] = {&input};
+            kernels::Conv2D(input, node.weights.data(), node.bias.data(), node.conv, generic);
+            ExecutionPlan::Evaluate(node, inputs, 1, blocked);
+            dwOk = std::equal(generic.begin(), generic.end(), blocked.begin());
+        }
+        std::cout << "Test: depthwise, grouped and fused convolutions " << (dwOk ? "matched" : "FAILED") << std::endl;
+        if (!dwOk) ok = false;
+    }
+
+    // Flash attention matches a plain softmax over every key, with and
+    // without the causal mask and at lengths that split the tiles unevenly;
+    // decoding one position at a time against a growing KV cache reproduces
+    // the full causal rows, and the graph op runs the same kernel
+    {
+        const int64_t positions = 70, width = 64;
+        kernels::AttentionParams params;
+        params.heads = 4;
+        Tensor qkv(TensorShape{2, 3, positions, width});
+        for (size_t e = 0; e < qkv.Size(); ++e) qkv[e] = std::sin(0.37f * static_cast<float>(e)) + 0.1f * std::cos(0.011f * e);
+        // Row p of channel c in batch item n
+        auto row = [](auto& tensor, int64_t n, int64_t c, int64_t p) {
+            return tensor.Data() + ((n * tensor.shape.c + c) * tensor.shape.h + p) * tensor.shape.w;
+        };
+        auto naive = [&](bool causal, Tensor& output) {
+            const int64_t headDim = width / params.heads;
+            for (int64_t n = 0; n < qkv.shape.n; ++n) {
+                for (int64_t head = 0; head < params.heads; ++head) {
+                    for (int64_t i = 0; i < positions; ++i) {
+                        const int64_t keys = causal ? i + 1 : positions;
+                        std::vector<double> weights(static_cast<size_t>(keys));
+                        const float* q = row(qkv, n, 0, i) + head * headDim;
+                        for (int64_t j = 0; j < keys; ++j) {
+                            const float* k = row(qkv, n, 1, j) + head * headDim;
+                            double dot = 0.0;
+                            for (int64_t d = 0; d < headDim; ++d) dot += static_cast<double>(q[d]) * k[d];
+                            weights[j] = dot / std::sqrt(static_cast<double>(headDim));
+                        }
+                        const double top = *std::max_element(weights.begin(), weights.end());
+                        double sum = 0.0;
+                        for (double& w : weights) {
+                            w = std::exp(w - top);
+                            sum += w;
+                        }
+                        float* o = row(output, n, 0, i) + head * headDim;
+                        for (int64_t d = 0; d < headDim; ++d) {
+                            double value = 0.0;
+                            for (int64_t j = 0; j < keys; ++j) value += weights[j] * row(qkv, n, 2, j)[head * headDim + d];
+                            o[d] = static_cast<float>(value / sum);
+                        }
+                    }
+                }
+            }
+        };
+        auto maxDelta = [](const Tensor& a, const Tensor& b) {
+            float delta = a.Size() == b.Size() ? 0.0f : INFINITY;
+            for (size_t e = 0; e < a.Size() && e < b.Size(); ++e) delta = std::max(delta, std::fabs(a[e] - b[e]));
+            return delta;
+        };
+        bool attentionOk = true;
+        Tensor causalFull(TensorShape{2, 1, positions, width});
+        for (bool causal : {true, false}) {
+            params.causal = causal;
+            Tensor expected(TensorShape{2, 1, positions, width}), actual(TensorShape{2, 1, positions, width});
+            naive(causal, expected);
+            kernels::Attention(qkv, nullptr, params, actual, 0, kernels::AttentionTasks(qkv.shape, params));
+            attentionOk = attentionOk && maxDelta(expected, actual) < 1e-5f;
+            if (causal) causalFull = actual;
+        }
+
+        // Decoding: the cache holds every earlier position's keys and values
+        params.causal = true;
+        for (int64_t p = 0; attentionOk && p < positions; p += 9) {
+            Tensor cache(TensorShape{2, 2, p, width}), step(TensorShape{2, 3, 1, width}), output(TensorShape{2, 1, 1, width});
+            for (int64_t n = 0; n < 2; ++n) {
+                for (int64_t c = 0; c < 3; ++c) {
+                    std::copy(row(qkv, n, c, p), row(qkv, n, c, p) + width, row(step, n, c, 0));
+                    for (int64_t k = 0; c > 0 && k < p; ++k) {
+                        std::copy(row(qkv, n, c, k), row(qkv, n, c, k) + width, row(cache, n, c - 1, k));
+                    }
+                }
+            }
+            kernels::Attention(step, &cache, params, output, 0, kernels::AttentionTasks(step.shape, params));
+            for (int64_t n = 0; n < 2; ++n) {
+                for (int64_t d = 0; d < width; ++d) {
+                    attentionOk = attentionOk && std::fabs(row(output, n, 0, 0)[d] - row(causalFull, n, 0, p)[d]) < 1e-5f;
+                }
+            }
+        }
+
+        // Graph op with a cache input, large enough to spread over the workers
+        // of the model's own pool: the same kernel on the inputs the plan produced
+        ExecutorService pool(3);
+        AIModel net;
+        net.SetExecutor(pool);
+        net.AddNode(AINode{1, "Elementwise", "qkv", {{"input_shape", "1x3x256x256"}}, {}, {}, -1});
+        net.AddNode(AINode{2, "Elementwise", "cache", {{"input_shape", "1x2x128x256"}}, {}, {}, -1});
+        net.AddNode(AINode{3, "Attention", "attn", {{"heads", "4"}, {"cache_length", "128"}}, {}, {}, -1});
+        net.AddNode(AINode{4, "Attention", "bad", {{"heads", "5"}}, {}, {}, -1});
+        net.AddConnection(1, 3, 0, 0);
+        net.AddConnection(2, 3, 0, 0);
+        auto plan = net.GetPlan();
+        net.RemoveNode(4);
+        plan = plan ? nullptr : net.GetPlan();
+        std::vector<Tensor> outputs;
+        if (plan) plan->RunAll({}, outputs);
+        RunHandle run = plan ? net.SubmitRun() : RunHandle();
+        const Tensor* got = run ? run.Get().Output(3) : nullptr;
+        const int attn = plan ? plan->IndexOf(3) : -1;
+        attentionOk = attentionOk && attn >= 0 && outputs.size() == 3 && got && outputs[attn].shape.c == 1 &&
+                      std::string((*plan)[attn].kernelName) == "attention_flash";
+        if (attentionOk) {
+            Tensor direct(outputs[attn].shape);
+            kernels::Attention(outputs[plan->IndexOf(1)], &outputs[plan->IndexOf(2)], (*plan)[attn].attention, direct, 0,
+                               kernels::AttentionTasks(outputs[plan->IndexOf(1)].shape, (*plan)[attn].attention));
+            // The model is the pool's only client; helper tasks ran under it
+            attentionOk = maxDelta(direct, outputs[attn]) == 0.0f && maxDelta(direct, *got) == 0.0f &&
+                          pool.GetClientStats(1).completed > 3;
+        }
+        std::cout << "Test: flash attention " << (attentionOk ? "matched the reference" : "FAILED") << std::endl;
+        if (!attentionOk) ok = false;
+    }
+
+    // Winograd kernels run 3x3 stride-1 nodes that ask for them, at any
+    // padding and with groups, close to Conv2D; other nodes keep the default
+    {
+        AIModel wino;
+        wino.AddNode(AINode{1, "Conv2D", "w2", {{"input_shape", "2x6x11x9"}, {"out_channels", "8"}, {"groups", "2"},
+                                                {"impl", "conv2d_winograd2"}}, {}, {}, -1});
+        wino.AddNode(AINode{2, "Conv2D", "w4", {{"out_channels", "12"}, {"padding", "2"}, {"impl", "conv2d_winograd4"}}, {}, {}, -1});
+        wino.AddNode(AINode{3, "Conv2D", "w4p0", {{"out_channels", "5"}, {"padding", "0"}, {"impl", "conv2d_winograd4"}}, {}, {}, -1});
+        wino.AddNode(AINode{4, "Conv2D", "s2", {{"out_channels", "4"}, {"stride", "2"}, {"impl", "conv2d_winograd2"}}, {}, {}, -1});
+        for (int id = 1; id < 4; ++id) wino.AddConnection(id, id + 1, 0, 0);
+        auto plan = wino.GetPlan();
+        bool winoOk = plan && std::string((*plan)[0].kernelName) == "conv2d_winograd2" &&
+                      std::string((*plan)[1].kernelName) == "conv2d_winograd4" &&
+                      std::string((*plan)[2].kernelName) == "conv2d_winograd4" && std::string((*plan)[3].kernelName) == "conv2d_direct";
+        for (size_t i = 0; winoOk && i < 3; ++i) {
+            const ExecutionPlan::Node& node = (*plan)[i];
+            Tensor input(node.cost.input), direct(node.cost.output), winograd(node.cost.output);
+            for (size_t e = 0; e < input.Size(); ++e) input[e] = std::sin(0.61f * static_cast<float>(e));
+            const Tensor* inputs[] = {&input};
+            kernels::Conv2D(input, node.weights.data(), node.bias.data(), node.conv, direct);
+            ExecutionPlan::Evaluate(node, inputs, 1, winograd);
+            float maxAbs = 0.0f, maxDelta = 0.0f;
+            for (size_t e = 0; e < direct.Size(); ++e) {
+                maxAbs = std::max(maxAbs, std::fabs(direct[e]));
+                maxDelta = std::max(maxDelta, std::fabs(winograd[e] - direct[e]));
+            }
+            winoOk = !node.packedWeights.empty() && maxDelta < 1e-4f * maxAbs;
+        }
+        std::cout << "Test: Winograd convolutions " << (winoOk ? "matched Conv2D" : "FAILED") << std::endl;
+        if (!winoOk) ok = false;
+    }
+
+    // The tuner times the candidate kernels once, and a later tuner on the
+    // same host reuses the choices from the cache file; candidates may round
+    // differently (Winograd), so only the cached choices match exactly
+    {
+        const std::string cacheFile = "ai_execution_test_kernels.cache";
+        std::remove(cacheFile.c_str());
+        auto build = [](AIModel& net) {
+            net.AddNode(AINode{1, "Conv2D", "conv", {{"input_shape", "1x3x16x16"}, {"out_channels", "8"}}, {}, {}, -1});
+            net.AddNode(AINode{2, "Dense", "fc", {{"units", "10"}}, {}, {}, -1});
+            net.AddConnection(1, 2, 0, 0);
+        };
+        AIModel reference, tuned, cached;
+        build(reference);
+        build(tuned);
+        build(cached);
+        bool tunerOk = true;
+        std::shared_ptr<const ExecutionPlan> tunedPlan;
+        {
+            KernelTuner tuner(cacheFile);
+            tuned.SetKernelTuner(&tuner);
+            tunedPlan = tuned.GetPlan();
+            tunerOk = tunedPlan && tuner.Tuned() == 2 && tuner.CacheHits() == 0;
+            tuned.SetKernelTuner(nullptr);
+        }
+        KernelTuner reuse(cacheFile);
+        cached.SetKernelTuner(&reuse);
+        tunerOk = tunerOk && cached.GetPlan() && reuse.Tuned() == 0 && reuse.CacheHits() == 2;
+        std::cout << "Test: tuned on " << KernelTuner::CpuModel() << ", " << reuse.CacheHits() << " choices from the cache" << std::endl;
+
+        RunHandle expected = reference.SubmitRun();
+        RunHandle actual = cached.SubmitRun();
+        std::vector<Tensor> tunedOutputs;
+        if (tunedPlan) tunedPlan->RunAll({}, tunedOutputs);
+        const Tensor* want = expected ? expected.Get().Output(2) : nullptr;
+        const Tensor* chosen = tunedOutputs.size() == 2 ? &tunedOutputs[1] : nullptr;
+        const Tensor* got = actual ? actual.Get().Output(2) : nullptr;
+        tunerOk = tunerOk && want && chosen && got && want->Size() == got->Size() && chosen->Size() == got->Size() &&
+                  std::equal(chosen->begin(), chosen->end(), got->begin());
+        for (size_t i = 0; tunerOk && i < got->Size(); ++i) tunerOk = std::fabs((*got)[i] - (*want)[i]) < 1e-4f;
+        cached.SetKernelTuner(nullptr);
+        std::remove(cacheFile.c_str());
+        if (!tunerOk) ok = false;
+
+        // Two models compiling at once share the tuner without waiting on
+        // each other's timing; each shape is stored once and both plans use
+        // the stored choice
+        AIModel left, right;
+        build(left);
+        build(right);
+        auto shared = std::make_unique<KernelTuner>(cacheFile);
+        left.SetKernelTuner(shared.get());
+        right.SetKernelTuner(shared.get());
+        auto compiled = std::async(std::launch::async, [&] { return right.GetPlan(); });
+        std::shared_ptr<const ExecutionPlan> leftPlan = left.GetPlan();
+        std::shared_ptr<const ExecutionPlan> rightPlan = compiled.get();
+        bool sharedOk = leftPlan && rightPlan && shared->Tuned() == 2 && shared->CacheHits() == 2;
+        for (size_t i = 0; sharedOk && i < leftPlan->Size(); ++i) sharedOk = (*leftPlan)[i].kernel == (*rightPlan)[i].kernel;
+        // Inputs past the first are part of the key, a lone input is not
+        ExecutionPlan::Node probe;
+        probe.type = "Elementwise";
+        probe.cost.input = TensorShape{1, 4, 2, 2};
+        probe.cost.output = probe.cost.input;
+        const std::string single = KernelTuner::Key(probe, {probe.cost.input});
+        sharedOk = sharedOk && single == KernelTuner::Key(probe, {}) &&
+                   single != KernelTuner::Key(probe, {probe.cost.input, TensorShape{1, 4, 1, 1}});
+        std::cout << "Test: concurrent compiles " << (sharedOk ? "shared the tuner" : "FAILED") << std::endl;
+        left.SetKernelTuner(nullptr);
+        right.SetKernelTuner(nullptr);
+        shared.reset();
+        std::remove(cacheFile.c_str());
+        if (!sharedOk) ok = false;
+
+        // Two tuners that loaded the same file before either flushed both
+        // keep their choices in it: a flush merges what is already there
+        auto buildLarge = [](AIModel& net) {
+            net.AddNode(AINode{1, "Conv2D", "conv", {{"input_shape", "1x3x24x24"}, {"out_channels", "8"}}, {}, {}, -1});
+            net.AddNode(AINode{2, "Dense", "fc", {{"units", "10"}}, {}, {}, -1});
+            net.AddConnection(1, 2, 0, 0);
+        };
+        bool mergeOk = true;
+        {
+            KernelTuner first(cacheFile);
+            KernelTuner second(cacheFile);
+            AIModel small, large;
+            build(small);
+            buildLarge(large);
+            small.SetKernelTuner(&first);
+            large.SetKernelTuner(&second);
+            mergeOk = small.GetPlan() && large.GetPlan() && first.Flush() && second.Flush();
+            small.SetKernelTuner(nullptr);
+            large.SetKernelTuner(nullptr);
+        }
+        {
+            KernelTuner merged(cacheFile);
+            merged.SetTuning(false);
+            AIModel small, large;
+            build(small);
+            buildLarge(large);
+            small.SetKernelTuner(&merged);
+            large.SetKernelTuner(&merged);
+            mergeOk = mergeOk && small.GetPlan() && large.GetPlan() && merged.CacheHits() == 4;
+            small.SetKernelTuner(nullptr);
+            large.SetKernelTuner(nullptr);
+        }
+        std::cout << "Test: two tuners flushing one cache file " << (mergeOk ? "kept both" : "FAILED") << std::endl;
+        std::remove(cacheFile.c_str());
+        if (!mergeOk) ok = false;
+    }
 
+    // Concurrent runs of one compiled plan each keep their own tensors and
+    // produce the same sink output
     {
-        std::unique_lock<std::mutex> lk(m);
-        if (!cv.wait_for(lk, std::chrono::seconds(20), [&]{ return completed == total; })) {
-            std::cerr << "Timeout waiting for second run completion" << std::endl;
+        std::vector<std::shared_ptr<RunContext>> runs;
+        for (int i = 0; i < 4; ++i) runs.push_back(model.StartRun());
+        bool runsOk = true;
+        const Tensor* reference = nullptr;
+        for (const auto& run : runs) {
+            if (!run || !run->WaitFor(std::chrono::seconds(20)) || !run->Succeeded()) {
+                runsOk = false;
+                continue;
+            }
+            const Tensor* output = run->Output(3);
+            if (!output || output->Empty()) {
+                runsOk = false;
+            } else if (!reference) {
+                reference = output;
+            } else if (output->shape != reference->shape || !std::equal(output->begin(), output->end(), reference->begin())) {
+                runsOk = false;
+            }
+        }
+        std::cout << "Test: " << runs.size() << " concurrent runs of one plan " << (runsOk ? "matched" : "FAILED") << std::endl;
+        if (!runsOk) ok = false;
+    }
+
+    // Dynamic batching: concurrent single-item requests are coalesced into
+    // fewer runs and each gets back exactly its own slice of the output
+    {
+        AIModel small;
+        AINode conv{1, "Conv2D", "conv", {{"input_shape", "1x3x16x16"}, {"out_channels", "8"}}, {}, {}, -1};
+        AINode fc{2, "Dense", "fc", {{"units", "4"}}, {}, {}, -1};
+        small.AddNode(conv);
+        small.AddNode(fc);
+        small.AddConnection(1, 2, 0, 0);
+
+        BatchingOptions options;
+        options.maxBatchSize = 8;
+        options.maxWait = std::chrono::milliseconds(50);
+        BatchingServer server(small, options);
+        const int requests = 8;
+        std::vector<Tensor> items(requests), results(requests);
+        std::vector<int> served(requests, 0);
+        bool batchingOk = server.Start(-1);
+        if (batchingOk) {
+            for (int i = 0; i < requests; ++i) {
+                items[i] = Tensor(server.InputShape());
+                for (size_t j = 0; j < items[i].Size(); ++j) items[i][j] = static_cast<float>((i + 1) * (j % 7)) / 10.0f;
+            }
+            std::vector<std::thread> clients;
+            for (int i = 0; i < requests; ++i) {
+                clients.emplace_back([&, i]() { served[i] = server.Infer(items[i], results[i]); });
+            }
+            for (std::thread& client : clients) client.join();
+            server.Stop();
+
+            for (int i = 0; batchingOk && i < requests; ++i) {
+                std::shared_ptr<RunContext> single = small.StartRun({{1, items[i]}});
+                const Tensor* expected = single && single->WaitFor(std::chrono::seconds(20)) ? single->Output(2) : nullptr;
+                batchingOk = served[i] && expected && results[i].Size() == expected->Size() &&
+                             std::equal(expected->begin(), expected->end(), results[i].begin());
+            }
+        }
+        std::cout << "Test: " << server.RequestsServed() << " requests served in " << server.BatchesRun() << " batches" << std::endl;
+        if (!batchingOk || server.BatchesRun() >= static_cast<uint64_t>(requests)) {
+            std::cerr << "Batching server did not coalesce or returned wrong results" << std::endl;
             ok = false;
         }
+
+        // Caller buffers bound by port name: the sink writes into ours in place
+        if (batchingOk) {
+            std::vector<float> input(items[0].begin(), items[0].end());
+            std::vector<float> output(static_cast<size_t>(server.OutputShape().Elements()), -1.0f);
+            RunHandle bound = small.SubmitRun(RunBindings()
+                                                  .BindInput("conv", server.InputShape(), input.data())
+                                                  .BindOutput("fc:output", output.data(), output.size()));
+            const bool bindingOk = bound && bound.Get().Succeeded() && bound.Get().Output(2) &&
+                                   bound.Get().Output(2)->Data() == output.data() &&
+                                   std::equal(output.begin(), output.end(), results[0].begin());
+            std::cout << "Test: bound output " << (bindingOk ? "written in place" : "FAILED") << std::endl;
+            if (!bindingOk) ok = false;
+        }
     }
 
-    model.StopExecution();
-    std::cout << "Test: second run finished, completed=" << completed << std::endl;
+    // Worker time alive is counted while the shared pool's workers still run,
+    // so busy time never exceeds it
+    {
+        MetricsRegistry& metrics = MetricsRegistry::Global();
+        const double busy = metrics.GetCounter("aishow_worker_busy_seconds_total", "").Value();
+        const double available = metrics.GetCounter("aishow_worker_available_seconds_total", "").Value();
+        std::cout << "Test: workers busy " << busy << " s of " << available << " s available" << std::endl;
+        if (busy <= 0.0 || busy > available) ok = false;
+    }
+
+    std::cout << "Process allocations:\n" << MemoryTracker::Report(MemoryTracker::Snapshot());
+    std::cout << "Metrics:\n" << MetricsRegistry::Global().RenderPrometheus();
 
     if (ok) {
         std::cout << "ai_execution_test: PASS" << std::endl;
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+using SocketHandle = SOCKET;
+#define AISHOW_CLOSE_SOCKET closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketHandle = int;
+#define AISHOW_CLOSE_SOCKET close
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// One keep-alive HTTP connection to the serving front end
+class Client {
+public:
+    explicit Client(int port) {
+        sock_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock_ == static_cast<SocketHandle>(-1)) return;
+        int noDelay = 1;
+        setsockopt(sock_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        connected_ = connect(sock_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    }
+    ~Client() {
+        if (sock_ != static_cast<SocketHandle>(-1)) AISHOW_CLOSE_SOCKET(sock_);
+    }
+
+    bool Connected() const { return connected_; }
+
+    // Sends one request and reads the whole response; returns the status code (0 on I/O failure)
+    int Request(const char* method, const char* path, const std::string& body, std::string& responseBody) {
+        std::string request = std::string(method) + " " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: " +
+                              std::to_string(body.size()) + "\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < request.size()) {
+            int n = send(sock_, request.data() + sent, static_cast<int>(request.size() - sent), 0);
+            if (n <= 0) return 0;
+            sent += static_cast<size_t>(n);
+        }
+
+        char chunk[16384];
+        size_t headEnd;
+        while ((headEnd = buffer_.find("\r\n\r\n")) == std::string::npos) {
+            int n = recv(sock_, chunk, sizeof(chunk), 0);
+            if (n <= 0) return 0;
+            buffer_.append(chunk, static_cast<size_t>(n));
+        }
+        const int status = std::atoi(buffer_.c_str() + 9);
+        size_t length = 0;
+        const size_t lengthPos = buffer_.find("Content-Length:");
+        if (lengthPos != std::string::npos && lengthPos < headEnd) length = std::strtoull(buffer_.c_str() + lengthPos + 15, nullptr, 10);
+        while (buffer_.size() < headEnd + 4 + length) {
+            int n = recv(sock_, chunk, sizeof(chunk), 0);
+            if (n <= 0) return 0;
+            buffer_.append(chunk, static_cast<size_t>(n));
+        }
+        responseBody = buffer_.substr(headEnd + 4, length);
+        buffer_.erase(0, headEnd + 4 + length);
+        return status;
+    }
+
+private:
+    SocketHandle sock_;
+    bool connected_ = false;
+    std::string buffer_;
+};
+
+double Percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0.0;
+    const size_t rank = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+}
+
+// Usage: aishow_loadgen [PORT] [SECONDS_PER_LEVEL] [MAX_CLIENTS]
+// Closed-loop load against aishow_serve: at each level (1, 2, 4, ... up to
+// MAX_CLIENTS connections) every client sends its next request as soon as
+// the previous one is answered. Prints one throughput / latency point per
+// level, giving the throughput-vs-p99 curve of the batching settings.
+int main(int argc, char** argv) {
+    const int port = argc >= 2 ? std::atoi(argv[1]) : 8090;
+    const double secondsPerLevel = argc >= 3 ? std::atof(argv[2]) : 3.0;
+    const int maxClients = argc >= 4 ? std::atoi(argv[3]) : 64;
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return 1;
+#endif
+
+    // The server describes its input shape; requests carry that many floats
+    std::string info;
+    {
+        Client client(port);
+        if (!client.Connected() || client.Request("GET", "/info", "", info) != 200) {
+            std::cerr << "No batching server on 127.0.0.1:" << port << std::endl;
+            return 1;
+        }
+    }
+    long long n = 0, c = 0, h = 0, w = 0;
+    const size_t inputPos = info.find("input ");
+    if (inputPos == std::string::npos || std::sscanf(info.c_str() + inputPos, "input %lldx%lldx%lldx%lld", &n, &c, &h, &w) != 4) {
+        std::cerr << "Unexpected /info reply:\n" << info << std::endl;
+        return 1;
+    }
+    std::cout << info;
+
+    std::vector<float> item(static_cast<size_t>(n * c * h * w));
+    for (size_t i = 0; i < item.size(); ++i) item[i] = static_cast<float>((i * 7919) % 255) / 255.0f;
+    const std::string body(reinterpret_cast<const char*>(item.data()), item.size() * sizeof(float));
+
+    std::cout << std::setw(9) << "clients" << std::setw(11) << "requests" << std::setw(10) << "errors"
+              << std::setw(11) << "req/s" << std::setw(10) << "p50_ms" << std::setw(10) << "p99_ms" << std::endl;
+
+    for (int clients = 1; clients <= maxClients; clients *= 2) {
+        std::mutex resultsMutex;
+        std::vector<double> latencies;
+        std::atomic<size_t> errors{0};
+        const auto start = Clock::now();
+        const auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(secondsPerLevel));
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < clients; ++i) {
+            threads.emplace_back([&]() {
+                Client client(port);
+                if (!client.Connected()) {
+                    errors.fetch_add(1);
+                    return;
+                }
+                std::vector<double> local;
+                std::string response;
+                while (Clock::now() < deadline) {
+                    const auto sent = Clock::now();
+                    const int status = client.Request("POST", "/infer", body, response);
+                    if (status == 200) {
+                        local.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sent).count());
+                    } else {
+                        errors.fetch_add(1);
+                        if (status == 0) break;
+                    }
+                }
+                std::lock_guard<std::mutex> lock(resultsMutex);
+                latencies.insert(latencies.end(), local.begin(), local.end());
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        const size_t completed = latencies.size();
+        std::cout << std::setw(9) << clients << std::setw(11) << completed << std::setw(10) << errors.load()
+                  << std::setw(11) << std::fixed << std::setprecision(1) << completed / elapsed << std::setw(10)
+                  << std::setprecision(2) << Percentile(latencies, 0.50) << std::setw(10) << Percentile(latencies, 0.99)
+                  << std::endl;
+    }
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
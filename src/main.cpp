@@ -1,6 +1,11 @@
 #include "NodeEditor.h"
 #include "AIModel.h"
+#include "KernelTuner.h"
+#include "Quantizer.h"
 #include "SyncManager.h"
+#include "ModelFileWatcher.h"
+#include "Profiler.h"
+#include "Metrics.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -27,6 +32,7 @@ void UpdateEditorProgress(const ExecutionProgress& progress) {
 
 int main() {
     std::cout << "=== AI Model Node Display System ===" << std::endl;
+    PROFILE_THREAD_NAME("main");
 
     // Initialize our components
     NodeEditor editor;
@@ -36,7 +42,10 @@ int main() {
         return -1;
     }
 
+    KernelTuner kernelTuner;
     AIModel model;
+    model.SetKernelTuner(&kernelTuner);
+    editor.SetExecutionLog(&model.GetExecutionLog());
 
     // Create SyncManager
     SyncManager syncManager(&editor, &model);
@@ -48,6 +57,35 @@ int main() {
         syncManager.SyncModelToEditor();
     });
 
+    // Predicted costs come from the model's cache, refreshed after graph changes
+    editor.SetNodeCostSource([&model]() -> const NodeCostMap& { return model.GetNodeCosts(); });
+
+    // Trace menu: runs are recorded to and replayed from a fixed file
+    const std::string traceFile = "aishow_run.trace";
+    editor.SetSaveTraceCallback([&model, traceFile]() {
+        if (model.SaveExecutionTrace(traceFile)) {
+            std::cout << "Saved execution trace to " << traceFile << std::endl;
+        }
+    });
+    editor.SetReplayTraceCallback([&editor, &syncManager, traceFile](double speed) {
+        ExecutionTrace trace;
+        if (syncManager.IsExecuting() || !ExecutionTrace::Load(traceFile, trace)) return;
+        editor.ClearExecutionProgress();
+        syncManager.StartReplay(trace, speed);
+    });
+
+    // Precision menu: FP16 / BF16 set the model's storage policy; INT8
+    // calibrates on the synthetic input and prints the accuracy and speed
+    // against FP32
+    editor.SetPrecisionCallback([&model, &syncManager](Precision precision) {
+        if (syncManager.IsExecuting()) return;
+        Quantizer::Dequantize(model);
+        const bool half = IsHalf(precision);
+        model.SetPrecisionPolicy({half ? precision : Precision::FP32, half ? precision : Precision::FP32});
+        QuantizationReport report;
+        if (precision == Precision::INT8 && Quantizer::Quantize(model, {}, &report)) std::cout << report.ToText();
+    });
+
     // Set up execution progress callback
     syncManager.SetExecutionProgressCallback([](const ExecutionProgress& progress) {
         HandleExecutionProgress(progress);
@@ -60,6 +98,14 @@ int main() {
     // Sync the loaded model to the editor UI
     syncManager.SyncModelToEditor();
 
+    // Expose executor and sync metrics for a local Prometheus scraper
+    MetricsServer metricsServer;
+    metricsServer.Start(9464);
+
+    // Reload the model incrementally whenever the file is rewritten
+    ModelFileWatcher modelWatcher("./model.txt");
+    modelWatcher.Start();
+
     std::cout << "Press SPACE to start/stop execution, or close the window to exit" << std::endl;
     std::cout << "Right-click in the editor to add nodes" << std::endl;
 
@@ -82,8 +128,15 @@ int main() {
                     } else {
                         // Clear old progress data before starting new execution
                         editor.ClearExecutionProgress();
-                        syncManager.StartExecution(2);
-                        std::cout << "Started execution with 2 threads" << std::endl;
+                        RunHandle run = syncManager.StartExecution(2);
+                        if (run) {
+                            std::cout << "Started execution with 2 threads" << std::endl;
+                            run.Then([](const RunContext& finished) {
+                                std::cout << "Execution " << (finished.Succeeded() ? "finished" : "stopped") << ": "
+                                          << finished.CompletedNodes() << "/" << finished.TotalNodes() << " nodes in "
+                                          << finished.ElapsedSeconds() * 1e3 << " ms" << std::endl;
+                            });
+                        }
                     }
                 }
             } else {
@@ -91,6 +144,18 @@ int main() {
                 spaceWasPressed = false;
             }
 
+            // Apply the latest parsed model file; the executor reads the model,
+            // so reloads wait until the current run has finished
+            if (!syncManager.IsExecuting()) {
+                ModelSnapshot snapshot;
+                if (modelWatcher.TakeSnapshot(snapshot)) {
+                    ModelDelta delta = model.Diff(snapshot);
+                    if (!delta.empty()) {
+                        syncManager.ApplyModelDelta(delta);
+                    }
+                }
+            }
+
             // Small sleep to prevent busy waiting and reduce CPU usage
             std::this_thread::sleep_for(std::chrono::milliseconds(16)); // ~60 FPS
         }
@@ -100,7 +165,9 @@ int main() {
         std::cerr << "Unknown exception in main loop" << std::endl;
     }
 
-    // Stop execution and sync
+    // Stop watching, serving metrics, execution and sync
+    modelWatcher.Stop();
+    metricsServer.Stop();
     syncManager.StopExecution();
     // No background sync thread is used; ensure callbacks are cleared if needed
     syncManager.StopSync();
@@ -0,0 +1,50 @@
+#include "AIModel.h"
+#include "BatchingServer.h"
+#include "KernelTuner.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+namespace {
+std::atomic<bool> g_stop{false};
+
+void HandleSignal(int) {
+    g_stop = true;
+}
+}
+
+// Usage: aishow_serve MODEL_FILE [PORT] [MAX_BATCH] [MAX_WAIT_US]
+// Serves the model's single entry -> sink path over loopback HTTP with
+// dynamic batching until interrupted.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: aishow_serve MODEL_FILE [PORT] [MAX_BATCH] [MAX_WAIT_US]" << std::endl;
+        return 1;
+    }
+    const int port = argc >= 3 ? std::atoi(argv[2]) : 8090;
+    BatchingOptions options;
+    if (argc >= 4) options.maxBatchSize = std::max(1, std::atoi(argv[3]));
+    if (argc >= 5) options.maxWait = std::chrono::microseconds(std::max(0, std::atoi(argv[4])));
+
+    // Kernel choices are timed on the first start and cached per host
+    KernelTuner tuner;
+    AIModel model;
+    model.SetKernelTuner(&tuner);
+    model.LoadFromFile(argv[1]);
+    model.SetExecutionConfig(model.GetExecutor().NumWorkers());
+
+    BatchingServer server(model, options);
+    if (!server.Start(port)) return 1;
+
+    std::signal(SIGINT, HandleSignal);
+    std::signal(SIGTERM, HandleSignal);
+    while (!g_stop) std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    server.Stop();
+    std::cout << "Served " << server.RequestsServed() << " requests in " << server.BatchesRun() << " batches" << std::endl;
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "AIModel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Small CNN: two 3x3 convolutions on a 16x32x32 input, pooling, a residual add and a classifier
+void BuildNetwork(AIModel& model) {
+    AINode conv1{1, "Conv2D", "conv1", {{"input_shape", "1x16x32x32"}, {"out_channels", "16"}}, {}, {}, -1};
+    AINode conv2{2, "Conv2D", "conv2", {{"out_channels", "16"}}, {}, {}, -1};
+    AINode add{3, "Add", "residual", {}, {}, {}, -1};
+    AINode pool{4, "MaxPool", "pool", {}, {}, {}, -1};
+    AINode fc{5, "Dense", "fc", {{"units", "10"}}, {}, {}, -1};
+    for (const AINode* node : {&conv1, &conv2, &add, &pool, &fc}) model.AddNode(*node);
+
+    model.AddConnection(1, 2, 0, 0);
+    model.AddConnection(1, 3, 0, 0);
+    model.AddConnection(2, 3, 0, 0);
+    model.AddConnection(3, 4, 0, 0);
+    model.AddConnection(4, 5, 0, 0);
+}
+
+double Percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0.0;
+    const size_t rank = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+}
+
+// Usage: aishow_throughput_bench [SECONDS_PER_LEVEL] [MAX_CONCURRENT_RUNS]
+// Keeps N runs of one compiled plan in flight (N = 1, 2, 4, ... up to the
+// maximum) and reports runs per second and run latency at each level.
+int main(int argc, char** argv) {
+    const double secondsPerLevel = argc >= 2 ? std::atof(argv[1]) : 2.0;
+    const int maxConcurrent = argc >= 3 ? std::atoi(argv[2]) : 256;
+
+    ExecutorService& executor = ExecutorService::Shared();
+    AIModel model;
+    BuildNetwork(model);
+    model.SetExecutionConfig(executor.NumWorkers());
+    if (!model.GetPlan()) {
+        std::cerr << "Benchmark graph failed to compile" << std::endl;
+        return 1;
+    }
+
+    std::cout << "workers=" << executor.NumWorkers() << " nodes=" << model.GetPlan()->Size() << std::endl;
+    std::cout << std::setw(10) << "in_flight" << std::setw(12) << "runs" << std::setw(12) << "runs/s"
+              << std::setw(12) << "p50_ms" << std::setw(12) << "p99_ms" << std::endl;
+
+    for (int concurrent = 1; concurrent <= maxConcurrent; concurrent *= 2) {
+        std::deque<std::shared_ptr<RunContext>> inFlight;
+        std::vector<double> latencies;
+        size_t failed = 0;
+        const auto start = Clock::now();
+        const auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(secondsPerLevel));
+
+        // Runs finish roughly in submission order, so waiting on the oldest
+        // keeps the window full without polling every run
+        while (Clock::now() < deadline || !inFlight.empty()) {
+            while (Clock::now() < deadline && static_cast<int>(inFlight.size()) < concurrent) {
+                inFlight.push_back(model.StartRun());
+            }
+            if (inFlight.empty()) break;
+            std::shared_ptr<RunContext> run = std::move(inFlight.front());
+            inFlight.pop_front();
+            if (run) run->Wait();
+            if (run && run->Succeeded()) {
+                latencies.push_back(run->ElapsedSeconds() * 1e3);
+            } else {
+                ++failed;
+            }
+        }
+
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        const size_t completed = latencies.size();
+        std::cout << std::setw(10) << concurrent << std::setw(12) << completed << std::setw(12) << std::fixed
+                  << std::setprecision(1) << completed / elapsed << std::setw(12) << std::setprecision(2)
+                  << Percentile(latencies, 0.50) << std::setw(12) << Percentile(latencies, 0.99) << std::endl;
+        if (failed > 0) std::cerr << failed << " runs failed at " << concurrent << " in flight" << std::endl;
+    }
+
+    model.CancelAllRuns();
+    return 0;
+}